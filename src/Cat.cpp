@@ -1,8 +1,10 @@
 #include "Rcpp.h"
 #include <algorithm>
 #include <math.h>
+#include <thread>
 #include "Cat.h"
 #include "EAPEstimator.h"
+#include "GridEAPEstimator.h"
 #include "MAPEstimator.h"
 #include "MLEEstimator.h"
 #include "WLEEstimator.h"
@@ -16,16 +18,253 @@
 #include "LKLSelector.h"
 #include "PKLSelector.h"
 #include "RANDOMSelector.h"
+#include "ParallelUtil.h"
+#include "TreeFile.h"
+#include <exception>
+#include <functional>
+#include <mutex>
 
 
 using namespace Rcpp;
 
-Cat::Cat(S4 cat_df) : questionSet(cat_df),
+Cat::Cat(S4 cat_df) : Cat(cat_df, CatControl()) {}
+
+Cat::Cat(S4 cat_df, const CatControl &control) : estimation_type(as<std::string>(cat_df.slot("estimation"))),
+                      estimation_default(as<std::string>(cat_df.slot("estimationDefault"))),
+                      selection_type(as<std::string>(cat_df.slot("selection"))),
+                      control(control),
+                      questionSet(cat_df),
                       integrator(Integrator()),
                       prior(cat_df),
                       checkRules(cat_df),
-                      estimator(createEstimator(cat_df, integrator, questionSet)),
-                      selector(createSelector(cat_df.slot("selection"), questionSet, *estimator, prior)){}
+                      info_table(control.infoTable && selection_type == "MFI" ?
+                                 InfoTable::shared(questionSet.bank, size_t(control.infoTablePoints)) : nullptr),
+                      info_bounds(control.infoBound && selection_type == "MFI" ?
+                                  InfoBounds::shared(questionSet.bank, size_t(control.infoBoundBins)) : nullptr),
+                      screen_diagnostics(control.screen > 0 ? std::make_shared<ScreenDiagnostics>() : nullptr),
+                      estimator(createEstimator(estimation_type, estimation_default, control, integrator, questionSet)),
+                      selector(createSelector(selection_type, questionSet, *estimator, prior, control,
+                                              info_table.get(), info_bounds.get(), screen_diagnostics.get())),
+                      using_default_estimator(usesDefaultEstimator()),
+                      speculated_item(-1){
+  estimator->sync(prior);
+  // RANDOM selections differ from one call to the next, so they are never shared
+  if (control.cache && selection_type != "RANDOM") {
+    cache = SelectionCache::shared(configurationFingerprint(), size_t(control.cacheSize));
+    cache_base_answers = questionSet.answers;
+  }
+}
+
+Cat::Cat(const Cat &other) : estimation_type(other.estimation_type),
+                      estimation_default(other.estimation_default),
+                      selection_type(other.selection_type),
+                      control(other.control),
+                      questionSet(other.questionSet),
+                      integrator(other.integrator),
+                      prior(other.prior),
+                      checkRules(other.checkRules),
+                      info_table(other.info_table),
+                      info_bounds(other.info_bounds),
+                      // Copies select in the background (speculation, makeTree, simulateThetas), which the
+                      // diagnostics of the session do not count
+                      screen_diagnostics(nullptr),
+                      estimator(createEstimator(estimation_type, estimation_default, control, integrator, questionSet)),
+                      selector(createSelector(selection_type, questionSet, *estimator, prior, control,
+                                              info_table.get(), info_bounds.get(), screen_diagnostics.get())),
+                      using_default_estimator(other.using_default_estimator),
+                      speculated_item(-1){
+  estimator->sync(prior);
+}
+
+Cat::~Cat() {
+  discardSpeculation();
+  if (speculation_thread.joinable()) {
+    speculation_thread.join();
+  }
+}
+
+void Cat::storeAnswer(size_t item, int answer) {
+  if (item >= questionSet.answers.size()) {
+    throw std::domain_error("item is out of range for this Cat.");
+  }
+
+  if (answer != NA_INTEGER && answer != -1) {
+    bool binary = isBinary(questionSet.bank->model_type);
+    int min_response = binary ? 0 : 1;
+    int max_response = binary ? 1 : questionSet.bank->threshold_count(item) + 1;
+    if (answer < min_response || answer > max_response) {
+      throw std::domain_error("answer is not a valid response option for this item.");
+    }
+  }
+
+  next_selection.reset();
+  if (speculated_item >= 0) {
+    auto option = std::find(speculated_answers.begin(), speculated_answers.end(), answer);
+    if (int(item) == speculated_item && option != speculated_answers.end()) {
+      try {
+        std::vector<Selection> selections = speculation.get();
+        next_selection.reset(new Selection(selections[option - speculated_answers.begin()]));
+      }
+      catch (...) {
+        // The selection is made again, and any error reported, when it is asked for
+      }
+    }
+    discardSpeculation();
+  }
+
+  questionSet.reset_answer(item, answer);
+  refreshEstimator();
+
+  if (cache) {
+    cache_path.erase(std::remove_if(cache_path.begin(), cache_path.end(), [item](const std::pair<int, int> &step) {
+      return step.first == int(item);
+    }), cache_path.end());
+    if (answer != cache_base_answers[item]) {
+      cache_path.push_back(std::make_pair(int(item), answer));
+    }
+  }
+}
+
+std::vector<Selection> Cat::selectionsAfter(int item, const std::vector<int> &answers,
+                                            const std::atomic<bool> *cancelled) {
+  std::vector<Selection> selections(answers.size());
+  // RANDOM selection draws from R's random number generator, which is only safe on the main thread
+  forEachSession(answers.size(), [&](Cat &session, size_t i) {
+    if (mpl::isCancelled(cancelled)) {
+      return;
+    }
+    // The selector's item loops stop once cancelled is set and throw Cancelled
+    mpl::CancellationScope scope(cancelled);
+    session.questionSet.reset_answer(item, answers[i]);
+    session.refreshEstimator();
+    try {
+      selections[i] = session.selector->selectItem();
+    }
+    catch (const mpl::Cancelled &) {
+    }
+  }, selection_type != "RANDOM");
+  return selections;
+}
+
+void Cat::speculate(int item) {
+  if (item == speculated_item || selection_type == "RANDOM" || questionSet.nonapplicable_rows.size() < 2) {
+    return;
+  }
+  discardSpeculation();
+  // A session runs one speculation at a time. The previous one was cancelled, so it stops at its next item.
+  if (speculation_thread.joinable()) {
+    speculation_thread.join();
+  }
+
+  // The snapshot is owned by the task, so answers stored here meanwhile do not affect it
+  std::shared_ptr<Cat> snapshot(new Cat(*this));
+  std::vector<int> answers = responseOptions(item);
+  std::shared_ptr<std::atomic<bool> > cancelled(new std::atomic<bool>(false));
+  std::packaged_task<std::vector<Selection>()> task([snapshot, item, answers, cancelled]() {
+    return snapshot->selectionsAfter(item, answers, cancelled.get());
+  });
+  speculation = task.get_future();
+  speculation_thread = std::thread(std::move(task));
+  speculation_cancelled = cancelled;
+  speculated_item = item;
+  speculated_answers = answers;
+}
+
+void Cat::discardSpeculation() {
+  if (speculation_cancelled) {
+    // The task stops at its next item and is joined by the next speculation or the destructor
+    speculation_cancelled->store(true);
+    speculation_cancelled.reset();
+  }
+  speculation = std::future<std::vector<Selection> >();
+  speculated_item = -1;
+  speculated_answers.clear();
+}
+
+void Cat::refreshEstimator() {
+  // MLE and WLE fall back to estimationDefault while the likelihood has no interior maximum, so
+  // the estimator (and the selector that refers to it) must follow the answers as they change.
+  bool use_default = usesDefaultEstimator();
+  if (use_default != using_default_estimator) {
+    estimator = createEstimator(estimation_type, estimation_default, control, integrator, questionSet);
+    selector = createSelector(selection_type, questionSet, *estimator, prior, control, info_table.get(),
+                              info_bounds.get(), screen_diagnostics.get());
+    using_default_estimator = use_default;
+  }
+  estimator->sync(prior);
+}
+
+size_t Cat::numberOfItems() const {
+  return questionSet.answers.size();
+}
+
+bool Cat::sharesItemBank(const Cat &other) const {
+  return questionSet.bank == other.questionSet.bank;
+}
+
+std::uint64_t Cat::configurationFingerprint() const {
+  // Everything the estimator and selector read; the stopping rules do not affect a selection
+  SelectionCache::Fingerprint fingerprint;
+  fingerprint.add(estimation_type);
+  fingerprint.add(estimation_default);
+  fingerprint.add(selection_type);
+  fingerprint.add(control.quadrature);
+  fingerprint.add(control.quadraturePoints);
+  // Interpolated MFI values differ from exact ones, though the selected item rarely does
+  fingerprint.add(info_table ? control.infoTablePoints : 0);
+  fingerprint.add(info_table ? control.infoTableRefine : 0);
+  // The bounds select the same item, but leave the values of the items they skip missing
+  fingerprint.add(info_bounds ? 1 : 0);
+  // Screening can select other items; audits fill in the values it leaves missing
+  fingerprint.add(control.screen);
+  fingerprint.add(control.screenAudit);
+  fingerprint.add(int(questionSet.bank->model_type));
+  fingerprint.add(questionSet.bank->names.size());
+  for (const std::string &name : questionSet.bank->names) {
+    fingerprint.add(name);
+  }
+  fingerprint.add(questionSet.bank->discrimination);
+  fingerprint.add(questionSet.bank->guessing);
+  fingerprint.add(questionSet.bank->thresholds);
+  fingerprint.add(questionSet.bank->threshold_counts);
+  fingerprint.add(questionSet.bank->z);
+  fingerprint.add(questionSet.bank->lowerBound);
+  fingerprint.add(questionSet.bank->upperBound);
+  fingerprint.add(questionSet.answers);
+  fingerprint.add(int(prior.type()));
+  fingerprint.add(prior.param0());
+  fingerprint.add(prior.param1());
+  return fingerprint.value();
+}
+
+SelectionCache &Cat::selectionCache() {
+  if (!cache) {
+    throw std::domain_error("the session was not created with cache = TRUE in control (or uses RANDOM selection).");
+  }
+  return *cache;
+}
+
+void Cat::saveCache(const std::string &file) {
+  selectionCache().save(file);
+}
+
+void Cat::loadCache(const std::string &file) {
+  selectionCache().load(file, questionSet.bank->size());
+}
+
+Rcpp::List Cat::screenDiagnostics() const {
+  if (!screen_diagnostics) {
+    throw std::domain_error("the session was not created with screen in control.");
+  }
+  return Rcpp::List::create(Named("selections") = double(screen_diagnostics->selections.load()),
+                            Named("audits") = double(screen_diagnostics->audits.load()),
+                            Named("disagreements") = double(screen_diagnostics->disagreements.load()));
+}
+
+bool Cat::usesDefaultEstimator() const {
+  return (estimation_type == "MLE" || estimation_type == "WLE") &&
+    (questionSet.applicable_rows.size() == 0 || questionSet.all_extreme);
+}
 
 bool Cat::checkStopRules() { 
   double SE_est = estimator->estimateSE(prior);
@@ -121,11 +360,27 @@ std::vector<double> Cat::probability(double theta, int question) {
 }
 
 double Cat::estimateTheta() {
-	return estimator->estimateTheta(prior);
+	double theta;
+	if (cache && cache->findEstimate(cache_path, SelectionCache::Estimate::THETA, theta)) {
+		return theta;
+	}
+	theta = estimator->estimateTheta(prior);
+	if (cache) {
+		cache->storeEstimate(cache_path, SelectionCache::Estimate::THETA, theta);
+	}
+	return theta;
 }
 
 double Cat::estimateSE() {
-	return estimator->estimateSE(prior);
+	double se;
+	if (cache && cache->findEstimate(cache_path, SelectionCache::Estimate::SE, se)) {
+		return se;
+	}
+	se = estimator->estimateSE(prior);
+	if (cache) {
+		cache->storeEstimate(cache_path, SelectionCache::Estimate::SE, se);
+	}
+	return se;
 }
 
 double Cat::expectedPV(int item) {
@@ -137,7 +392,21 @@ List Cat::selectItem() {
     throw std::domain_error("selectItem should not be called if all items have been answered.");
   }
   
-  Selection selection = selector->selectItem();
+  Selection selection;
+  if (!next_selection && cache && cache->findSelection(cache_path, selection)) {
+    selection.question_names.resize(selection.questions.size());
+    std::transform(selection.questions.begin(), selection.questions.end(), selection.question_names.begin(),
+                   [this](int question) { return questionSet.bank->names.at(question); });
+  }
+  else {
+    selection = next_selection ? *next_selection : selector->selectItem();
+    if (cache) {
+      cache->storeSelection(cache_path, selection);
+    }
+  }
+  if (control.speculate) {
+    speculate(selection.item);
+  }
   // Adding 1 to each row index so it prints the correct question number for user
 	std::transform(selection.questions.begin(), selection.questions.end(), selection.questions.begin(),
                 bind2nd(std::plus<int>(), 1.0));
@@ -153,53 +422,164 @@ List Cat::lookAhead(int item) {
                item) != questionSet.applicable_rows.end()){
     throw std::domain_error("lookAhead should not be called for an answered item.");
   }
-  
-  // take item out of unanswered questions
-  questionSet.nonapplicable_rows.erase(std::remove(questionSet.nonapplicable_rows.begin(),
-                                                   questionSet.nonapplicable_rows.end(),
-                                                   item), questionSet.nonapplicable_rows.end());
-  // say item has been answered
-  questionSet.applicable_rows.push_back(item);
+  if(item < 0 || size_t(item) >= questionSet.answers.size()){
+    throw std::domain_error("item is out of range for this Cat.");
+  }
+
+  // Every response option, without skipping the item
+  std::vector<int> response_options = responseOptions(item);
+  response_options.erase(response_options.begin());
 
+  std::vector<Selection> selections = selectionsAfter(item, response_options);
   std::vector<int> items;
-  std::vector<int> response_options;
-  for (size_t i = 1; i <= questionSet.difficulty.at(item).size()+1; ++i) {
-    // if binary response options, iterate from 0, otherwise iterate from 1
-    questionSet.answers.at(item) = ((questionSet.model == "ltm") | (questionSet.model == "tpm")) ?  i - 1 : i; 
-    Selection selection = selector->selectItem();
+  for (const Selection &selection : selections) {
     items.push_back(selection.item + 1);
-    response_options.push_back(questionSet.answers.at(item));
   }
-  
-  questionSet.nonapplicable_rows.push_back(item); // add item back to unanswered q's
-  questionSet.applicable_rows.pop_back(); // remove item from answered q's
-  questionSet.answers.at(item) = NA_INTEGER; // remove answer
-    
+
   DataFrame all_estimates = Rcpp::DataFrame::create(Named("response_option") = response_options,
                                                    Named("next_item") = items);
   return Rcpp::List::create(Named("estimates") = all_estimates);
 }
 
+/**
+ * Each worker handles its range of tasks on its own copy of the Cat, so tasks (respondents, tree branches) are
+ * processed in parallel and the item selection within a task runs serially. Errors are rethrown on the calling
+ * thread after all workers finish, choosing the one from the earliest task as a sequential loop would.
+ */
+struct Cat::SessionWorker : public RcppParallel::Worker
+{
+  const Cat &base;
+  const std::function<void(Cat &, size_t)> &task;
+
+  std::mutex error_mutex;
+  std::exception_ptr error;
+  size_t error_index;
+
+  SessionWorker(const Cat &base, const std::function<void(Cat &, size_t)> &task, size_t count)
+    : base(base), task(task), error_index(count) {}
+
+  void operator()(std::size_t begin, std::size_t end)
+  {
+    mpl::ParallelRegion region;
+    size_t i = begin;
+    try
+    {
+      Cat session(base);
+      for(; i != end; ++i)
+      {
+        task(session, i);
+      }
+    }
+    catch(...)
+    {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if(i < error_index)
+      {
+        error = std::current_exception();
+        error_index = i;
+      }
+    }
+  }
+};
+
+void Cat::forEachSession(size_t count, const std::function<void(Cat &, size_t)> &task, bool parallel)
+{
+  SessionWorker worker(*this, task, count);
+  if(parallel)
+  {
+    RcppParallel::parallelFor(0, count, worker);
+  }
+  else
+  {
+    worker(0, count);
+  }
+
+  if(worker.error)
+  {
+    std::rethrow_exception(worker.error);
+  }
+}
+
+std::vector<double> Cat::forEachRespondent(const ResponseMatrix &responses, const std::vector<size_t> &rows,
+                                           double (Cat::*respondent)(const ResponseMatrix &, size_t), bool parallel)
+{
+  std::vector<double> thetas(rows.size());
+  forEachSession(rows.size(), [&](Cat &session, size_t i) {
+    thetas[i] = (session.*respondent)(responses, rows[i]);
+  }, parallel);
+  return thetas;
+}
+
+static std::vector<size_t> allRows(const ResponseMatrix &responses)
+{
+  std::vector<size_t> rows(responses.rows());
+  for(size_t row = 0; row != rows.size(); ++row)
+  {
+    rows[row] = row;
+  }
+  return rows;
+}
+
+double Cat::estimateRespondent(const ResponseMatrix &responses, size_t row)
+{
+  questionSet.reset_answers(responses, row);
+  refreshEstimator();
+  return estimateTheta();
+}
+
 NumericVector Cat::estimateThetas(DataFrame& responses)
 {
-  if(responses.ncol() != questionSet.question_names.size())
+  if(responses.ncol() != questionSet.bank->names.size())
   {
     throw std::domain_error("number of questions doesnt match with catObj");
   }
 
-  size_t nrow = responses.nrow();
-  NumericVector thetas;
-  thetas = static_cast<NumericVector>(no_init(nrow));
-
-  for(size_t row = 0; row != nrow; ++row)
+  ResponseMatrix matrix(responses, questionSet.answers.size());
+  if(!control.deduplicate)
   {
-    questionSet.reset_answers(responses, row);
-    thetas[row] = estimateTheta();
+    std::vector<double> thetas = forEachRespondent(matrix, allRows(matrix), &Cat::estimateRespondent, true);
+    return NumericVector(thetas.begin(), thetas.end());
   }
 
+  // Only the first respondent with each answer pattern is estimated
+  std::vector<size_t> pattern;
+  std::vector<size_t> first_rows = matrix.distinct_rows(pattern);
+  std::vector<double> pattern_thetas = forEachRespondent(matrix, first_rows, &Cat::estimateRespondent, true);
+
+  NumericVector thetas = no_init(matrix.rows());
+  for(size_t row = 0; row != matrix.rows(); ++row)
+  {
+    thetas[row] = pattern_thetas[pattern[row]];
+  }
   return thetas;
 }
 
+double Cat::simulateRespondent(const ResponseMatrix &responses, size_t row)
+{
+  const std::vector<int> initial_answers = questionSet.answers;
+
+  while(!questionSet.nonapplicable_rows.empty() && !(checkStopRules()))
+  {
+    Selection selection = selector->selectItem();
+    int answer = responses.at(row, selection.item);
+    if(answer == NA_INTEGER)
+    {
+      questionSet.reset_answer(selection.item, -1);
+    }
+    else
+    {
+      questionSet.reset_answer(selection.item, answer);
+    }
+    estimator->sync(prior);
+  }
+
+  // FIX ME: checkStopRules already computes theta
+  double theta = estimateTheta();
+
+  questionSet.reset_answers(initial_answers);
+  estimator->sync(prior);
+  return theta;
+}
 
 NumericVector Cat::simulateThetas(DataFrame& responses)
 {
@@ -213,47 +593,241 @@ NumericVector Cat::simulateThetas(DataFrame& responses)
   {
     throw std::domain_error("All answers Cat object should be NA.");
   }
-  
 
-  size_t nrow = responses.nrow();
-  NumericVector thetas;
-  thetas = static_cast<NumericVector>(no_init(nrow));
+  ResponseMatrix matrix(responses, questionSet.answers.size());
+
+  // RANDOM selection draws from R's random number generator, which is only safe on the main thread
+  std::vector<double> thetas = forEachRespondent(matrix, allRows(matrix), &Cat::simulateRespondent,
+                                                 selection_type != "RANDOM");
+  return NumericVector(thetas.begin(), thetas.end());
+}
+
+
+
+std::vector<int> Cat::responseOptions(int item) const
+{
+  std::vector<int> options(1, -1);
+  int lowest = isBinary(questionSet.bank->model_type) ? 0 : 1;
+  for(size_t i = 0; i <= questionSet.bank->threshold_count(item); ++i)
+  {
+    options.push_back(lowest + int(i));
+  }
+  return options;
+}
+
+void Cat::loadBranch(const CatTree &tree, size_t node, const std::vector<int> &initial_answers)
+{
+  std::vector<int> answers = initial_answers;
+  for(int child = int(node), parent = tree[node].parent; parent != -1; child = parent, parent = tree[parent].parent)
+  {
+    answers[tree[parent].item] = tree[child].answer;
+  }
+  questionSet.reset_answers(answers);
+  refreshEstimator();
+}
 
-  auto answers = questionSet.answers;
+/**
+ * The tree is grown one level at a time: the children of every node on a level are added to the tree, and then
+ * the items for all of them are selected in parallel, each branch loading its answers into a worker's copy of
+ * the Cat. Nodes on a level therefore never wait for their siblings' subtrees, and the tree is only resized on
+ * the calling thread.
+ */
+CatTree Cat::buildTree(bool estimates)
+{
+  if(std::isnan(checkRules.lengthThreshold))
+  {
+    throw std::domain_error("makeTree requires lengthThreshold to be set in Cat object.");
+  }
+  if(questionSet.nonapplicable_rows.empty())
+  {
+    throw std::domain_error("makeTree should not be called if all items have been answered.");
+  }
 
-  for(size_t row = 0; row != nrow; ++row)
+  const std::vector<int> initial_answers = questionSet.answers;
+  // Skipped items count as answered here, as they do in lengthThreshold
+  size_t unanswered = questionSet.nonapplicable_rows.size();
+  size_t answered = questionSet.answers.size() - unanswered;
+
+  TreeNode root = {selector->selectItem().item, NA_INTEGER, -1, 0, 0, NA_REAL, NA_REAL};
+  if(estimates)
+  {
+    root.theta = estimateTheta();
+    root.se = estimateSE();
+  }
+  CatTree tree(1, root);
+  std::vector<size_t> level(1, 0);
+
+  // RANDOM selection draws from R's random number generator, which is only safe on the main thread
+  const bool parallel = selection_type != "RANDOM";
+
+  while(true)
   {
-    while(!questionSet.nonapplicable_rows.empty() && !(checkStopRules()))
+    std::vector<size_t> children;
+    for(size_t node : level)
     {
-      Selection selection = selector->selectItem();
-      Rcpp::IntegerVector col = responses[selection.item];
-      if(col[row] == NA_INTEGER)
+      std::vector<int> options = responseOptions(tree[node].item);
+      tree[node].first_child = tree.size();
+      tree[node].child_count = options.size();
+      for(int answer : options)
       {
-        questionSet.reset_answer(selection.item, -1);
-      }
-      else
-      {
-        questionSet.reset_answer(selection.item, col[row]);
+        TreeNode child = {-1, answer, int(node), 0, 0, NA_REAL, NA_REAL};
+        tree.push_back(child);
+        children.push_back(tree.size() - 1);
       }
     }
 
-    // FIX ME: checkStopRules already computes theta
-    thetas[row] = estimateTheta();
+    // Answering the last unanswered item leaves nothing to select
+    const bool last = unanswered == 1;
+    if(!last || estimates)
+    {
+      forEachSession(children.size(), [&](Cat &session, size_t i) {
+        TreeNode &child = tree[children[i]];
+        session.loadBranch(tree, children[i], initial_answers);
+        if(!last)
+        {
+          child.item = session.selector->selectItem().item;
+        }
+        if(estimates)
+        {
+          child.theta = session.estimateTheta();
+          child.se = session.estimateSE();
+        }
+      }, parallel);
+    }
+    if(last)
+    {
+      break;
+    }
 
-    questionSet.reset_answers(answers);
+    // Branches end with the item that would follow the lengthThreshold-th answer
+    ++answered;
+    --unanswered;
+    if(answered >= checkRules.lengthThreshold)
+    {
+      break;
+    }
+    level.swap(children);
   }
+  return tree;
+}
 
-  return thetas;
+static CharacterVector treeItemName(const TreeNode &node, const std::vector<std::string> &question_names)
+{
+  if(node.item < 0)
+  {
+    return CharacterVector::create(NA_STRING);
+  }
+  return CharacterVector::create(question_names[node.item]);
 }
 
+static List treeList(const CatTree &tree, size_t node, const std::vector<std::string> &question_names)
+{
+  const TreeNode &parent = tree[node];
+  List branches(parent.child_count + 1);
+  CharacterVector labels(parent.child_count + 1);
+  for(size_t i = 0; i < parent.child_count; ++i)
+  {
+    const size_t child = parent.first_child + i;
+    labels[i] = std::to_string(tree[child].answer);
+    if(tree[child].child_count > 0)
+    {
+      branches[i] = treeList(tree, child, question_names);
+    }
+    else
+    {
+      branches[i] = List::create(Named("Next") = treeItemName(tree[child], question_names));
+    }
+  }
+  labels[parent.child_count] = "Next";
+  branches[parent.child_count] = treeItemName(parent, question_names);
+  branches.names() = labels;
+  return branches;
+}
+
+static void treePreorder(const CatTree &tree, size_t node, std::vector<size_t> &order)
+{
+  order.push_back(node);
+  for(size_t i = 0; i < tree[node].child_count; ++i)
+  {
+    treePreorder(tree, tree[node].first_child + i, order);
+  }
+}
+
+/**
+ * One row per node, with the answers leading to it in the columns of the items answered and its item in
+ * NextItem. The rows are in the order the R implementation of makeTree used: the root, then the branches of each
+ * answer to the first item, each sorted by the length of the answer sequence as text (e.g. "-1.0.").
+ */
+static CharacterMatrix treeTable(const CatTree &tree, const std::vector<std::string> &question_names)
+{
+  std::vector<size_t> first_answer(tree.size(), 0);
+  std::vector<size_t> label_length(tree.size(), 0);
+  for(size_t node = 1; node < tree.size(); ++node)
+  {
+    const size_t parent = tree[node].parent;
+    first_answer[node] = parent == 0 ? node : first_answer[parent];
+    label_length[node] = label_length[parent] + std::to_string(tree[node].answer).size() + 1;
+  }
+
+  std::vector<size_t> rows;
+  treePreorder(tree, 0, rows);
+  std::stable_sort(rows.begin() + 1, rows.end(), [&](size_t a, size_t b) {
+    if(first_answer[a] != first_answer[b])
+    {
+      return first_answer[a] < first_answer[b];
+    }
+    return label_length[a] < label_length[b];
+  });
+
+  const size_t items = question_names.size();
+  CharacterMatrix table(rows.size(), items + 1);
+  table.fill(NA_STRING);
+  CharacterVector row_names(rows.size());
+  for(size_t row = 0; row < rows.size(); ++row)
+  {
+    const TreeNode &node = tree[rows[row]];
+    if(node.item >= 0)
+    {
+      table(row, items) = question_names[node.item];
+    }
+    for(int child = int(rows[row]), parent = node.parent; parent != -1; child = parent, parent = tree[parent].parent)
+    {
+      table(row, tree[parent].item) = std::to_string(tree[child].answer);
+    }
+    // Row names as.table would give: A to Z, then A1 to Z1, and so on
+    row_names[row] = std::string(1, char('A' + row % 26)) + (row < 26 ? "" : std::to_string(row / 26));
+  }
+
+  CharacterVector column_names(question_names.begin(), question_names.end());
+  column_names.push_back("NextItem");
+  table.attr("dimnames") = List::create(row_names, column_names);
+  table.attr("class") = "table";
+  return table;
+}
+
+SEXP Cat::makeTree(bool flat)
+{
+  CatTree tree = buildTree(false);
+  if(flat)
+  {
+    return treeTable(tree, questionSet.bank->names);
+  }
+  return treeList(tree, 0, questionSet.bank->names);
+}
+
+void Cat::writeTree(const std::string &file, bool estimates)
+{
+  CatTree tree = buildTree(estimates);
+  TreeFile::write(file, tree, questionSet.bank->names, isBinary(questionSet.bank->model_type) ? 0 : 1, estimates);
+}
 
 
 double Cat::d1LL(double theta, bool use_prior) {
-	return estimator->d1LL(theta, use_prior, prior);
+	return estimator->likelihoodTerms(theta, use_prior, prior, false).d1;
 }
 
 double Cat::d2LL(double theta, bool use_prior) {
-	return estimator->d2LL(theta, use_prior, prior);
+	return estimator->likelihoodTerms(theta, use_prior, prior, false).d2;
 }
 
 double Cat::obsInf(double theta, int item) {
@@ -271,14 +845,15 @@ double Cat::fisherInf(double theta, int item) {
  * A fairly naive implementation of a factory method for Estimators. Ideally, this will be refactored
  * into a separate factory with registration.
  */
-std::unique_ptr<Estimator> Cat::createEstimator(S4 &cat_df, Integrator &integrator, QuestionSet &questionSet) {
-	std::string estimation_type = cat_df.slot("estimation");
-  std::string estimation_default = cat_df.slot("estimationDefault");
-  
+std::unique_ptr<Estimator> Cat::createEstimator(std::string estimation_type, std::string estimation_default,
+                                                const CatControl &control, Integrator &integrator,
+                                                QuestionSet &questionSet) {
+	const bool grid_eap = control.quadrature != "adaptive";
 	// Note that this comparison is only legal because std::string, which overrides ==, is being used.
 	// If, for some reason, C-style strings are ever used here, strncmp will have to be inserted.
 
 	if (estimation_type == "EAP") {
+		if (grid_eap) return std::unique_ptr<GridEAPEstimator>(new GridEAPEstimator(integrator, questionSet, control));
 		return std::unique_ptr<EAPEstimator>(new EAPEstimator(integrator, questionSet));
 	}
 
@@ -290,7 +865,10 @@ std::unique_ptr<Estimator> Cat::createEstimator(S4 &cat_df, Integrator &integrat
 	if (estimation_type == "MLE" || estimation_type == "WLE") {
 	  if (questionSet.applicable_rows.size() == 0 || questionSet.all_extreme){
 	    if (estimation_default == "MAP") return std::unique_ptr<MAPEstimator>(new MAPEstimator(integrator, questionSet));
-	    if (estimation_default == "EAP") return std::unique_ptr<EAPEstimator>(new EAPEstimator(integrator, questionSet));
+	    if (estimation_default == "EAP") {
+	      if (grid_eap) return std::unique_ptr<GridEAPEstimator>(new GridEAPEstimator(integrator, questionSet, control));
+	      return std::unique_ptr<EAPEstimator>(new EAPEstimator(integrator, questionSet));
+	    }
 	  } 
 	  else if (estimation_type == "MLE") {
 	    return std::unique_ptr<MLEEstimator>(new MLEEstimator(integrator, questionSet));
@@ -309,18 +887,24 @@ std::unique_ptr<Estimator> Cat::createEstimator(S4 &cat_df, Integrator &integrat
  * into a separate factory with registration.
  */
 std::unique_ptr<Selector> Cat::createSelector(std::string selection_type, QuestionSet &questionSet,
-                                              Estimator &estimator, Prior &prior) {
+                                              Estimator &estimator, Prior &prior, const CatControl &control,
+                                              const InfoTable *info_table, const InfoBounds *info_bounds,
+                                              ScreenDiagnostics *screen_diagnostics) {
+	// Without diagnostics to record them in, screened selections are never audited
+	const Screen screen{size_t(control.screen), screen_diagnostics ? size_t(control.screenAudit) : 0,
+	                    screen_diagnostics};
 
 	if (selection_type == "EPV") {
-		return std::unique_ptr<EPVSelector>(new EPVSelector(questionSet, estimator, prior));
+		return std::unique_ptr<EPVSelector>(new EPVSelector(questionSet, estimator, prior, screen));
 	}
 
 	if (selection_type == "MFI") {
-		return std::unique_ptr<MFISelector>(new MFISelector(questionSet, estimator, prior));
+		return std::unique_ptr<MFISelector>(new MFISelector(questionSet, estimator, prior, info_table,
+		                                                    size_t(control.infoTableRefine), info_bounds));
 	}
 
 	if (selection_type == "MEI") {
-		return std::unique_ptr<MEISelector>(new MEISelector(questionSet, estimator, prior));
+		return std::unique_ptr<MEISelector>(new MEISelector(questionSet, estimator, prior, screen));
 	}
 	
 	if (selection_type == "MPWI") {
@@ -332,7 +916,7 @@ std::unique_ptr<Selector> Cat::createSelector(std::string selection_type, Questi
 	}
 	
 	if (selection_type == "KL") {
-		return std::unique_ptr<KLSelector>(new KLSelector(questionSet, estimator, prior));
+		return std::unique_ptr<KLSelector>(new KLSelector(questionSet, estimator, prior, screen));
 	}
 	
 	if (selection_type == "LKL") {
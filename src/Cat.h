@@ -1,11 +1,21 @@
 #pragma once
 #include <Rcpp.h>
+#include <functional>
+#include <atomic>
+#include <future>
+#include <thread>
 #include <memory>
 #include "Prior.h"
 #include "QuestionSet.h"
 #include "Estimator.h"
 #include "Selector.h"
 #include "CheckRules.h"
+#include "CatControl.h"
+#include "ResponseMatrix.h"
+#include "CatTree.h"
+#include "SelectionCache.h"
+#include "InfoTable.h"
+#include "InfoBounds.h"
 #include "MAPEstimator.h"
 using namespace Rcpp;
 
@@ -19,6 +29,24 @@ public:
 
 	Cat(S4 cat_df);
 
+	Cat(S4 cat_df, const CatControl &control);
+
+	/**
+	 * Copies the answers and settings of other, with a new estimator and selector bound to the copy, so that
+	 * the two can be used independently (e.g. on different threads). The copy does not use other's
+	 * SelectionCache.
+	 */
+	Cat(const Cat &other);
+
+	/**
+	 * Cancels any speculation still running for the Cat and waits for its thread to stop.
+	 */
+	~Cat();
+
+	/**
+	 * With control.cache, estimateTheta, estimateSE and selectItem first look for the result in the
+	 * SelectionCache, and store it there when it is computed.
+	 */
 	double estimateTheta();
 
 	double estimateSE();
@@ -37,8 +65,16 @@ public:
 
 	double expectedObsInf(int item);
 	
+	/**
+	 * With control.speculate, also starts selecting the item to follow each answer to the selected item in
+	 * the background; storeAnswer then picks up the result for the answer given.
+	 */
 	Rcpp::List selectItem();
 	
+	/**
+	 * The item selectItem would give after each answer to item, found on copies of the Cat, which is left
+	 * unchanged.
+	 */
 	Rcpp::List lookAhead(int item);
 	
 	bool checkStopRules();
@@ -59,18 +95,153 @@ public:
 
 	NumericVector simulateThetas(DataFrame& responses);
 
+	/**
+	 * Returns the branching tree as a nested list, or as a table of answer profiles when flat is true.
+	 */
+	SEXP makeTree(bool flat);
+
+	/**
+	 * Writes the branching tree to file in the format read by TreeFile, with each node's theta and SE if
+	 * estimates is true.
+	 */
+	void writeTree(const std::string &file, bool estimates);
+
+	/**
+	 * Records an answer for a single item (zero-indexed) and refreshes the estimator if the change in answers
+	 * means a different estimation approach applies (e.g. MLE falling back to estimationDefault). This allows a
+	 * Cat to be kept alive across respondent steps rather than being rebuilt from the S4 object each time.
+	 */
+	void storeAnswer(size_t item, int answer);
+
+	size_t numberOfItems() const;
+
+	/**
+	 * Whether other reads its item parameters from the same ItemBank as this Cat (see ItemBank::intern).
+	 */
+	bool sharesItemBank(const Cat &other) const;
+
+	/**
+	 * Writes the SelectionCache used by the Cat to file, or adds the entries of file to it. Both throw if the
+	 * Cat was created without control.cache.
+	 */
+	void saveCache(const std::string &file);
+	void loadCache(const std::string &file);
+
+	/**
+	 * The counts of ScreenDiagnostics for the Cat and its copies, as a list. Throws if the Cat was created
+	 * without control.screen.
+	 */
+	Rcpp::List screenDiagnostics() const;
+
 private:
 	bool noneOfOverrides(double se);
 	bool anyOfThresholds(double se);
 
+	/**
+	 * Administers items to respondent row until the stopping rules are met, taking answers from responses
+	 * (NA for items the respondent did not answer), and returns the final estimate. The answers are then
+	 * reset to what they were before the call.
+	 */
+	double simulateRespondent(const ResponseMatrix &responses, size_t row);
+
+	/**
+	 * Replaces the answers with those of respondent row and returns the estimate, using the estimator the
+	 * Cat would be created with for those answers.
+	 */
+	double estimateRespondent(const ResponseMatrix &responses, size_t row);
+
+	/**
+	 * Calls task(session, i) for i in [0, count), where session is a copy of this Cat shared by the tasks a
+	 * worker runs one after another; see estimateThetas, simulateThetas and buildTree.
+	 */
+	struct SessionWorker;
+	void forEachSession(size_t count, const std::function<void(Cat &, size_t)> &task, bool parallel);
+
+	/**
+	 * Runs one of the functions above for each of rows, returning the estimates in the same order.
+	 */
+	std::vector<double> forEachRespondent(const ResponseMatrix &responses, const std::vector<size_t> &rows,
+	                                      double (Cat::*respondent)(const ResponseMatrix &, size_t), bool parallel);
+
+	/**
+	 * Recreates the estimator and selector when MLE or WLE starts or stops falling back to estimationDefault, and
+	 * syncs the estimator with the answers. Called whenever the answers change.
+	 */
+	void refreshEstimator();
+
+	/**
+	 * The answers that branch from item in makeTree: -1 (skipped) followed by each response option.
+	 */
+	std::vector<int> responseOptions(int item) const;
+
+	/**
+	 * Selects the item for every possible sequence of answers from the current ones until lengthThreshold
+	 * items are answered, expanding the branches of each level in parallel. estimates also stores theta and
+	 * SE for every node.
+	 */
+	CatTree buildTree(bool estimates);
+
+	/**
+	 * Replaces the answers with initial_answers plus the answers leading to node.
+	 */
+	void loadBranch(const CatTree &tree, size_t node, const std::vector<int> &initial_answers);
+
+	/**
+	 * The selection after each of answers to item, each made on a copy of the Cat. Once cancelled is set, the
+	 * selections not yet finished stop at their next item and are left empty.
+	 */
+	std::vector<Selection> selectionsAfter(int item, const std::vector<int> &answers,
+	                                       const std::atomic<bool> *cancelled = nullptr);
+
+	/**
+	 * Starts selectionsAfter for every response option of item on a snapshot of the Cat, on speculation_thread,
+	 * after joining the thread of the previous speculation.
+	 */
+	void speculate(int item);
+
+	/**
+	 * Cancels a running speculation and drops it without waiting for it to finish. The selectors check the
+	 * cancellation between items, so its thread stops soon after.
+	 */
+	void discardSpeculation();
+
+	/**
+	 * A fingerprint of the items, answers and settings the Cat was created with, which identifies the Cats
+	 * that make the same selections from the same answers.
+	 */
+	std::uint64_t configurationFingerprint() const;
+
+	SelectionCache &selectionCache();
+
 
 private:
 
+	std::string estimation_type;
+	std::string estimation_default;
+	std::string selection_type;
+	CatControl control;
+
 	QuestionSet questionSet;
 	Integrator integrator;
 	Prior prior;
 	CheckRules checkRules;
 
+	/**
+	 * The information table MFI selection interpolates in, when control.infoTable is set (nullptr otherwise).
+	 */
+	std::shared_ptr<const InfoTable> info_table;
+
+	/**
+	 * The information bounds MFI selection searches by, when control.infoBound is set (nullptr otherwise).
+	 */
+	std::shared_ptr<const InfoBounds> info_bounds;
+
+	/**
+	 * How the screened EPV, MEI, and KL selections compared with full ones, when control.screen is set (nullptr
+	 * otherwise).
+	 */
+	std::shared_ptr<ScreenDiagnostics> screen_diagnostics;
+
 
 	/**
 	 * In C++, an object of abstract type may not be used an an instance variable. This is because, by virtue of
@@ -90,16 +261,48 @@ private:
 	std::unique_ptr<Estimator> estimator;
 	std::unique_ptr<Selector> selector;
 
+	/**
+	 * True when estimation is MLE or WLE but the current answers require estimationDefault instead.
+	 */
+	bool using_default_estimator;
+	bool usesDefaultEstimator() const;
+
+	/**
+	 * The item whose answers are being speculated on (-1 for none), those answers, and the selections for
+	 * them. next_selection holds the selection for the current answers when it came from a speculation.
+	 */
+	int speculated_item;
+	std::vector<int> speculated_answers;
+	std::future<std::vector<Selection> > speculation;
+	std::shared_ptr<std::atomic<bool> > speculation_cancelled;
+	/**
+	 * The thread of the last speculation; the Cat joins it before starting another and when it is destroyed.
+	 */
+	std::thread speculation_thread;
+	std::unique_ptr<Selection> next_selection;
+
+	/**
+	 * The cache shared with other Cats of the same configuration (nullptr without control.cache), and the
+	 * path of the current answers in it: each answer that differs from the initial ones, in the order stored.
+	 */
+	std::shared_ptr<SelectionCache> cache;
+	SelectionCache::Path cache_path;
+	std::vector<int> cache_base_answers;
+
 	/**
 	 * These methods are used to create the proper instances for estimator and selector. Ideally, they would be members
 	 * of their respective classes, but, because they currently use a naive, string-comparison-based method of
 	 * determining which subtype to instantiate, that task is harder than it should be. In the future, this would be
 	 * a good refactoring to do.
 	 */
-	static std::unique_ptr<Estimator> createEstimator(S4 &cat_df, Integrator &integrator, QuestionSet &questionSet);
+	static std::unique_ptr<Estimator> createEstimator(std::string estimation_type, std::string estimation_default,
+	                                                  const CatControl &control, Integrator &integrator,
+	                                                  QuestionSet &questionSet);
 	static std::unique_ptr<Selector> createSelector(std::string selection_type, QuestionSet &questionSet,
 	                                                Estimator &estimator,
-	                                                Prior &prior);
+	                                                Prior &prior, const CatControl &control,
+	                                                const InfoTable *info_table, const InfoBounds *info_bounds,
+	                                                ScreenDiagnostics *screen_diagnostics);
 
 
 };
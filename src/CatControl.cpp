@@ -0,0 +1,108 @@
+#include "CatControl.h"
+
+
+namespace {
+
+/**
+ * value as TRUE or FALSE, stopping with an error naming the option if it is NA.
+ */
+bool logicalOption(SEXP value, const std::string &name) {
+	int logical = Rcpp::as<int>(value);
+	if (logical == NA_INTEGER) {
+		Rcpp::stop("%s must be TRUE or FALSE.", name);
+	}
+	return logical != 0;
+}
+
+}
+
+CatControl::CatControl() : quadrature("adaptive"), quadraturePoints(61), deduplicate(true), speculate(false),
+                           cache(false), cacheSize(10000), infoTable(false), infoTablePoints(401),
+                           infoTableRefine(5), infoBound(false), infoBoundBins(50),
+                           screen(0), screenAudit(0) { }
+
+CatControl::CatControl(Rcpp::List &control) : CatControl() {
+	if (control.size() == 0) {
+		return;
+	}
+
+	if (Rf_isNull(control.names())) {
+		Rcpp::stop("control must be a named list.");
+	}
+	Rcpp::CharacterVector names = control.names();
+
+	for (int i = 0; i < control.size(); ++i) {
+		std::string name(names[i]);
+
+		if (name == "quadrature") {
+			quadrature = Rcpp::as<std::string>(control[i]);
+			if (quadrature != "adaptive" && quadrature != "hermite" && quadrature != "rectangular") {
+				Rcpp::stop("%s is not a valid quadrature. Use \"adaptive\", \"hermite\", or \"rectangular\".", quadrature);
+			}
+		}
+		else if (name == "quadraturePoints") {
+			quadraturePoints = Rcpp::as<int>(control[i]);
+			if (quadraturePoints == NA_INTEGER || quadraturePoints < 2 || quadraturePoints > 200) {
+				Rcpp::stop("quadraturePoints must be between 2 and 200.");
+			}
+		}
+		else if (name == "deduplicate") {
+			deduplicate = logicalOption(control[i], name);
+		}
+		else if (name == "speculate") {
+			speculate = logicalOption(control[i], name);
+		}
+		else if (name == "cache") {
+			cache = logicalOption(control[i], name);
+		}
+		else if (name == "cacheSize") {
+			cacheSize = Rcpp::as<int>(control[i]);
+			if (cacheSize == NA_INTEGER || cacheSize < 1) {
+				Rcpp::stop("cacheSize must be a positive integer.");
+			}
+		}
+		else if (name == "infoTable") {
+			infoTable = logicalOption(control[i], name);
+		}
+		else if (name == "infoTablePoints") {
+			infoTablePoints = Rcpp::as<int>(control[i]);
+			if (infoTablePoints == NA_INTEGER || infoTablePoints < 2 || infoTablePoints > 100000) {
+				Rcpp::stop("infoTablePoints must be between 2 and 100000.");
+			}
+		}
+		else if (name == "infoTableRefine") {
+			infoTableRefine = Rcpp::as<int>(control[i]);
+			if (infoTableRefine == NA_INTEGER || infoTableRefine < 1) {
+				Rcpp::stop("infoTableRefine must be a positive integer.");
+			}
+		}
+		else if (name == "infoBound") {
+			infoBound = logicalOption(control[i], name);
+		}
+		else if (name == "infoBoundBins") {
+			infoBoundBins = Rcpp::as<int>(control[i]);
+			if (infoBoundBins == NA_INTEGER || infoBoundBins < 1 || infoBoundBins > 10000) {
+				Rcpp::stop("infoBoundBins must be between 1 and 10000.");
+			}
+		}
+		else if (name == "screen") {
+			screen = Rcpp::as<int>(control[i]);
+			if (screen == NA_INTEGER || screen < 0) {
+				Rcpp::stop("screen must be a nonnegative integer.");
+			}
+		}
+		else if (name == "screenAudit") {
+			screenAudit = Rcpp::as<int>(control[i]);
+			if (screenAudit == NA_INTEGER || screenAudit < 0) {
+				Rcpp::stop("screenAudit must be a nonnegative integer.");
+			}
+		}
+		else {
+			Rcpp::stop("%s is not a valid control option.", name);
+		}
+	}
+
+	if (infoTable && infoBound) {
+		Rcpp::stop("infoTable and infoBound cannot both be TRUE.");
+	}
+}
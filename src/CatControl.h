@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include <Rcpp.h>
+
+
+/**
+ * Options for the compiled code that are not part of the Cat class. They are passed from R as a named list
+ * (the control argument), so that new options do not change the slots of existing Cat objects.
+ * Any element not present in the list keeps its default value.
+ */
+struct CatControl {
+
+	/**
+	 * How EAP estimates are integrated: "adaptive" uses GSL's adaptive quadrature over
+	 * [lowerBound, upperBound]; "hermite" and "rectangular" keep the posterior on a fixed grid of
+	 * quadraturePoints nodes, which is updated as answers are stored.
+	 */
+	std::string quadrature;
+	int quadraturePoints;
+
+	/**
+	 * Whether estimateThetas estimates each distinct answer pattern once and copies the estimate to the
+	 * other respondents with the same answers.
+	 */
+	bool deduplicate;
+
+	/**
+	 * Whether a session starts selecting the item to follow every answer to the item it has just selected,
+	 * in the background, so that the selection after the answer is stored is already available.
+	 */
+	bool speculate;
+
+	/**
+	 * Whether a session looks up its selections and estimates in, and adds them to, the SelectionCache
+	 * shared by the sessions with the same configuration, and the number of answer paths that cache keeps.
+	 */
+	bool cache;
+	int cacheSize;
+
+	/**
+	 * Whether MFI selection interpolates each item's information in an InfoTable of infoTablePoints grid
+	 * points, computing it exactly only for the infoTableRefine items that interpolate highest (and any others
+	 * that interpolate at least as high as the best exact value).
+	 */
+	bool infoTable;
+	int infoTablePoints;
+	int infoTableRefine;
+
+	/**
+	 * Whether MFI selection searches the items in decreasing order of their InfoBounds over infoBoundBins bins,
+	 * stopping once no remaining item can beat the best one found, which selects exactly the item a full scan
+	 * would. It cannot be combined with infoTable.
+	 */
+	bool infoBound;
+	int infoBoundBins;
+
+	/**
+	 * The number of items with the most Fisher information that EPV, MEI, and KL selection compute their
+	 * criterion for (0 for every item), and how often a screened selection is audited against the full one
+	 * (every screenAudit-th selection, or never for 0). See Screen.
+	 */
+	int screen;
+	int screenAudit;
+
+	CatControl();
+
+	CatControl(Rcpp::List &control);
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/**
+ * A node of a precomputed branching tree (see Cat::makeTree). The children of a node are stored next to each
+ * other, one for each response option of the node's item in the order -1 (skipped), then the lowest to the
+ * highest answer, so the child for an answer is found without searching.
+ */
+struct TreeNode {
+	/**
+	 * The item (zero-indexed) asked at this node, or -1 when every item has been answered before reaching it.
+	 */
+	int item;
+	/**
+	 * The answer to the parent's item that leads to this node, and the index of the parent (-1 for the root).
+	 */
+	int answer;
+	int parent;
+	/**
+	 * Children of the node, none for the leaves at the end of a branch.
+	 */
+	std::size_t first_child;
+	std::size_t child_count;
+	/**
+	 * Estimates from the answers leading to the node, NA unless they were requested from buildTree.
+	 */
+	double theta;
+	double se;
+};
+
+typedef std::vector<TreeNode> CatTree;
@@ -1,96 +1,147 @@
 #include "EAPEstimator.h"
-#include "GSLFunctionWrapper.h"
-
-double EAPEstimator::estimateTheta(Prior prior) {
-
-	/**
-	 * Because these denominator and numerator functions
-	 * are used nowhere else, it makes sense to give them
-	 * the smallest scope possible. As a result, they are
-	 * declared as lambdas. They capture by reference because
-	 * they need access to prior and likelihood, but, because
-	 * they are passed to GSL's integration function, cannot
-	 * take prior and likelihood as arguments.
-	 */
-	integrableFunction numerator = [&](double theta) {
-	  return theta * likelihood(theta) * prior.prior(theta);
-	};
-	
-	integrableFunction denominator = [&](double theta) {
-		return likelihood(theta) * prior.prior(theta);
-	};
+#include <algorithm>
+
+double EAPEstimator::estimateTheta(Prior prior) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return estimateTheta<GRMModel>(prior);
+	case ModelType::GPCM:
+		return estimateTheta<GPCMModel>(prior);
+	default:
+		return estimateTheta<BinaryModel>(prior);
+	}
+}
 
+double EAPEstimator::estimateTheta(Prior prior, size_t question, int answer) const{
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return estimateTheta<GRMModel>(prior, question, answer);
+	case ModelType::GPCM:
+		return estimateTheta<GPCMModel>(prior, question, answer);
+	default:
+		return estimateTheta<BinaryModel>(prior, question, answer);
+	}
+}
 
-	
-	return integralQuotient(numerator, denominator, questionSet.lowerBound, questionSet.upperBound);
+double EAPEstimator::estimateSE(Prior prior) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return estimateSE<GRMModel>(prior);
+	case ModelType::GPCM:
+		return estimateSE<GPCMModel>(prior);
+	default:
+		return estimateSE<BinaryModel>(prior);
+	}
 }
 
-double EAPEstimator::estimateTheta(Prior prior, size_t question, int answer){
-	integrableFunction numerator = [&](double theta) {
-	  return theta * likelihood(theta,question,answer) * prior.prior(theta);
-	};
-	
-	integrableFunction denominator = [&](double theta) {
-		return likelihood(theta,question,answer) * prior.prior(theta);
-	};
-	
-	return integralQuotient(numerator, denominator, questionSet.lowerBound, questionSet.upperBound);
+double EAPEstimator::estimateSE(Prior prior, size_t question, int answer) const {
+	return estimateSE(prior, question, answer, priorCenter(prior));
 }
 
-double EAPEstimator::estimateSE(Prior prior) {
-	const double theta_hat = estimateTheta(prior);
+double EAPEstimator::hypotheticalSE(const SelectionContext &context, size_t question, int answer) const {
+	Prior prior = context.prior;
+	return estimateSE(prior, question, answer, context.theta);
+}
 
-	integrableFunction denominator = [&](double theta) {
-		return likelihood(theta) * prior.prior(theta);
-	};
+double EAPEstimator::estimateSE(Prior &prior, size_t question, int answer, double center) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return estimateSE<GRMModel>(prior, question, answer, center);
+	case ModelType::GPCM:
+		return estimateSE<GPCMModel>(prior, question, answer, center);
+	default:
+		return estimateSE<BinaryModel>(prior, question, answer, center);
+	}
+}
 
-	integrableFunction numerator = [&](double theta) {
-		const double theta_difference = theta - theta_hat;
-		return theta_difference * theta_difference * denominator(theta);
+template <class Model>
+double EAPEstimator::estimateTheta(Prior &prior) const {
+	auto logLikelihood = [&](double theta) {
+		return model_logLikelihood<Model>(theta);
 	};
-
-	return std::pow(integralQuotient(numerator, denominator, questionSet.lowerBound, questionSet.upperBound), 0.5);
+	return posteriorMoments(logLikelihood, prior, 0.0, nullptr);
 }
 
-double EAPEstimator::estimateSE(Prior prior, size_t question, int answer) {
-	const double theta_hat = estimateTheta(prior,question,answer);
-
-	integrableFunction denominator = [&](double theta) {
-		return likelihood(theta,question,answer) * prior.prior(theta);
+template <class Model>
+double EAPEstimator::estimateTheta(Prior &prior, size_t question, int answer) const{
+	auto logLikelihood = [&](double theta) {
+		return model_logLikelihood<Model>(theta, question, answer);
 	};
+	return posteriorMoments(logLikelihood, prior, 0.0, nullptr);
+}
 
-	integrableFunction numerator = [&](double theta) {
-		const double theta_difference = theta - theta_hat;
-		return theta_difference * theta_difference * denominator(theta);
+template <class Model>
+double EAPEstimator::estimateSE(Prior &prior) const {
+	auto logLikelihood = [&](double theta) {
+		return model_logLikelihood<Model>(theta);
 	};
+	double variance;
+	posteriorMoments(logLikelihood, prior, priorCenter(prior), &variance);
+	return std::pow(variance, 0.5);
+}
 
-	return std::pow(integralQuotient(numerator, denominator, questionSet.lowerBound, questionSet.upperBound), 0.5);
+template <class Model>
+double EAPEstimator::estimateSE(Prior &prior, size_t question, int answer, double center) const {
+	auto logLikelihood = [&](double theta) {
+		return model_logLikelihood<Model>(theta, question, answer);
+	};
+	double variance;
+	posteriorMoments(logLikelihood, prior, center, &variance);
+	return std::pow(variance, 0.5);
 }
 
-double EAPEstimator::integralQuotient(integrableFunction const &numerator,
-                                   integrableFunction const &denominator,
-                                   const double lower, const double upper) {
+template <class LogLikelihood>
+double EAPEstimator::posteriorMoments(const LogLikelihood &logLikelihood, Prior &prior, double center,
+                                      double *variance) const {
 	/*
-	 * Because GSL is a C library, not a C++ library, it is not easy to pass arbitrary
-	 * C++ functions to GSL's integration routine. To solve this, wrap the arbitrary functions
-	 * in a GSLFunctionWrapper, which is integrable.
+	 * The mean and variance are quotients of integrals of the same posterior density, so the likelihood is
+	 * evaluated once per point for all of them instead of once per integral.
 	 */
-	auto gslnum = GSLFunctionWrapper(numerator);
-  gsl_function *numeratorFunction = gslnum.asGSLFunction();
-  const double top = integrator.integrate(numeratorFunction, integrationSubintervals, lower, upper);
-  
-  auto gsldenom = GSLFunctionWrapper(denominator);
-  gsl_function *denominatorFunction = gsldenom.asGSLFunction();
-  const double bottom = integrator.integrate(denominatorFunction, integrationSubintervals, lower, upper);
-  
-  return top / bottom;
+	const size_t moments = variance == nullptr ? 2 : 3;
+	auto density = [&](double theta, double *values) {
+		const double value = exp(logLikelihood(theta)) * prior.prior(theta);
+		values[0] = value;
+		values[1] = theta * value;
+		if (moments == 3) {
+			const double deviation = theta - center;
+			values[2] = deviation * deviation * value;
+		}
+	};
+
+	double integrals[3];
+	double mean;
+	for (int pass = 0; ; ++pass) {
+		integrator.integrate(density, moments, integrationSubintervals, questionSet.bank->lowerBound,
+		                     questionSet.bank->upperBound, integrals);
+		mean = integrals[1] / integrals[0];
+		if (variance == nullptr) {
+			break;
+		}
+
+		// E[(theta - center)^2] less the square of the shift from center to the mean, which loses the digits of
+		// the second moment that the shift takes up. A shift larger than the posterior's SD, as when a narrow
+		// posterior is far from the prior, would take up most of them, so the moments are integrated once more
+		// about the mean just found. Rounding can still leave the variance a hair below zero.
+		const double shift = mean - center;
+		const double centered = integrals[2] / integrals[0] - shift * shift;
+		if (pass == 0 && shift * shift > centered) {
+			center = mean;
+			continue;
+		}
+		*variance = std::max(0.0, centered);
+		break;
+	}
+	return mean;
 }
 
 
 
+double EAPEstimator::priorCenter(const Prior &prior) {
+	return prior.type() == PriorType::UNIFORM ? (prior.param0() + prior.param1()) / 2.0 : prior.param0();
+}
+
 EstimationType EAPEstimator::getEstimationType() const {
 	return EstimationType::EAP;
 }
 
-EAPEstimator::EAPEstimator(Integrator &integrator, QuestionSet &questionSet) : Estimator(integrator, questionSet) { }
-
+EAPEstimator::EAPEstimator(Integrator &integrator, const QuestionSet &questionSet) : Estimator(integrator, questionSet) { }
@@ -9,26 +9,39 @@ class EAPEstimator : public Estimator {
 
 public:
 
-	EAPEstimator(Integrator &integrator, QuestionSet &questionSet);
+	EAPEstimator(Integrator &integrator, const QuestionSet &questionSet);
 
 	virtual EstimationType getEstimationType() const override;
 
-	virtual double estimateTheta(Prior prior) override;
-	virtual double estimateTheta(Prior prior, size_t question, int answer) override;
+	virtual double estimateTheta(Prior prior) const override;
+	virtual double estimateTheta(Prior prior, size_t question, int answer) const override;
 	
-	virtual double estimateSE(Prior prior) override;
-	virtual double estimateSE(Prior prior, size_t question, int answer) override;
+	virtual double estimateSE(Prior prior) const override;
+	virtual double estimateSE(Prior prior, size_t question, int answer) const override;
+
+	/**
+	 * The SE with one hypothetical answer, with the second moment taken about context.theta (see
+	 * posteriorMoments).
+	 */
+	virtual double hypotheticalSE(const SelectionContext &context, size_t question, int answer) const override;
 	
 protected:
-	typedef std::function<double(double)> integrableFunction;
+	/**
+	 * Integrates the likelihood times the prior, times theta and (if variance is not null) the squared distance
+	 * of theta from center, in one pass of quadrature, and returns the posterior mean of theta. variance receives
+	 * the posterior variance. The variance is exact for any center, but the closer center is to the mean, the less
+	 * of the second moment is cancelled by the correction for the difference, so callers pass a value near theta
+	 * that is already known: the current estimate when there is one, and the center of the prior otherwise. When
+	 * the mean turns out to be more than a posterior SD from center, the moments are integrated a second time about
+	 * the mean.
+	 */
+	template <class LogLikelihood>
+	double posteriorMoments(const LogLikelihood &logLikelihood, Prior &prior, double center, double *variance) const;
 
 	/**
-	* Computes the quotient of the integrals of the functions provided
-	* - that is, it computes: ∫(numerator) / ∫(denominator).
-	*/
-	double integralQuotient(const integrableFunction &numerator,
-	                        const integrableFunction &denominator,
-                          const double lower, const double upper);
+	 * The mean of a normal or t prior, and the midpoint of a uniform one.
+	 */
+	static double priorCenter(const Prior &prior);
 	
 private:
 	/**
@@ -38,4 +51,14 @@ private:
 	 */
 	constexpr static double integrationSubintervals = 10;
 
+	template <class Model> double estimateTheta(Prior &prior) const;
+	template <class Model> double estimateTheta(Prior &prior, size_t question, int answer) const;
+	template <class Model> double estimateSE(Prior &prior) const;
+	template <class Model> double estimateSE(Prior &prior, size_t question, int answer, double center) const;
+
+	/**
+	 * The SE with one hypothetical answer, integrating the second moment about center.
+	 */
+	double estimateSE(Prior &prior, size_t question, int answer, double center) const;
+
 };
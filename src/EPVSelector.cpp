@@ -1,11 +1,11 @@
 #include "EPVSelector.h"
 #include "ParallelUtil.h"
 
-struct EPV_ltm_tpm : public mpl::FunctionCaller<Prior>
+struct EPV_ltm_tpm : public mpl::FunctionCaller<SelectionContext>
 {
-	using Base = mpl::FunctionCaller<Prior>;
+	using Base = mpl::FunctionCaller<SelectionContext>;
 
-	EPV_ltm_tpm(Estimator& e, Prior& p):Base{e,p}{}
+	EPV_ltm_tpm(const Estimator& e, SelectionContext& c):Base{e,c}{}
 
 	double operator()(int question)
 	{
@@ -13,11 +13,11 @@ struct EPV_ltm_tpm : public mpl::FunctionCaller<Prior>
 	}
 };
 
-struct EPV_grm: public mpl::FunctionCaller<Prior>
+struct EPV_grm: public mpl::FunctionCaller<SelectionContext>
 {
-	using Base = mpl::FunctionCaller<Prior>;
+	using Base = mpl::FunctionCaller<SelectionContext>;
 
-	EPV_grm(Estimator& e, Prior& p):Base{e,p}{}
+	EPV_grm(const Estimator& e, SelectionContext& c):Base{e,c}{}
 
 	double operator()(int question)
 	{
@@ -25,11 +25,11 @@ struct EPV_grm: public mpl::FunctionCaller<Prior>
 	}
 };
 
-struct EPV_gpcm: public mpl::FunctionCaller<Prior>
+struct EPV_gpcm: public mpl::FunctionCaller<SelectionContext>
 {
-	using Base = mpl::FunctionCaller<Prior>;
+	using Base = mpl::FunctionCaller<SelectionContext>;
 
-	EPV_gpcm(Estimator& e, Prior& p):Base{e,p}{}
+	EPV_gpcm(const Estimator& e, SelectionContext& c):Base{e,c}{}
 
 	double operator()(int question)
 	{
@@ -46,7 +46,7 @@ Selection EPVSelector::selectItem() {
 	selection.name = getSelectionName();
 	selection.questions = questionSet.nonapplicable_rows;
 
-	selection.values.resize(selection.questions.size());
+	SelectionContext context = estimator.selectionContext(prior);
 
 	/**
 	if ((questionSet.model == "ltm") || (questionSet.model == "tpm"))
@@ -61,31 +61,30 @@ Selection EPVSelector::selectItem() {
 	}
 	**/
 
-	if((questionSet.model == "ltm") || (questionSet.model == "tpm"))
-	{
-		mpl::ParallelHelper<EPV_ltm_tpm> helper(selection.questions, selection.values, estimator, prior);
-  		RcppParallel::parallelFor(0, selection.questions.size(), helper);
-	}
-	else if (questionSet.model == "grm")
-	{
-		mpl::ParallelHelper<EPV_grm> helper(selection.questions, selection.values, estimator, prior);
-  		RcppParallel::parallelFor(0, selection.questions.size(), helper);
-	}
-	else
-	{
-		mpl::ParallelHelper<EPV_gpcm> helper(selection.questions, selection.values, estimator, prior);
-  		RcppParallel::parallelFor(0, selection.questions.size(), helper);
-	}
-
-	
-	auto qn_name = [&](int question){return this->questionSet.question_names.at(question);};
+	auto evaluate = [&](const std::vector<int> &questions, std::vector<double> &values) {
+		if (isBinary(questionSet.bank->model_type))
+		{
+			mpl::ParallelHelper<EPV_ltm_tpm> helper(questions, values, estimator, context);
+	  		mpl::parallelFor(0, questions.size(), helper);
+		}
+		else if (questionSet.bank->model_type == ModelType::GRM)
+		{
+			mpl::ParallelHelper<EPV_grm> helper(questions, values, estimator, context);
+	  		mpl::parallelFor(0, questions.size(), helper);
+		}
+		else
+		{
+			mpl::ParallelHelper<EPV_gpcm> helper(questions, values, estimator, context);
+	  		mpl::parallelFor(0, questions.size(), helper);
+		}
+	};
+	selectScreened(selection, context.theta, true, evaluate);
+
+	auto qn_name = [&](int question){return this->questionSet.bank->names.at(question);};
 
 	selection.question_names.resize(selection.questions.size());
 	std::transform(selection.questions.begin(),selection.questions.end(),selection.question_names.begin(), qn_name);
 
-	auto min_itr = std::min_element(selection.values.begin(), selection.values.end());
-	selection.item = selection.questions[std::distance(selection.values.begin(),min_itr)];
-
 	return selection;
 }
 
@@ -93,8 +92,8 @@ SelectionType  EPVSelector::getSelectionType() {
 	return SelectionType::EPV;
 }
 
-EPVSelector::EPVSelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel) : Selector(questions, estimation,
-                                                                                                      priorModel) { }
+EPVSelector::EPVSelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel,
+                         const Screen &screen) : Selector(questions, estimation, priorModel, screen) { }
 
 std::string EPVSelector::getSelectionName() {
 	return "EPV";
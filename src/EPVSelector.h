@@ -8,7 +8,8 @@ public:
 
 	virtual Selection selectItem();
 
-	EPVSelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel);
+	EPVSelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel,
+	            const Screen &screen = Screen{0, 0, nullptr});
 	
 private:
 	std::string getSelectionName();
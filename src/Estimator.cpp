@@ -1,5 +1,4 @@
 #include "EAPEstimator.h"
-#include "GSLFunctionWrapper.h"
 #include <limits>
 #include <numeric>
 #include <algorithm>
@@ -7,848 +6,94 @@
 #include <gsl/gsl_roots.h>
 #include <gsl/gsl_errno.h>
 
-  
-double Estimator::prob_ltm(double theta, size_t question) {
-	double eps = std::pow(std::pow(2.0, -52.0), 1.0/3.0);
-
-	double difficulty = questionSet.difficulty.at(question).at(0);
-	double exp_prob_bi = exp(difficulty + (questionSet.discrimination.at(question) * theta));
-
-	if(std::isinf(exp_prob_bi))
-	{
-		return 1.0 - eps;
-	}
-
-	double guess = questionSet.guessing.at(question);
-    double result = guess + (1 - guess) * (exp_prob_bi / (1 + exp_prob_bi));
-  
-  	if(result > (1.0 - eps))
-  	{
-	  result = 1.0 - eps;
-	}
-	else if(result < eps)
-	{
-	  result = eps;
-	}
-
-	return result;
-}
-
-struct GrmProb
-{
-	GrmProb(double theta, double discrimination)
-	: theta_desc(theta*discrimination)
-	{}
-
-	double operator()(double difficulty) const
-	{
-		double exp_prob = exp(difficulty - theta_desc);
-
-		if(std::isinf(exp_prob))
-		{
-		 	return 1.0 - eps;
-		}
-
-		double result = exp_prob / (1 + exp_prob);
-		
-		if(result > (1.0 - eps))
-		{
-		  	result = 1.0 - eps;
-		}
-		else if(result < eps)
-		{
-		  	result = eps;
-		}
-		return result;
-	}
-
-private:
-	double eps = std::pow(std::pow(2.0, -52.0), 1.0/3.0);
-	double theta_desc;
-};
-
-std::vector<double> Estimator::prob_grm(double theta, size_t question) {
-	GrmProb calculate{theta, questionSet.discrimination.at(question)};
-
-	std::vector<double> probabilities;
-	probabilities.reserve(questionSet.difficulty.size()+2);
-	probabilities.push_back(0.0);
-
-	for (auto term : questionSet.difficulty.at(question)) {
-		probabilities.push_back(calculate(term));
-	}
-
-	probabilities.push_back(1.0);
-
-	// checking for repeated elements
-  	auto it = std::adjacent_find(probabilities.begin(), probabilities.end());
-  	if(it != probabilities.end()){
-    	throw std::domain_error("Theta value too extreme for numerical routines.");
-  	}
-
-	return probabilities;
-}
-
-std::pair<double,double> Estimator::prob_grm_pair(double theta, size_t question, size_t at)
-{
-	// Returns prob at at-1 and at
-	GrmProb calculate{theta, questionSet.discrimination.at(question)};
-	std::pair<double, double> probs;
-
-	auto const& difficulties = questionSet.difficulty.at(question);
-
-	if(at == 1)
-	{
-		probs.first = 0.0;
-	}
-	else
-	{
-		probs.first = calculate(difficulties[at-2]);
-	}
-
-	if(at == difficulties.size()+1)
-	{
-		probs.second = 1.0;
-	}
-	else
-	{
-		probs.second = calculate(difficulties[at-1]);
-	}
-
-	// checking for repeated elements
-  	if(probs.first == probs.second)
-  	{
-    	throw std::domain_error("Theta value too extreme for numerical routines.");
-  	}
-
-	return probs;
-}
-
-std::vector<double> Estimator::prob_gpcm(double theta, size_t question) {
-  	// double xmax = pow(2, 52);
-  	// double eps = pow(2, -52);
-  	// eps = pow(eps, 1.0/3.0);
-    
-  	double discrimination = questionSet.discrimination.at(question);
-  	auto const & categoryparams = questionSet.difficulty.at(question);
- 
-  	std::vector<double> probabilities;
-  	probabilities.reserve(categoryparams.size()+1); 	
-
-  	double sum = discrimination * theta;
-  	double denominator = exp(sum);
-  	probabilities.push_back(denominator);
-
-	for (auto cat : categoryparams) {
-	  	sum += discrimination * (theta - cat);
-	  	double num = exp(sum);
-	  	denominator += num;
-		probabilities.push_back(num);
-	}
-	
-	if(denominator == 0.0 or std::isinf(denominator)){
-    	throw std::domain_error("Theta value too extreme for numerical routines.");
-  	}
-
-  	// normalize
-  	for (auto& prob:probabilities)
-  	{
-  		prob /= denominator;
-	}
-  
-	return probabilities;
-}
-
-double Estimator::prob_gpcm_at(double theta, size_t question, size_t at)
-{
-	double discrimination = questionSet.discrimination.at(question);
-  	auto const & categoryparams = questionSet.difficulty.at(question);
-
-  	double sum = discrimination * theta;
-  	double denominator = exp(sum);
-
-  	double result = -1;
-  	if(at == 0)
-  	{
-  		result = denominator;
-
-  		for (auto cat : categoryparams)
-  		{
-		  	sum += discrimination * (theta - cat);
-		  	denominator += exp(sum);
-		}
-	}
-	else
-	{
-		at -= 1;
-		for (size_t i = 0; i != at; ++i)
-  		{
-  			sum += discrimination * (theta - categoryparams[i]);
-		  	denominator += exp(sum);
-  		}
-
-  		sum += discrimination * (theta - categoryparams[at]);
-  		result = exp(sum);
-		denominator += result;
-
-		for (size_t i = at+1; i < categoryparams.size(); ++i)
-  		{
-  			sum += discrimination * (theta - categoryparams[i]);
-		  	denominator += exp(sum);
-  		}
-	}
-	
-	if(denominator == 0.0 or std::isinf(denominator)){
-    	throw std::domain_error("Theta value too extreme for numerical routines.");
-  	}
-
-  	// normalize 
-	return result/denominator;
-}
-
-double Estimator::gpcm_partial_d1LL(double theta, size_t question, int answer) {
-	size_t index = ((size_t)answer) - 1;
-
-	double discrimination = questionSet.discrimination.at(question);
-  	auto const & categoryparams = questionSet.difficulty.at(question);
- 
-	double f = -1;
-	double f_prime = -1;
-	double sum = discrimination * (theta - 0.0);
-  	double g = exp(sum);
-  	double x = discrimination;
-  	double g_prime = g*x;
-
-  	if(index == 0)
-  	{
-  		f = g;
-  		f_prime = g_prime;
-
-  		for (auto cat : categoryparams)
-  		{
-		  	sum += discrimination * (theta - cat);
-	  		double num = exp(sum);
-	  		x += discrimination;
-	  		g += num;
-	  		g_prime += num*x;
-		}
-	}
-	else
-	{
-		index -= 1;
-		for (size_t i = 0; i != index; ++i)
-  		{
-  			sum += discrimination * (theta - categoryparams[i]);
-  			double num = exp(sum);
-	  		x += discrimination;
-	  		g += num;
-	  		g_prime += num*x;
-  		}
-
-  		sum += discrimination * (theta - categoryparams[index]);
-  		f = exp(sum);
-  		x += discrimination;
-	  	f_prime = f*x;
-	  	g += f;
-	  	g_prime += f_prime;
-
-		for (size_t i = index+1; i < categoryparams.size(); ++i)
-  		{
-  			sum += discrimination * (theta - categoryparams[i]);
-		  	double num = exp(sum);
-	  		x += discrimination;
-	  		g += num;
-	  		g_prime += num*x;
-  		}
-	}
-
-	if(g == 0.0 or std::isinf(g)){
-    	throw std::domain_error("Theta value too extreme for numerical routines.");
-  	}
-
-  	return (g*f_prime - f*g_prime)/(g*f);
-}
-
-double Estimator::gpcm_partial_d2LL(double theta, size_t question, int answer) {
-	size_t index = ((size_t)answer) - 1;
-
-	double discrimination = questionSet.discrimination.at(question);
-  	auto const & categoryparams = questionSet.difficulty.at(question);
- 
-	double f = -1;
-	double f_prime = -1;
-	double f_primeprime = -1;
-	double sum = discrimination * (theta - 0.0);
-  	double g = exp(sum);
-  	double x = discrimination;
-  	double g_prime = g*x;
-  	double g_primeprime = g_prime*x;
-
-
-  	if(index == 0)
-  	{
-  		f = g;
-  		f_prime = g_prime;
-  		f_primeprime = g_primeprime;
-
-  		for (auto cat : categoryparams)
-  		{
-		  	sum += discrimination * (theta - cat);
-	  		double num = exp(sum);
-	  		x += discrimination;
-	  		double num_x = num*x;
-	  		g += num;
-	  		g_prime += num_x;
-	  		g_primeprime += num_x*x;
-		}
-	}
-	else
-	{
-		index -= 1;
-		for (size_t i = 0; i != index; ++i)
-  		{
-  			sum += discrimination * (theta - categoryparams[i]);
-  			double num = exp(sum);
-	  		x += discrimination;
-	  		double num_x = num*x;
-	  		g += num;
-	  		g_prime += num_x;
-	  		g_primeprime += num_x*x;
-  		}
-
-  		sum += discrimination * (theta - categoryparams[index]);
-  		f = exp(sum);
-  		x += discrimination;
-	  	f_prime = f*x;
-	  	f_primeprime = f_prime*x;
-	  	g += f;
-	  	g_prime += f_prime;
-	  	g_primeprime += f_primeprime;
-
-		for (size_t i = index+1; i < categoryparams.size(); ++i)
-  		{
-  			sum += discrimination * (theta - categoryparams[i]);
-		  	double num = exp(sum);
-	  		x += discrimination;
-	  		double num_x = num*x;
-	  		g += num;
-	  		g_prime += num_x;
-	  		g_primeprime += num_x*x;
-  		}
-	}
-
-	if(g == 0.0 or std::isinf(g)){
-    	throw std::domain_error("Theta value too extreme for numerical routines.");
-  	}
-
-	double b = g*g;
-	double b2 = b*b;
-	double b_prime = 2.0 * g * g_prime;
-    		
-	double a = g * f_prime - f * g_prime;
-	f_prime = a / b; // p_prime
-
-	double a_prime = f_primeprime * g - g_primeprime * f;
-	f_primeprime = (b * a_prime - a * b_prime) / b2; // p_primeprime
-
-	f /= g; // p
-	
-  	return - ((f_prime*f_prime/f - f_primeprime) / f);
-}
-
-std::vector<double> Estimator::prob_derivs_gpcm_first(double theta, size_t question)
-{
-	double discrimination = questionSet.discrimination.at(question);
-  	auto const & categoryparams = questionSet.difficulty.at(question);
- 
-  	std::vector<double> f;
-  	std::vector<double> f_prime;
-
-  	f.reserve(categoryparams.size()+1);
-  	f_prime.reserve(categoryparams.size()+1); 
-
-  	double sum = discrimination * theta;
-  	double num = exp(sum);
-  	double x = discrimination;
-  	double g = num;
-  	double g_prime = num*x;
-  	f.push_back(num);
-  	f_prime.push_back(g_prime);
-  	
-	for (auto cat : categoryparams) {
-	  	sum += discrimination * (theta - cat);
-	  	double num = exp(sum);
-	  	x += discrimination;
-	  	double num_x = num*x;
-	  	g += num;
-	  	g_prime += num_x;
-		f.push_back(num);
-		f_prime.push_back(num_x);
-	}
-	
-	double b = g*g;
-	for (size_t i = 0; i < f.size(); ++i)
-  	{    
-    	f_prime[i] = (g * f_prime.at(i) - f.at(i) * g_prime) / b;
-	}
-	return f_prime;
-}
-
-
-void Estimator::prob_derivs_gpcm(double theta, size_t question, std::vector<double>& probs, std::vector<double>& first, std::vector<double>& second){
-  	double discrimination = questionSet.discrimination.at(question);
-  	auto const & categoryparams = questionSet.difficulty.at(question);
- 
-  	probs.clear();
-  	probs.reserve(categoryparams.size()+1);
-  	first.clear();
-  	first.reserve(categoryparams.size()+1); 
-  	second.clear();
-  	second.reserve(categoryparams.size()+1); 
-
-  	double sum = discrimination * theta;
-  	double x = discrimination;
-  	double g = exp(sum);
-  	double g_prime = g*x;
-  	double g_primeprime = g_prime*x;
-
-  	probs.push_back(g);
-  	first.push_back(g_prime);
-	second.push_back(g_primeprime);
-  	
-	for (auto cat : categoryparams) {
-	  	sum += discrimination * (theta - cat);
-	  	double num = exp(sum);
-	  	x += discrimination;
-	  	double num_x = num*x;
-	  	double num_xx = num_x*x;
-
-	  	g += num;
-	  	g_prime += num_x;
-	  	g_primeprime += num_xx;
-
-		probs.push_back(num);
-		first.push_back(num_x);
-		second.push_back(num_xx);
-	}
-	
-	double b = g*g;
-	double b2 = b*b;
-	double b_prime = 2.0 * g * g_prime;
-
-  	for (size_t i = 0; i < probs.size(); ++i)
-  	{     		
-  		double a = g * first.at(i) - probs.at(i) * g_prime;
-    	first[i] = a / b;
 
-    	double a_prime = second.at(i) * g - g_primeprime * probs.at(i);
-    	second[i] = (b * a_prime - a * b_prime) / b2;
-
-    	probs[i] /= g;
-	}
-}
-
-std::vector<double> Estimator::probability(double theta, size_t question) {
+std::vector<double> Estimator::probability(double theta, size_t question) const {
   if (question > questionSet.answers.size() ) {
     throw std::domain_error("Must use a question number applicable to Cat object.");
   }
-  
-  	std::vector<double> probabilities;
-
-	if(questionSet.model == "grm") {
-	  	probabilities = prob_grm(theta, question);
-	}
-	else if (questionSet.model == "gpcm"){
-		probabilities = prob_gpcm(theta, question);
-	}
-	else if (questionSet.model == "ltm" || questionSet.model == "tpm")
-	{
-		probabilities.reserve(1);
-		probabilities.push_back(prob_ltm(theta, question));
-	}
-	
-	return probabilities;
-}
-
-
-
-double Estimator::likelihood_grm(double theta) {
-	double L = 0.0;
-
-	for (auto question : questionSet.applicable_rows) {
-		size_t unanswered_question = (size_t) question;
-	  	int answer = questionSet.answers.at(unanswered_question);
-		auto probs = prob_grm_pair(theta, question, answer);
-		L += log(probs.second- probs.first) ;
-	}
-	return exp(L);
-}
-
-double Estimator::likelihood_gpcm(double theta) {
-	double L = 0.0;
-
-	for (auto question : questionSet.applicable_rows) {
-		size_t unanswered_question = (size_t) question;
-	  	size_t answer = questionSet.answers.at(unanswered_question);
-    	// index probabilities correctly using the answer
-    	L += log(prob_gpcm_at(theta, unanswered_question, answer-1));
-	}
-	return exp(L);
-}
-
-double Estimator::likelihood_ltm(double theta) {
-	double L = 0.0;
-	for (auto question : questionSet.applicable_rows) {
-		size_t index = (size_t) question;
-		double prob = prob_ltm(theta, index);
-		int this_answer = questionSet.answers.at(index);
-		L += (this_answer * log(prob)) + ((1 - this_answer) * log(1 - prob));
-	}
-	return exp(L);
-}
-
-double Estimator::likelihood(double theta) {
-  double likelihood = 0.0;
-
-  if ((questionSet.model == "ltm") | (questionSet.model == "tpm")) {
-	  likelihood = likelihood_ltm(theta);
-	}
-	if (questionSet.model == "grm") {
-	  likelihood = likelihood_grm(theta);
-	}
-	if (questionSet.model == "gpcm"){
-		likelihood = likelihood_gpcm(theta);
-	}
-	
-	return likelihood;
-}
-
-
-double Estimator::likelihood_grm(double theta, size_t question, int answer) {
-	double L = 0.0;
-
-	for (auto q : questionSet.applicable_rows) {
-	  	size_t a = (size_t)questionSet.answers.at((size_t) q);
-    	auto probs = prob_grm_pair(theta, q, a);
-		L += log(probs.second - probs.first) ;
-	}
-
-    auto probs = prob_grm_pair(theta, question, answer);
-	L += log(probs.second - probs.first) ;
-
-	return exp(L);
-}
-
-double Estimator::likelihood_gpcm(double theta,size_t question, int answer) {
-	double L = 0.0;
-
-	for (auto q : questionSet.applicable_rows) {
-		size_t unanswered_question = (size_t) q;
-	  	auto a = (size_t)questionSet.answers.at(unanswered_question);
-    	L += log(prob_gpcm_at(theta, unanswered_question, a-1));
-	}
-
-    L += log(prob_gpcm_at(theta, question, ((size_t)answer)-1));
-
-	return exp(L);
-}
-
-double Estimator::likelihood_ltm(double theta,size_t question, int answer) {
-	double L = 0.0;
-	for (auto q : questionSet.applicable_rows) {
-		size_t index = (size_t) q;
-		double prob = prob_ltm(theta, index);
-		int this_answer = questionSet.answers.at(index);
-		L += (this_answer * log(prob)) + ((1 - this_answer) * log(1 - prob));
-	}
-
-	double prob = prob_ltm(theta, question);
-	L += (answer * log(prob)) + ((1 - answer) * log(1 - prob));
-
-	return exp(L);
-}
-
-double Estimator::likelihood(double theta, size_t question, int answer){
-	 double likelihood = 0.0;
-
-  if ((questionSet.model == "ltm") | (questionSet.model == "tpm")) {
-	  likelihood = likelihood_ltm(theta,question,answer);
-	}
-	if (questionSet.model == "grm") {
-	  likelihood = likelihood_grm(theta,question,answer);
-	}
-	if (questionSet.model == "gpcm"){
-		likelihood = likelihood_gpcm(theta,question,answer);
-	}
-	
-	return likelihood;
-}
-
-double Estimator::grm_partial_d2LL(double theta, size_t question) {
-	size_t answer_k = (size_t) questionSet.answers.at(question);
-
-	double P_star1;
-	double P_star2;
-
-	std::tie(P_star2, P_star1) = prob_grm_pair(theta, question, answer_k);
-
-	double P = P_star1 - P_star2;
-
-	double Q_star1 = 1 - P_star1;
-	double Q_star2 = 1 - P_star2;
-
-	double w2 = P_star2 * Q_star2;
-	double w1 = P_star1 * Q_star1;
-	double w = w1 - w2;
-
-	double first_term = (-w2 * (Q_star2 - P_star2) + w1 * (Q_star1 - P_star1)) / P;
-	double second_term = std::pow(w, 2.0) / std::pow(P, 2.0);
-	return first_term - second_term;
-}
-
-double Estimator::grm_partial_d2LL(double theta, size_t question, int answer) {
-	double P_star1;
-	double P_star2;
-
-	std::tie(P_star2, P_star1) = prob_grm_pair(theta, question, answer);
-
-	double P = P_star1 - P_star2;
-
-	double Q_star1 = 1 - P_star1;
-	double Q_star2 = 1 - P_star2;
-
-	double w2 = P_star2 * Q_star2;
-	double w1 = P_star1 * Q_star1;
-	double w = w1 - w2;
-
-	double first_term = (-w2 * (Q_star2 - P_star2) + w1 * (Q_star1 - P_star1)) / P;
-	double second_term = std::pow(w, 2.0) / std::pow(P, 2.0);
-	return first_term - second_term;
-}
-
-double Estimator::gpcm_partial_d2LL(double theta, size_t question) {
-	return gpcm_partial_d2LL(theta,question,questionSet.answers.at(question));
-}
-
-double Estimator::gpcm_partial_d1LL(double theta, size_t question) {
-
-  	return gpcm_partial_d1LL(theta, question, questionSet.answers.at(question));
-}
-
-
-double Estimator::gpcm_d2LL(double theta) {
-  double d2l = 0.0;
-
-	for (auto question : questionSet.applicable_rows) {
-    	d2l += gpcm_partial_d2LL(theta, question);
-	}
-	
-	return d2l;
-}
-
-double Estimator::gpcm_d2LL(double theta, size_t question, int answer) {
-  double d2l = 0.0;
-
-	for (auto q : questionSet.applicable_rows) {
-		int a = questionSet.answers.at(q);
-    	d2l += gpcm_partial_d2LL(theta, q, a);
-	}
-	
-	d2l += gpcm_partial_d2LL(theta, question, answer);
-	
-	return d2l;
-}
-
-double Estimator::grm_d2LL(double theta) {
-	double lambda_theta = 0.0;
-	for (auto question : questionSet.applicable_rows) {
-		const double question_discrimination = std::pow(questionSet.discrimination.at(question), 2.0);
-		const double second_derivative = grm_partial_d2LL(theta, (size_t) question);
-
-		lambda_theta += question_discrimination * second_derivative;
-	}
-	return lambda_theta;
-}
-
-double Estimator::grm_d2LL(double theta, size_t question, int answer) {
-	double lambda_theta = 0.0;
-	for (auto q : questionSet.applicable_rows) {
-		double question_discrimination = std::pow(questionSet.discrimination.at(q), 2.0);
-		int a = questionSet.answers.at(q);
-		double second_derivative = grm_partial_d2LL(theta, (size_t) q, a);
-		lambda_theta += question_discrimination * second_derivative;
-	}
-
-	double question_discrimination = std::pow(questionSet.discrimination.at(question), 2.0);
-	double second_derivative = grm_partial_d2LL(theta, (size_t) question, answer);
-	lambda_theta += question_discrimination * second_derivative;
 
-	return lambda_theta;
+	std::vector<double> probs(probabilityCount(question));
+	probability(theta, question, probs.data());
+	return probs;
 }
 
-double Estimator::ltm_d2LL(double theta) {
-	double lambda_theta = 0.0;
-	for (auto question : questionSet.applicable_rows) {
-		const double P = prob_ltm(theta, (size_t) question);
-		const double guess = questionSet.guessing.at(question);
-		const double Q = 1.0 - P;
-		const double lambda_temp = (P - guess) / (1.0 - guess);
-		const double discrimination = questionSet.discrimination.at(question);
-
-		lambda_theta += std::pow(discrimination, 2.0) * std::pow(lambda_temp, 2.0) * (Q / P);
+size_t Estimator::probabilityCount(size_t question) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return GRMModel::probabilityCount(*questionSet.bank, question);
+	case ModelType::GPCM:
+		return GPCMModel::probabilityCount(*questionSet.bank, question);
+	default:
+		return 1;
 	}
-	return -lambda_theta;
 }
 
-double Estimator::ltm_d2LL(double theta, size_t question, int answer) {
-	double lambda_theta = 0.0;
-	for (auto q : questionSet.applicable_rows) {
-		double P = prob_ltm(theta, (size_t) q);
-		double guess = questionSet.guessing.at(q);
-		double Q = 1.0 - P;
-		double lambda_temp = (P - guess) / (1.0 - guess);
-		double discrimination = questionSet.discrimination.at(q);
-
-		lambda_theta += std::pow(discrimination*lambda_temp, 2.0) * (Q / P);
+void Estimator::probability(double theta, size_t question, double *out) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return GRMModel::probabilities(*questionSet.bank, question, theta, out);
+	case ModelType::GPCM:
+		return GPCMModel::probabilities(*questionSet.bank, question, theta, out);
+	default:
+		out[0] = BinaryModel::prob(*questionSet.bank, question, theta);
 	}
-
-	double P = prob_ltm(theta, question);
-	double guess = questionSet.guessing.at(question);
-	double Q = 1.0 - P;
-	double lambda_temp = (P - guess) / (1.0 - guess);
-	double discrimination = questionSet.discrimination.at(question);
-
-	lambda_theta += std::pow(discrimination*lambda_temp, 2.0) * (Q / P);
-
-	return -lambda_theta;
-}
-
-double Estimator::gpcm_d1LL(double theta) {
-  double d1l = 0.0;
-
-	for (auto question : questionSet.applicable_rows) {
-    d1l += gpcm_partial_d1LL(theta, question);
-	 }
-	
-	return d1l;
 }
 
-double Estimator::gpcm_d1LL(double theta, size_t question, int answer) {
-  	double d1l = 0.0;
-
-	for (auto q : questionSet.applicable_rows) {
-		int a = questionSet.answers.at(q);
-    	d1l += gpcm_partial_d1LL(theta, q, a);
+double Estimator::likelihood(double theta) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return exp(model_logLikelihood<GRMModel>(theta));
+	case ModelType::GPCM:
+		return exp(model_logLikelihood<GPCMModel>(theta));
+	default:
+		return exp(model_logLikelihood<BinaryModel>(theta));
 	}
-
-	d1l += gpcm_partial_d1LL(theta, question, answer);
-	
-	return d1l;
 }
 
-double Estimator::grm_d1LL(double theta) {
-	double l_theta = 0.0;
-	for (auto question : questionSet.applicable_rows) {
-		int answer_k = questionSet.answers.at(question);
-
-		double P_star2, P_star1;
-		std::tie(P_star2, P_star1) = prob_grm_pair(theta, question, answer_k);
-
-		double Q_star1 = 1.0 - P_star1;
-		double Q_star2 = 1 - P_star2;
-		double P = P_star1 - P_star2;
-		double w2 = P_star2 * Q_star2;
-		double w1 = P_star1 * Q_star1;
-
-		l_theta += (-1*questionSet.discrimination.at(question) * ((w1 - w2) / P));
+double Estimator::likelihood(double theta, size_t question, int answer) const{
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return exp(model_logLikelihood<GRMModel>(theta, question, answer));
+	case ModelType::GPCM:
+		return exp(model_logLikelihood<GPCMModel>(theta, question, answer));
+	default:
+		return exp(model_logLikelihood<BinaryModel>(theta, question, answer));
 	}
-	return l_theta;
 }
 
-double Estimator::grm_d1LL(double theta, size_t question, int answer) {
-	double l_theta = 0.0;
-	for (auto q : questionSet.applicable_rows) {
-		int answer_k = questionSet.answers.at(q);
-		double P_star2, P_star1;
-		std::tie(P_star2, P_star1) = prob_grm_pair(theta, q, answer_k);
-		double P = P_star1 - P_star2;
-		double w = P_star1 * (1.0 - P_star1) - P_star2 * (1 - P_star2);
-
-		l_theta += (-1*questionSet.discrimination.at(q) * (w/ P));
-	}
-
-	double P_star2, P_star1;
-	std::tie(P_star2, P_star1) = prob_grm_pair(theta, question, answer);
-	double P = P_star1 - P_star2;
-	double w = P_star1 * (1.0 - P_star1) - P_star2 * (1 - P_star2);
-
-	l_theta += (-1*questionSet.discrimination.at(question) * (w / P));
-
-	return l_theta;
-}
-
-double Estimator::ltm_d1LL(double theta) {
-	double l_theta = 0;
-	for (auto question : questionSet.applicable_rows) {
-		const double P = prob_ltm(theta, question);
-		const double guess = questionSet.guessing.at(question);
-		const double answer = questionSet.answers.at(question);
-		const double discrimination = questionSet.discrimination.at(question);
-		l_theta += discrimination * ((P - guess) / (P * (1 - guess))) * (answer - P);
-	}
-	return l_theta;
-}
-
-double Estimator::ltm_d1LL(double theta, size_t question, int answer) {
-	double l_theta = 0;
-	for (auto q : questionSet.applicable_rows) {
-		double P = prob_ltm(theta, q);
-		double guess = questionSet.guessing.at(q);
-		double a = questionSet.answers.at(q);
-		double discrimination = questionSet.discrimination.at(q);
-		l_theta += discrimination * ((P - guess) / (P * (1 - guess))) * (a - P);
-	}
-
-	double P = prob_ltm(theta, question);
-	double guess = questionSet.guessing.at(question);
-	double discrimination = questionSet.discrimination.at(question);
-	l_theta += discrimination * ((P - guess) / (P * (1 - guess))) * (answer - P);
-
-	return l_theta;
-}
-
-
-double Estimator::d1LL(double theta, bool use_prior, Prior &prior) {
+double Estimator::d1LL(double theta, bool use_prior, Prior &prior) const {
 	const double prior_shift = (theta - prior.param0()) / std::pow(prior.param1(), 2.0);
 	if (questionSet.applicable_rows.empty()) {
 		return prior_shift;
 	}
 	double l_theta = 0.0;
 	
-	if ((questionSet.model == "ltm") | (questionSet.model == "tpm")) {
-	  l_theta = ltm_d1LL(theta);
-	}
-	if (questionSet.model == "grm") {
-	  l_theta = grm_d1LL(theta);
-	}
-	if (questionSet.model == "gpcm"){
-		l_theta = gpcm_d1LL(theta);
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		l_theta = model_d1LL<GRMModel>(theta);
+		break;
+	case ModelType::GPCM:
+		l_theta = model_d1LL<GPCMModel>(theta);
+		break;
+	default:
+		l_theta = model_d1LL<BinaryModel>(theta);
 	}
 	
 	return use_prior ? l_theta - prior_shift : l_theta;
 }
 
-double Estimator::d1LL(double theta, bool use_prior, Prior &prior, size_t question, int answer) {
+double Estimator::d1LL(double theta, bool use_prior, Prior &prior, size_t question, int answer) const {
 	double l_theta = 0.0;
 	
-	if ((questionSet.model == "ltm") | (questionSet.model == "tpm")) {
-	  l_theta = ltm_d1LL(theta, question, answer);
-	}
-	if (questionSet.model == "grm") {
-	  l_theta = grm_d1LL(theta, question, answer);
-	}
-	if (questionSet.model == "gpcm"){
-		l_theta = gpcm_d1LL(theta, question, answer);
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		l_theta = model_d1LL<GRMModel>(theta, question, answer);
+		break;
+	case ModelType::GPCM:
+		l_theta = model_d1LL<GPCMModel>(theta, question, answer);
+		break;
+	default:
+		l_theta = model_d1LL<BinaryModel>(theta, question, answer);
 	}
 
 	if (use_prior)
@@ -858,36 +103,38 @@ double Estimator::d1LL(double theta, bool use_prior, Prior &prior, size_t questi
 	return l_theta;
 }
 
-double Estimator::d2LL(double theta, bool use_prior, Prior &prior) {
+double Estimator::d2LL(double theta, bool use_prior, Prior &prior) const {
 	const double prior_shift = 1.0 / std::pow(prior.param1(), 2.0);
 	if (questionSet.applicable_rows.empty()) {
 		return -prior_shift;
 	}
 	double lambda_theta = 0.0;
 	
-	if ((questionSet.model == "ltm") | (questionSet.model == "tpm")) {
-	  lambda_theta = ltm_d2LL(theta);
-	}
-	if (questionSet.model == "grm") {
-	  lambda_theta = grm_d2LL(theta);
-	}
-	if (questionSet.model == "gpcm"){
-		lambda_theta = gpcm_d2LL(theta);
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		lambda_theta = model_d2LL<GRMModel>(theta);
+		break;
+	case ModelType::GPCM:
+		lambda_theta = model_d2LL<GPCMModel>(theta);
+		break;
+	default:
+		lambda_theta = model_d2LL<BinaryModel>(theta);
 	}
 	return use_prior ? lambda_theta - prior_shift : lambda_theta;
 }
 
-double Estimator::d2LL(double theta, bool use_prior, Prior &prior, size_t question, int answer) {
+double Estimator::d2LL(double theta, bool use_prior, Prior &prior, size_t question, int answer) const {
 	double lambda_theta = 0.0;
 	
-	if ((questionSet.model == "ltm") | (questionSet.model == "tpm")) {
-	  lambda_theta = ltm_d2LL(theta, question, answer);
-	}
-	if (questionSet.model == "grm") {
-	  lambda_theta = grm_d2LL(theta, question, answer);
-	}
-	if (questionSet.model == "gpcm"){
-		lambda_theta = gpcm_d2LL(theta, question, answer);
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		lambda_theta = model_d2LL<GRMModel>(theta, question, answer);
+		break;
+	case ModelType::GPCM:
+		lambda_theta = model_d2LL<GPCMModel>(theta, question, answer);
+		break;
+	default:
+		lambda_theta = model_d2LL<BinaryModel>(theta, question, answer);
 	}
 
 	if(use_prior)
@@ -898,325 +145,245 @@ double Estimator::d2LL(double theta, bool use_prior, Prior &prior, size_t questi
 }
 
 
+LikelihoodTerms Estimator::likelihoodTerms(double theta, bool use_prior, Prior &prior, bool with_log) const {
+	LikelihoodTerms terms;
+	if (questionSet.applicable_rows.empty()) {
+		// The same values d1LL and d2LL return without answers
+		terms.logL = with_log ? 0.0 : NAN;
+		terms.d1 = (theta - prior.param0()) / std::pow(prior.param1(), 2.0);
+		terms.d2 = -1.0 / std::pow(prior.param1(), 2.0);
+		return terms;
+	}
 
-Estimator::Estimator(Integrator &integration, QuestionSet &question) : integrator(integration), questionSet(question) { }
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		terms = model_terms<GRMModel>(theta, with_log);
+		break;
+	case ModelType::GPCM:
+		terms = model_terms<GPCMModel>(theta, with_log);
+		break;
+	default:
+		terms = model_terms<BinaryModel>(theta, with_log);
+	}
 
-double Estimator::polytomous_posterior_variance(int item, Prior &prior) {
-	double theta_old = estimateTheta(prior);
-  
-  	questionSet.applicable_rows.push_back(item);
- 
-	std::vector<double> variances;
-	for (size_t i = 0; i <= questionSet.difficulty.at(item).size(); ++i) {
-		questionSet.answers.at(item) = (int) i + 1;
-		variances.push_back(std::pow(estimateSE(prior), 2.0));
+	if (use_prior) {
+		terms.d1 -= (theta - prior.param0()) / std::pow(prior.param1(), 2.0);
+		terms.d2 -= 1.0 / std::pow(prior.param1(), 2.0);
 	}
+	return terms;
+}
 
-	double sum = 0;
-	if (questionSet.model == "grm") {
-		auto probabilities = prob_grm(theta_old, (size_t) item);
-	  	for (size_t i = 1; i < probabilities.size(); ++i) {
-	    	sum += variances.at(i-1) * (probabilities.at(i) - probabilities.at(i-1));
-	    }
+LikelihoodTerms Estimator::likelihoodTerms(double theta, bool use_prior, Prior &prior, size_t question, int answer,
+                                           bool with_log) const {
+	LikelihoodTerms terms;
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		terms = model_terms<GRMModel>(theta, with_log, question, answer);
+		break;
+	case ModelType::GPCM:
+		terms = model_terms<GPCMModel>(theta, with_log, question, answer);
+		break;
+	default:
+		terms = model_terms<BinaryModel>(theta, with_log, question, answer);
 	}
-	if (questionSet.model == "gpcm"){
-		auto probabilities = prob_gpcm(theta_old, (size_t) item);
-	  	for (size_t i = 0; i < probabilities.size(); ++i) {
-	    	sum += variances.at(i) * probabilities.at(i);
-	    }
+
+	if (use_prior) {
+		terms.d1 -= (theta - prior.param0()) / std::pow(prior.param1(), 2.0);
+		terms.d2 -= 1.0 / std::pow(prior.param1(), 2.0);
 	}
-	
-	questionSet.applicable_rows.pop_back();
-	return sum;
+	return terms;
 }
 
-double Estimator::binary_posterior_variance(int item, Prior &prior) {
-  const double prob_incorrect = prob_ltm(estimateTheta(prior), (size_t) item);
-  
-  questionSet.applicable_rows.push_back(item);
-  
-	questionSet.answers.at(item) = 1;
-	double variance_correct = std::pow(estimateSE(prior), 2.0);
-
-	questionSet.answers.at(item) = 0;
-	double variance_incorrect = std::pow(estimateSE(prior), 2.0);
-	
-	questionSet.applicable_rows.pop_back();
+Estimator::Estimator(Integrator &integration, const QuestionSet &question) : integrator(integration), questionSet(question) { }
 
-	return (prob_incorrect * variance_correct) + ((1.0 - prob_incorrect) * variance_incorrect);
+double Estimator::expectedPV(int item, Prior &prior) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return expectedPV_grm(item, prior);
+	case ModelType::GPCM:
+		return expectedPV_gpcm(item, prior);
+	default:
+		return expectedPV_ltm_tpm(item, prior);
+	}
 }
 
-double Estimator::expectedPV(int item, Prior &prior) {
-	double result = 0.0;
-  
-	if ((questionSet.model == "ltm") | (questionSet.model == "tpm")) {
-	  result = binary_posterior_variance(item, prior);
-	}
-	if (questionSet.model == "grm") {
-	  result = polytomous_posterior_variance(item, prior);
-	}
-	if (questionSet.model == "gpcm"){
-		result = polytomous_posterior_variance(item, prior);
-	}
-	
-	questionSet.answers.at(item) = NA_INTEGER;
-	return result;
+double Estimator::expectedPV_ltm_tpm(int item, Prior &prior) const
+{
+	return expectedPV_ltm_tpm(item, selectionContext(prior));
 }
 
-double Estimator::expectedPV_ltm_tpm(int item, Prior &prior)
+double Estimator::expectedPV_ltm_tpm(int item, const SelectionContext &context) const
 {
 	//binary_posterior_variance
-	double prob_incorrect = prob_ltm(estimateTheta(prior), (size_t) item);
+	double prob_incorrect = BinaryModel::prob(*questionSet.bank, (size_t) item, context.theta);
     
-	double variance_correct = std::pow(estimateSE(prior,item,1), 2.0);
-	double variance_incorrect = std::pow(estimateSE(prior,item,0), 2.0);
+	double variance_correct = std::pow(hypotheticalSE(context,item,1), 2.0);
+	double variance_incorrect = std::pow(hypotheticalSE(context,item,0), 2.0);
 	
 	return (prob_incorrect * variance_correct) + ((1.0 - prob_incorrect) * variance_incorrect);
 }
 
-double Estimator::expectedPV_grm(int item, Prior &prior)
+double Estimator::expectedPV_grm(int item, Prior &prior) const
+{
+	return expectedPV_grm(item, selectionContext(prior));
+}
+
+double Estimator::expectedPV_grm(int item, const SelectionContext &context) const
 {
 	//polytomous_posterior_variance
 	   
 	double sum = 0;
-	auto probabilities = prob_grm(estimateTheta(prior), (size_t) item);
-  	for (size_t i = 1; i < probabilities.size(); ++i) {
-  		double var = std::pow(estimateSE(prior,item,(int)i), 2.0);
-    	sum += var * (probabilities.at(i) - probabilities.at(i-1));
+	const size_t count = GRMModel::probabilityCount(*questionSet.bank, (size_t) item);
+	ScratchBuffer probabilities(count);
+	GRMModel::probabilities(*questionSet.bank, (size_t) item, context.theta, probabilities.data());
+  	for (size_t i = 1; i < count; ++i) {
+  		double var = std::pow(hypotheticalSE(context,item,(int)i), 2.0);
+    	sum += var * (probabilities[i] - probabilities[i-1]);
     }
 	
 	return sum;
 }
 
-double Estimator::expectedPV_gpcm(int item, Prior &prior)
+double Estimator::expectedPV_gpcm(int item, Prior &prior) const
+{
+	return expectedPV_gpcm(item, selectionContext(prior));
+}
+
+double Estimator::expectedPV_gpcm(int item, const SelectionContext &context) const
 {
 	//polytomous_posterior_variance
 	double sum = 0;
-	auto probabilities = prob_gpcm(estimateTheta(prior), (size_t) item);
-  	for (size_t i = 0; i < probabilities.size(); ++i) {
-  		double var = std::pow(estimateSE(prior,item,(int) i + 1), 2.0);
-    	sum += var * probabilities.at(i);
+	const size_t count = GPCMModel::probabilityCount(*questionSet.bank, (size_t) item);
+	ScratchBuffer probabilities(count);
+	GPCMModel::probabilities(*questionSet.bank, (size_t) item, context.theta, probabilities.data());
+  	for (size_t i = 0; i < count; ++i) {
+  		double var = std::pow(hypotheticalSE(context,item,(int) i + 1), 2.0);
+    	sum += var * probabilities[i];
     }
 	
 	return sum;
 }
 
-double Estimator::obsInf(double theta, int item) {
-	if(questionSet.model == "grm"){
-	  return obsInf_grm(theta, item);
-	}	
-	else if(questionSet.model == "gpcm"){
-	  return obsInf_gpcm(theta, item);
-	}
-	else
-	{
-		return obsInf_ltm(theta, item);
-	}
-}
-
-double Estimator::obsInf(double theta, int item, int answer) {
-	if(questionSet.model == "grm"){
-	  return obsInf_grm(theta, item, answer);
-	}	
-	else if(questionSet.model == "gpcm"){
-	  return obsInf_gpcm(theta, item, answer);
-	}
-	else
-	{
-		return obsInf_ltm(theta, item, answer);
-	}
-}
-
-double Estimator::obsInf_grm(double theta, int item)
-{	double discrimination = questionSet.discrimination.at(item);
-	return -discrimination*discrimination * grm_partial_d2LL(theta, item);
-}
-double Estimator::obsInf_grm(double theta, int item, int answer)
-{
-	double discrimination = questionSet.discrimination.at(item);
-	return -discrimination*discrimination* grm_partial_d2LL(theta, item, answer);
+double Estimator::hypotheticalTheta(const SelectionContext &context, size_t question, int answer) const {
+	return estimateTheta(context.prior, question, answer);
 }
 
-double Estimator::obsInf_gpcm(double theta, int item)
-{
-	return -gpcm_partial_d2LL(theta, item);
+double Estimator::hypotheticalSE(const SelectionContext &context, size_t question, int answer) const {
+	return estimateSE(context.prior, question, answer);
 }
 
-double Estimator::obsInf_gpcm(double theta, int item, int answer)
-{
-	return -gpcm_partial_d2LL(theta, item, answer);
+SelectionContext Estimator::selectionContext(Prior &prior, bool with_test_info) const {
+	const double theta = estimateTheta(prior);
+	SelectionContext context = {prior, theta, with_test_info ? testInfo(theta) : NAN};
+	return context;
 }
 
-double Estimator::obsInf_ltm(double theta, int item)
-{
-	double discrimination = questionSet.discrimination.at(item);
-	double guess = questionSet.guessing.at(item);
-	double P = prob_ltm(theta, item);
-	double Q = 1 - P;
-	double temp = std::pow((P - guess) / (1.0 - guess), 2.0);
-	return discrimination*discrimination * temp * (Q / P);
-}
-double Estimator::obsInf_ltm(double theta, int item, int answer)
-{
-	return obsInf_ltm(theta, item);
+double Estimator::obsInf(double theta, int item) const {
+	return obsInf(theta, item, questionSet.answers.at(item));
 }
 
-
-double Estimator::fisherInf(double theta, int item) {
-
-	if ((questionSet.model == "ltm") || (questionSet.model == "tpm")) {
-		return obsInf_ltm(theta, item);
-	}
-
-	double output = 0.0;
-
-	if (questionSet.model == "grm") {
-		double discrimination_squared = std::pow(questionSet.discrimination.at(item), 2.0);
-		auto probabilities = prob_grm(theta, (size_t) item);
-	  	for (size_t i = 1; i <= questionSet.difficulty.at(item).size() + 1; ++i) {
-		  double P_star1 = probabilities.at(i);
-		  double P_star2 = probabilities.at(i-1);
-		  double w1 = P_star1 * (1.0 - P_star1);
-		  double w2 = P_star2 * (1.0 - P_star2);
-		  output += discrimination_squared * (std::pow(w1 - w2, 2.0) / (P_star1 - P_star2));
-		}
+double Estimator::obsInf(double theta, int item, int answer) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return -GRMModel::d2(*questionSet.bank, item, answer, theta);
+	case ModelType::GPCM:
+		return -GPCMModel::d2(*questionSet.bank, item, answer, theta);
+	default:
+		return BinaryModel::fisherInf(*questionSet.bank, item, theta);
 	}
-	else if (questionSet.model == "gpcm"){
-		std::vector<double> probs;
-	  	std::vector<double> prob_firstderiv;
-		std::vector<double> prob_secondderiv;
-		prob_derivs_gpcm(theta, item, probs, prob_firstderiv, prob_secondderiv);
-
-	  	for (size_t i = 0; i < probs.size(); ++i) {
-		  double p = probs.at(i);
-		  double p_prime = prob_firstderiv.at(i);
-		  double p_primeprime = prob_secondderiv.at(i);
-		  output += (std::pow(p_prime, 2.0) / p) - p_primeprime;
-	  }
-	}
-	return output;
 }
 
-double Estimator::fisherInf(double theta, int item, int answer) {
-
-	if ((questionSet.model == "ltm") | (questionSet.model == "tpm")) {
-		return obsInf_ltm(theta, item, answer);
+double Estimator::fisherInf(double theta, int item) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return GRMModel::fisherInf(*questionSet.bank, item, theta);
+	case ModelType::GPCM:
+		return GPCMModel::fisherInf(*questionSet.bank, item, theta);
+	default:
+		return BinaryModel::fisherInf(*questionSet.bank, item, theta);
 	}
-
-	double output = 0.0;
-
-	if (questionSet.model == "grm") {
-		double discrimination_squared = std::pow(questionSet.discrimination.at(item), 2.0);
-		auto probabilities = prob_grm(theta, (size_t) item);
-	  	for (size_t i = 1; i <= questionSet.difficulty.at(item).size() + 1; ++i) {
-		  double P_star1 = probabilities.at(i);
-		  double P_star2 = probabilities.at(i-1);
-		  double w1 = P_star1 * (1.0 - P_star1);
-		  double w2 = P_star2 * (1.0 - P_star2);
-		  output += discrimination_squared * (std::pow(w1 - w2, 2.0) / (P_star1 - P_star2));
-		}
-	}	
-	else if (questionSet.model == "gpcm"){
-		std::vector<double> probs;
-	  	std::vector<double> prob_firstderiv;
-		std::vector<double> prob_secondderiv;
-		prob_derivs_gpcm(theta, item, probs, prob_firstderiv, prob_secondderiv);
-
-	  	for (size_t i = 0; i < probs.size(); ++i) {
-		  double p = probs.at(i);
-		  double p_prime = prob_firstderiv.at(i);
-		  double p_primeprime = prob_secondderiv.at(i);
-		  output += (std::pow(p_prime, 2.0) / p) - p_primeprime;
-	  }
-	}
-	return output;
 }
 
-double Estimator::expectedObsInf(int item, Prior &prior) {
+double Estimator::fisherInf(double theta, int item, int) const {
+	return fisherInf(theta, item);
+}
 
-	
-	if (questionSet.model == "grm"){
-		auto probabilities = prob_grm(estimateTheta(prior), (size_t) item);
-	  	
-	  	questionSet.applicable_rows.push_back(item);
-
-		double sum = 0.0;
-	  	for (size_t i = 1; i < probabilities.size(); ++i) {
-	  		questionSet.answers.at(item) = (int) i;
-			double obsinfo = obsInf_grm(estimateTheta(prior), item);
-	    	sum += obsinfo * (probabilities.at(i) - probabilities.at(i-1));
-     	}
-
-		questionSet.answers.at(item) = NA_INTEGER;
-		questionSet.applicable_rows.pop_back();
-		
-		return sum;
+void Estimator::fisherInf(double theta, const int *items, size_t n, double *out) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return GRMModel::fisherInf(*questionSet.bank, items, n, theta, out);
+	case ModelType::GPCM:
+		return GPCMModel::fisherInf(*questionSet.bank, items, n, theta, out);
+	default:
+		return BinaryModel::fisherInf(*questionSet.bank, items, n, theta, out);
 	}
-	else if (questionSet.model == "gpcm"){
-		auto probabilities = prob_gpcm(estimateTheta(prior), (size_t) item);
+}
 
-	  	questionSet.applicable_rows.push_back(item);
-	  
-		double sum = 0.0;
-	  	for (size_t i = 0; i < probabilities.size(); ++i) {
-	  		questionSet.answers.at(item) = (int) i + 1;
-			double obsinfo = obsInf_gpcm(estimateTheta(prior), item);
-      		sum += obsinfo * probabilities.at(i);
-    	}
-
-		questionSet.answers.at(item) = NA_INTEGER;
-		questionSet.applicable_rows.pop_back();
-				
-		return sum;
+double Estimator::expectedObsInf(int item, Prior &prior) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return expectedObsInf_grm(item, prior);
+	case ModelType::GPCM:
+		return expectedObsInf_gpcm(item, prior);
+	default:
+		return expectedObsInf_rest(item, prior);
 	}
+}
 
-	double prob_one = prob_ltm(estimateTheta(prior), (size_t) item);
-	questionSet.applicable_rows.push_back(item);
-	
-	questionSet.answers.at(item) = 0;
-	double obsInfZero = obsInf_ltm(estimateTheta(prior), item);
-	questionSet.answers.at(item) = 1;
-	double obsInfOne = obsInf_ltm(estimateTheta(prior), item);
-	
-	questionSet.applicable_rows.pop_back();
-	questionSet.answers.at(item) = NA_INTEGER;
-
-	return (prob_one * obsInfOne) + ((1 - prob_one) * obsInfZero);
+double Estimator::expectedObsInf_grm(int item, Prior &prior) const
+{
+	return expectedObsInf_grm(item, selectionContext(prior));
 }
 
-double Estimator::expectedObsInf_grm(int item, Prior &prior)
+double Estimator::expectedObsInf_grm(int item, const SelectionContext &context) const
 {
-	std::vector<double> probabilities = prob_grm(estimateTheta(prior), (size_t) item);
+	const size_t count = GRMModel::probabilityCount(*questionSet.bank, (size_t) item);
+	ScratchBuffer probabilities(count);
+	GRMModel::probabilities(*questionSet.bank, (size_t) item, context.theta, probabilities.data());
 	double sum = 0.0;
 
-	for(size_t i = 1; i < probabilities.size(); ++i){
-	    sum += obsInf_grm(estimateTheta(prior,item,(int)i), item, (int)i) * (probabilities.at(i) - probabilities.at(i-1));
+	for(size_t i = 1; i < count; ++i){
+		double obsinfo = -GRMModel::d2(*questionSet.bank, item, (int) i, hypotheticalTheta(context,item,(int)i));
+	    sum += obsinfo * (probabilities[i] - probabilities[i-1]);
     }
 
 	return sum;
 }
 
-double Estimator::expectedObsInf_gpcm(int item, Prior &prior)
+double Estimator::expectedObsInf_gpcm(int item, Prior &prior) const
+{
+	return expectedObsInf_gpcm(item, selectionContext(prior));
+}
+
+double Estimator::expectedObsInf_gpcm(int item, const SelectionContext &context) const
 {
-	std::vector<double> probabilities = prob_gpcm(estimateTheta(prior), (size_t) item);
+	const size_t count = GPCMModel::probabilityCount(*questionSet.bank, (size_t) item);
+	ScratchBuffer probabilities(count);
+	GPCMModel::probabilities(*questionSet.bank, (size_t) item, context.theta, probabilities.data());
 	double sum = 0.0;
 	
-	for (size_t i = 0; i < probabilities.size(); ++i) {
-	      sum += obsInf_gpcm(estimateTheta(prior,item,(int) i + 1), item, (int) i + 1) * probabilities.at(i);
+	for (size_t i = 0; i < count; ++i) {
+		double obsinfo = -GPCMModel::d2(*questionSet.bank, item, (int) i + 1, hypotheticalTheta(context,item,(int) i + 1));
+	    sum += obsinfo * probabilities[i];
 	}
 
 	return sum;
 }
 
-double Estimator::expectedObsInf_rest(int item, Prior &prior)
+double Estimator::expectedObsInf_rest(int item, Prior &prior) const
+{
+	return expectedObsInf_rest(item, selectionContext(prior));
+}
+
+double Estimator::expectedObsInf_rest(int item, const SelectionContext &context) const
 {
-	double prob_one = prob_ltm(estimateTheta(prior), (size_t) item);
-	double obsInfZero = obsInf_ltm(estimateTheta(prior, item, 0), item, 0);
-	double obsInfOne = obsInf_ltm(estimateTheta(prior, item, 1), item, 1);
+	double prob_one = BinaryModel::prob(*questionSet.bank, (size_t) item, context.theta);
+	double obsInfZero = BinaryModel::fisherInf(*questionSet.bank, item, hypotheticalTheta(context, item, 0));
+	double obsInfOne = BinaryModel::fisherInf(*questionSet.bank, item, hypotheticalTheta(context, item, 1));
 	return (prob_one * obsInfOne) + ((1 - prob_one) * obsInfZero);
 }
 
-double Estimator::brentMethod(integrableFunction function){//const &function) {
+double Estimator::brentMethod(gsl_function *F) const {
   int status;
   int iter = 0;
   int max_iter = 100;
@@ -1228,9 +395,6 @@ double Estimator::brentMethod(integrableFunction function){//const &function) {
   double x_lo = -5.0;
   double x_hi = 5.0;
   
-  auto gslfunc = GSLFunctionWrapper(function);
-  gsl_function *F = gslfunc.asGSLFunction();
-  
 	T = gsl_root_fsolver_brent;
   s = gsl_root_fsolver_alloc (T);
   
@@ -1261,23 +425,35 @@ double Estimator::brentMethod(integrableFunction function){//const &function) {
   return r;
 }
   
-double Estimator::fisherTestInfo(Prior prior) {
-  double theta = estimateTheta(prior);
+double Estimator::fisherTestInfo(Prior prior) const {
+  return testInfo(estimateTheta(prior));
+}
+
+double Estimator::testInfo(double theta) const {
+  const size_t n = questionSet.applicable_rows.size();
+  ScratchBuffer information(n);
+  fisherInf(theta, questionSet.applicable_rows.data(), n, information.data());
   double sum = 0.0;
-  for (auto item : questionSet.applicable_rows) {
-    sum += fisherInf(theta, item);
+  for (size_t i = 0; i < n; ++i) {
+    sum += information[i];
   }
   return sum;
 }
 
-double Estimator::fisherTestInfo(Prior prior, size_t question, int answer)
+double Estimator::fisherTestInfo(Prior prior, size_t question, int answer) const
 {
-	double theta = estimateTheta(prior,question,answer);
+	return testInfo(estimateTheta(prior,question,answer), question, answer);
+}
+
+double Estimator::testInfo(double theta, size_t question, int answer) const
+{
+	const size_t n = questionSet.applicable_rows.size();
+	ScratchBuffer information(n);
+	fisherInf(theta, questionSet.applicable_rows.data(), n, information.data());
 	double sum = 0.0;
-	for (auto item : questionSet.applicable_rows)
+	for (size_t i = 0; i < n; ++i)
 	{
-		int a = questionSet.answers.at(item);
-		sum += fisherInf(theta, item, a);
+		sum += information[i];
 	}
 	sum += fisherInf(theta, question, answer);
 	return sum;
@@ -1289,82 +465,154 @@ double Estimator::fisherTestInfo(Prior prior, size_t question, int answer)
  * function will call in a loop
  */
 
-double Estimator::pwi(int item, Prior prior) {
+double Estimator::pwi(int item, Prior prior) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return pwi<GRMModel>(item, prior);
+	case ModelType::GPCM:
+		return pwi<GPCMModel>(item, prior);
+	default:
+		return pwi<BinaryModel>(item, prior);
+	}
+}
+
+template <class Model>
+double Estimator::pwi(int item, Prior &prior) const {
 
-	integrableFunction pwi_j = [&](double theta) {
-		return likelihood(theta) * prior.prior(theta) * fisherInf(theta, item);
+	auto pwi_j = [&](double theta) {
+		return exp(model_logLikelihood<Model>(theta)) * prior.prior(theta) * Model::fisherInf(*questionSet.bank, item, theta);
 	};
 
-	return integrate_selectItem(pwi_j, questionSet.lowerBound, questionSet.upperBound);
+	return integrate_selectItem(pwi_j, questionSet.bank->lowerBound, questionSet.bank->upperBound);
+}
+
+double Estimator::lwi(int item) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return lwi<GRMModel>(item);
+	case ModelType::GPCM:
+		return lwi<GPCMModel>(item);
+	default:
+		return lwi<BinaryModel>(item);
+	}
 }
 
-double Estimator::lwi(int item) {
+template <class Model>
+double Estimator::lwi(int item) const {
 
-	integrableFunction lwi_j = [&](double theta) {
-		return likelihood(theta) * fisherInf(theta, item);
+	auto lwi_j = [&](double theta) {
+		return exp(model_logLikelihood<Model>(theta)) * Model::fisherInf(*questionSet.bank, item, theta);
 	};
 
-	return integrate_selectItem(lwi_j, questionSet.lowerBound, questionSet.upperBound);
+	return integrate_selectItem(lwi_j, questionSet.bank->lowerBound, questionSet.bank->upperBound);
+}
+
+void Estimator::pwi(const int *items, size_t n, Prior &prior, double *out) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return weightedInfo<GRMModel>(items, n, &prior, out);
+	case ModelType::GPCM:
+		return weightedInfo<GPCMModel>(items, n, &prior, out);
+	default:
+		return weightedInfo<BinaryModel>(items, n, &prior, out);
+	}
+}
+
+void Estimator::lwi(const int *items, size_t n, double *out) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return weightedInfo<GRMModel>(items, n, nullptr, out);
+	case ModelType::GPCM:
+		return weightedInfo<GPCMModel>(items, n, nullptr, out);
+	default:
+		return weightedInfo<BinaryModel>(items, n, nullptr, out);
+	}
 }
 
-double Estimator::fii(int item, Prior prior) {
+template <class Model>
+void Estimator::weightedInfo(const int *items, size_t n, Prior *prior, double *out) const {
+	if (n == 0) {
+		return;
+	}
+
+	// One row of the item by point matrix: the weight times the information of every item
+	auto weighted_info = [&](double theta, double *values) {
+		double weight = exp(model_logLikelihood<Model>(theta));
+		if (prior != nullptr) {
+			weight *= prior->prior(theta);
+		}
+		Model::fisherInf(*questionSet.bank, items, n, theta, values);
+		for (size_t i = 0; i < n; ++i) {
+			values[i] *= weight;
+		}
+	};
+
+	try {
+		integrator.integrate(weighted_info, n, integrationSubintervals, questionSet.bank->lowerBound,
+		                     questionSet.bank->upperBound, out);
+	}
+	catch (std::runtime_error &) {
+		// Some item needs more subintervals where the others do not; give each its own
+		for (size_t i = 0; i < n; ++i) {
+			out[i] = prior != nullptr ? pwi<Model>(items[i], *prior) : lwi<Model>(items[i]);
+		}
+	}
+}
+
+double Estimator::fii(int item, Prior prior) const {
+	return fii(item, selectionContext(prior, true));
+}
+
+double Estimator::fii(int item, const SelectionContext &context) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return fii<GRMModel>(item, context);
+	case ModelType::GPCM:
+		return fii<GPCMModel>(item, context);
+	default:
+		return fii<BinaryModel>(item, context);
+	}
+}
+
+template <class Model>
+double Estimator::fii(int item, const SelectionContext &context) const {
   
-	integrableFunction fii_j = [&](double theta_not) {
-		return fisherInf(theta_not, item);
+	auto fii_j = [&](double theta_not) {
+		return Model::fisherInf(*questionSet.bank, item, theta_not);
 	};
 	  
-  double delta = questionSet.z.at(0) * std::pow(fisherTestInfo(prior), 0.5);
+  double delta = questionSet.bank->z.at(0) * std::pow(context.test_info, 0.5);
   
-  double theta = estimateTheta(prior);
+  double theta = context.theta;
   const double lower = theta - delta;
   const double upper = theta + delta;
 
 	return integrate_selectItem(fii_j, lower, upper);
 }
 
-double Estimator::kl(double theta_not, int item, double theta){
-  	double sum = 0.0;
-  
-  	if(questionSet.model == "grm"){
-    	auto cdf_theta_not = prob_grm(theta_not, (size_t) item);
-	  	auto cdf_theta_hat = prob_grm(theta, (size_t) item);
-	  
-	  	for (size_t i = 1; i < cdf_theta_hat.size(); ++i) {
-	    	double prob_theta_not = cdf_theta_not.at(i) - cdf_theta_not.at(i-1);
-	    	double prob_theta_hat = cdf_theta_hat.at(i) - cdf_theta_hat.at(i-1);
-	    	sum += prob_theta_not * (log(prob_theta_not) - log(prob_theta_hat));
-	  	}
-	}
-  
-  	if(questionSet.model == "gpcm"){
-    	auto prob_theta_not = prob_gpcm(theta_not, (size_t) item);
-	  	auto prob_theta_hat = prob_gpcm(theta, (size_t) item);
-	  
-	  	for (size_t i = 0; i < prob_theta_not.size(); ++i) {
-	  	  	sum += prob_theta_not.at(i) * (log(prob_theta_not.at(i)) - log(prob_theta_hat.at(i)));
-	  	}
-  	}
-  
-  	if((questionSet.model == "ltm") || (questionSet.model == "tpm")){
-    	const double prob_theta_not = prob_ltm(theta_not, (size_t) item);
-    	const double prob_theta_hat = prob_ltm(theta, (size_t) item);
-
-    	double first_term = prob_theta_not * (log(prob_theta_not) - log(prob_theta_hat));
-    	double second_term = (1 - prob_theta_not) * (log(1 - prob_theta_not) - log(1 - prob_theta_hat));
+double Estimator::expectedKL(int item, Prior prior) const {
+	return expectedKL(item, selectionContext(prior, true));
+}
 
-    	sum = first_term + second_term;
-  	}
-  
-  	return sum;
+double Estimator::expectedKL(int item, const SelectionContext &context) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return expectedKL<GRMModel>(item, context);
+	case ModelType::GPCM:
+		return expectedKL<GPCMModel>(item, context);
+	default:
+		return expectedKL<BinaryModel>(item, context);
+	}
 }
 
-double Estimator::expectedKL(int item, Prior prior) {
-	double theta = estimateTheta(prior);
-	integrableFunction kl_fctn = [&](double theta_not) {
-	  return kl(theta_not, item, theta);
+template <class Model>
+double Estimator::expectedKL(int item, const SelectionContext &context) const {
+	double theta = context.theta;
+	auto kl_fctn = [&](double theta_not) {
+	  return Model::kl(*questionSet.bank, item, theta_not, theta);
   };
   
-  double delta = questionSet.z.at(0) * std::pow(fisherTestInfo(prior), 0.5);
+  double delta = questionSet.bank->z.at(0) * std::pow(context.test_info, 0.5);
   
   const double lower = theta - delta;
   const double upper = theta + delta;
@@ -1372,30 +620,144 @@ double Estimator::expectedKL(int item, Prior prior) {
   return integrate_selectItem(kl_fctn, lower, upper);
 }
 
-double Estimator::likelihoodKL(int item, Prior prior) {
-	double theta = estimateTheta(prior);
-	integrableFunction kl_fctn = [&](double theta_not) {
-	  return likelihood(theta_not) * kl(theta_not, item, theta);
+double Estimator::likelihoodKL(int item, Prior prior) const {
+	return likelihoodKL(item, selectionContext(prior, false));
+}
+
+double Estimator::likelihoodKL(int item, const SelectionContext &context) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return likelihoodKL<GRMModel>(item, context);
+	case ModelType::GPCM:
+		return likelihoodKL<GPCMModel>(item, context);
+	default:
+		return likelihoodKL<BinaryModel>(item, context);
+	}
+}
+
+template <class Model>
+double Estimator::likelihoodKL(int item, const SelectionContext &context) const {
+	double theta = context.theta;
+	auto kl_fctn = [&](double theta_not) {
+	  return exp(model_logLikelihood<Model>(theta_not)) * Model::kl(*questionSet.bank, item, theta_not, theta);
   };
 
-  return integrate_selectItem(kl_fctn, questionSet.lowerBound, questionSet.upperBound);
+  return integrate_selectItem(kl_fctn, questionSet.bank->lowerBound, questionSet.bank->upperBound);
+}
+
+double Estimator::posteriorKL(int item, Prior prior) const {
+	return posteriorKL(item, selectionContext(prior, false));
+}
+
+double Estimator::posteriorKL(int item, const SelectionContext &context) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return posteriorKL<GRMModel>(item, context);
+	case ModelType::GPCM:
+		return posteriorKL<GPCMModel>(item, context);
+	default:
+		return posteriorKL<BinaryModel>(item, context);
+	}
 }
 
-double Estimator::posteriorKL(int item, Prior prior) {
-	double theta = estimateTheta(prior);
-	integrableFunction kl_fctn = [&](double theta_not) {
-	  return prior.prior(theta_not) * likelihood(theta_not) * kl(theta_not, item, theta);
+template <class Model>
+double Estimator::posteriorKL(int item, const SelectionContext &context) const {
+	double theta = context.theta;
+	auto kl_fctn = [&](double theta_not) {
+	  return context.prior.prior(theta_not) * exp(model_logLikelihood<Model>(theta_not)) * Model::kl(*questionSet.bank, item, theta_not, theta);
   };
 
-  return integrate_selectItem(kl_fctn, questionSet.lowerBound, questionSet.upperBound);
+  return integrate_selectItem(kl_fctn, questionSet.bank->lowerBound, questionSet.bank->upperBound);
+}
+
+void Estimator::expectedKL(const int *items, size_t n, const SelectionContext &context, double *out) const {
+	klBlock(items, n, context, KLWeight::NONE, out);
+}
+
+void Estimator::likelihoodKL(const int *items, size_t n, const SelectionContext &context, double *out) const {
+	klBlock(items, n, context, KLWeight::LIKELIHOOD, out);
 }
 
-double Estimator::integrate_selectItem(const integrableFunction &function, const double lower, const double upper){
-  auto gslfunc = GSLFunctionWrapper(function);
-  gsl_function *f = gslfunc.asGSLFunction();
-  return integrator.integrate(f, integrationSubintervals, lower, upper);
+void Estimator::posteriorKL(const int *items, size_t n, const SelectionContext &context, double *out) const {
+	klBlock(items, n, context, KLWeight::POSTERIOR, out);
+}
+
+void Estimator::klBlock(const int *items, size_t n, const SelectionContext &context, KLWeight weight,
+                        double *out) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return klBlock<GRMModel>(items, n, context, weight, out);
+	case ModelType::GPCM:
+		return klBlock<GPCMModel>(items, n, context, weight, out);
+	default:
+		return klBlock<BinaryModel>(items, n, context, weight, out);
+	}
+}
+
+template <class Model>
+void Estimator::klBlock(const int *items, size_t n, const SelectionContext &context, KLWeight weight,
+                        double *out) const {
+	if (n == 0) {
+		return;
+	}
+	const ItemBank &bank = *questionSet.bank;
+	const double theta = context.theta;
+
+	size_t reference_count = 0;
+	for (size_t i = 0; i < n; ++i) {
+		reference_count += Model::klReferenceCount(bank, items[i]);
+	}
+	ScratchBuffer log_reference(reference_count);
+	double *reference = log_reference.data();
+	for (size_t i = 0; i < n; ++i) {
+		Model::klReference(bank, items[i], theta, reference);
+		reference += Model::klReferenceCount(bank, items[i]);
+	}
+
+	// One row of the item by point matrix: the weight is the same for every item
+	auto kl_block = [&](double theta_not, double *values) {
+		double factor = 1.0;
+		if (weight == KLWeight::POSTERIOR) {
+			factor = context.prior.prior(theta_not) * exp(model_logLikelihood<Model>(theta_not));
+		}
+		else if (weight == KLWeight::LIKELIHOOD) {
+			factor = exp(model_logLikelihood<Model>(theta_not));
+		}
+		const double *item_reference = log_reference.data();
+		for (size_t i = 0; i < n; ++i) {
+			values[i] = factor * Model::kl(bank, items[i], theta_not, item_reference);
+			item_reference += Model::klReferenceCount(bank, items[i]);
+		}
+	};
+
+	double lower = bank.lowerBound;
+	double upper = bank.upperBound;
+	if (weight == KLWeight::NONE) {
+		const double delta = bank.z.at(0) * std::pow(context.test_info, 0.5);
+		lower = theta - delta;
+		upper = theta + delta;
+	}
+
+	try {
+		integrator.integrate(kl_block, n, integrationSubintervals, lower, upper, out);
+	}
+	catch (std::runtime_error &) {
+		// Some item needs more subintervals where the others do not; give each its own
+		for (size_t i = 0; i < n; ++i) {
+			if (weight == KLWeight::NONE) {
+				out[i] = expectedKL<Model>(items[i], context);
+			}
+			else if (weight == KLWeight::LIKELIHOOD) {
+				out[i] = likelihoodKL<Model>(items[i], context);
+			}
+			else {
+				out[i] = posteriorKL<Model>(items[i], context);
+			}
+		}
+	}
 }
 
 
 
 
+
@@ -5,6 +5,7 @@
 #include "Integrator.h"
 #include "QuestionSet.h"
 #include "Prior.h"
+#include "SelectionContext.h"
 
 enum class EstimationType {
 	EAP, MAP, MLE, WLE
@@ -16,95 +17,167 @@ enum class EstimationType {
  */
 class Estimator {
 public:
-	Estimator(Integrator &integration, QuestionSet &question);
+	Estimator(Integrator &integration, const QuestionSet &question);
 
 	virtual EstimationType getEstimationType() const = 0;
 
-	virtual double estimateTheta(Prior prior) = 0;
-	virtual double estimateTheta(Prior prior, size_t question, int answer) = 0;
+	virtual double estimateTheta(Prior prior) const = 0;
+	virtual double estimateTheta(Prior prior, size_t question, int answer) const = 0;
 
-	virtual double estimateSE(Prior prior) = 0;
-	virtual double estimateSE(Prior prior, size_t question, int answer) = 0;
+	virtual double estimateSE(Prior prior) const = 0;
+	virtual double estimateSE(Prior prior, size_t question, int answer) const = 0;
 
-	double likelihood(double theta);
-	double likelihood(double theta, size_t question, int answer);
+	/**
+	 * Brings anything the estimator keeps about the answers up to date with questionSet. Cat calls this whenever
+	 * the answers change, so the const functions, which item selection calls from several threads, only read it.
+	 */
+	virtual void sync(const Prior &/*prior*/) { }
+
+	double likelihood(double theta) const;
+	double likelihood(double theta, size_t question, int answer) const;
 
-	std::vector<double> probability(double theta, size_t question);
+	std::vector<double> probability(double theta, size_t question) const;
+	/**
+	 * The same values written to out, which must have room for probabilityCount(question) of them.
+	 */
+	void probability(double theta, size_t question, double *out) const;
+	size_t probabilityCount(size_t question) const;
 
-	double obsInf(double theta, int item);
-	double obsInf(double theta, int item, int answer);
-	double obsInf_grm(double theta, int item);
-	double obsInf_grm(double theta, int item, int answer);
-	double obsInf_gpcm(double theta, int item);
-	double obsInf_gpcm(double theta, int item, int answer);
-	double obsInf_ltm(double theta, int item);
-	double obsInf_ltm(double theta, int item, int answer);
+	double obsInf(double theta, int item) const;
+	double obsInf(double theta, int item, int answer) const;
 
-	double fisherInf(double theta, int item);
-	double fisherInf(double theta, int item, int answer);
+	double fisherInf(double theta, int item) const;
+	double fisherInf(double theta, int item, int answer) const;
+	/**
+	 * Fisher information of n items at theta, written to out; evaluated with the batch kernels in ItemModels.h.
+	 */
+	void fisherInf(double theta, const int *items, size_t n, double *out) const;
 
-	virtual double expectedPV(int item, Prior &prior);
-	virtual double expectedPV_ltm_tpm(int item, Prior &prior);
-	virtual double expectedPV_grm(int item, Prior &prior);
-	virtual double expectedPV_gpcm(int item, Prior &prior);
+	virtual double expectedPV(int item, Prior &prior) const;
+	virtual double expectedPV_ltm_tpm(int item, Prior &prior) const;
+	virtual double expectedPV_grm(int item, Prior &prior) const;
+	virtual double expectedPV_gpcm(int item, Prior &prior) const;
 
-	double expectedObsInf(int item, Prior &prior);
-	double expectedObsInf_grm(int item, Prior &prior);
-	double expectedObsInf_gpcm(int item, Prior &prior);
-	double expectedObsInf_rest(int item, Prior &prior);
-	
-	double fisherTestInfo(Prior prior);
-	double fisherTestInfo(Prior prior, size_t question, int answer);
+	double expectedObsInf(int item, Prior &prior) const;
+	double expectedObsInf_grm(int item, Prior &prior) const;
+	double expectedObsInf_gpcm(int item, Prior &prior) const;
+	double expectedObsInf_rest(int item, Prior &prior) const;
 	
-	double pwi(int item, Prior prior);
+	double fisherTestInfo(Prior prior) const;
+	double fisherTestInfo(Prior prior, size_t question, int answer) const;
 	
-	double lwi(int item);
+	double pwi(int item, Prior prior) const;
 	
-	double fii(int item, Prior prior);
+	double lwi(int item) const;
+
+	/**
+	 * pwi and lwi of n items, written to out. As with the block KL functions below, the items are the components
+	 * of one integral: the posterior (or likelihood) weight is evaluated once per point and multiplied into the
+	 * information of all n items from the batch fisherInf kernel.
+	 */
+	void pwi(const int *items, size_t n, Prior &prior, double *out) const;
+	void lwi(const int *items, size_t n, double *out) const;
 	
-	double expectedKL(int item, Prior prior);
+	double fii(int item, Prior prior) const;
 	
-	double likelihoodKL(int item, Prior prior);
+	double expectedKL(int item, Prior prior) const;
 	
-	double posteriorKL(int item, Prior prior);
+	double likelihoodKL(int item, Prior prior) const;
 	
-	double d1LL(double theta, bool use_prior, Prior &prior);
-	double d1LL(double theta, bool use_prior, Prior &prior, size_t question, int answer);
+	double posteriorKL(int item, Prior prior) const;
+
+	/**
+	 * Estimates theta once (and the test information at it, if with_test_info) for use by the item scores below.
+	 */
+	SelectionContext selectionContext(Prior &prior, bool with_test_info = false) const;
+
+	/**
+	 * The same item scores as the functions above, taking theta and the test information from context. The
+	 * selectors call these for every candidate item.
+	 */
+	double expectedPV_ltm_tpm(int item, const SelectionContext &context) const;
+	double expectedPV_grm(int item, const SelectionContext &context) const;
+	double expectedPV_gpcm(int item, const SelectionContext &context) const;
 
-	double d2LL(double theta, bool use_prior, Prior &prior);
-	double d2LL(double theta, bool use_prior, Prior &prior, size_t question, int answer);
+	double expectedObsInf_grm(int item, const SelectionContext &context) const;
+	double expectedObsInf_gpcm(int item, const SelectionContext &context) const;
+	double expectedObsInf_rest(int item, const SelectionContext &context) const;
 
-protected:
+	double fii(int item, const SelectionContext &context) const;
+	double expectedKL(int item, const SelectionContext &context) const;
+	double likelihoodKL(int item, const SelectionContext &context) const;
+	double posteriorKL(int item, const SelectionContext &context) const;
+
+	/**
+	 * expectedKL, likelihoodKL, and posteriorKL of n items, written to out. The items are the components of one
+	 * vector-valued integral, so the likelihood and prior at each point, and each item's log-probabilities at
+	 * context.theta, are computed once for all of them. Should the joint integral not converge within the
+	 * subinterval limit, the items are integrated one at a time as above.
+	 */
+	void expectedKL(const int *items, size_t n, const SelectionContext &context, double *out) const;
+	void likelihoodKL(const int *items, size_t n, const SelectionContext &context, double *out) const;
+	void posteriorKL(const int *items, size_t n, const SelectionContext &context, double *out) const;
+
+	/**
+	 * estimateTheta and estimateSE with one hypothetical answer, as the item scores above need them for every
+	 * candidate item and response option. MAP and MLE start their Newton iterations from context.theta, the
+	 * estimate from the stored answers, rather than from 0: one more answer moves the estimate only a little, so
+	 * the first step usually lands within a few multiples of the tolerance and the next step, which the iteration
+	 * stops on once it is below the tolerance, bounds the error. Other estimators ignore context.theta.
+	 */
+	virtual double hypotheticalTheta(const SelectionContext &context, size_t question, int answer) const;
+	virtual double hypotheticalSE(const SelectionContext &context, size_t question, int answer) const;
+	
+	double d1LL(double theta, bool use_prior, Prior &prior) const;
+	double d1LL(double theta, bool use_prior, Prior &prior, size_t question, int answer) const;
 
-	//for WLEEstimator
-	void prob_derivs_gpcm(double theta, size_t question, std::vector<double>& probs, std::vector<double>& first, std::vector<double>& second);
-	std::vector<double> prob_derivs_gpcm_first(double theta, size_t question);
+	double d2LL(double theta, bool use_prior, Prior &prior) const;
+	double d2LL(double theta, bool use_prior, Prior &prior, size_t question, int answer) const;
 
-	double prob_ltm(double theta, size_t question);
-  	std::vector<double> prob_grm(double theta, size_t question);
-  	std::pair<double,double> prob_grm_pair(double theta, size_t question, size_t at);
-  	std::vector<double> prob_gpcm(double theta, size_t question);
-  	double prob_gpcm_at(double theta, size_t question, size_t at);
+	/**
+	 * The log-likelihood and the same first and second derivatives as d1LL and d2LL, from one pass over the
+	 * answered items; the logarithms are skipped, leaving logL NAN, unless with_log. The prior only enters the
+	 * derivatives. The Newton iterations of MAP and MLE estimation use these.
+	 */
+	LikelihoodTerms likelihoodTerms(double theta, bool use_prior, Prior &prior, bool with_log = true) const;
+	LikelihoodTerms likelihoodTerms(double theta, bool use_prior, Prior &prior, size_t question, int answer,
+	                                bool with_log = true) const;
 
+protected:
+	/**
+	 * Sums of each applicable item's log-likelihood, first, and second derivative terms under Model (see
+	 * ItemModels.h), optionally including one additional hypothetical answer. The public functions switch on
+	 * questionSet.bank->model_type once and call these, so item loops and integrands built on them are compiled
+	 * separately for each model.
+	 */
+	template <class Model> double model_logLikelihood(double theta) const;
+	template <class Model> double model_logLikelihood(double theta, size_t question, int answer) const;
+	template <class Model> double model_d1LL(double theta) const;
+	template <class Model> double model_d1LL(double theta, size_t question, int answer) const;
+	template <class Model> double model_d2LL(double theta) const;
+	template <class Model> double model_d2LL(double theta, size_t question, int answer) const;
+	template <class Model> LikelihoodTerms model_terms(double theta, bool with_log) const;
+	template <class Model> LikelihoodTerms model_terms(double theta, bool with_log, size_t question, int answer) const;
 
 protected:
 	const Integrator &integrator;
-	QuestionSet &questionSet;
-	
-	double kl(double theta_not, int item, double theta);
+	const QuestionSet &questionSet;
 
 	/**
-	 * GSL's integration library requires a function taking a double (and, optionally, a void pointer),
-	 * and returning a double. To make things easier for usage here, a std::function with those parameters
-	 * is typedef-ed as integrableFunction. If integralQuotient is ever moved into Integrator (which it probably should
-	 * be), then this should be moved as well, and made public.
+	 * The root in [-5, 5] of function, which may be any callable taking and returning a double (see
+	 * GSLFunctionWrapper).
 	 */
-	typedef std::function<double(double)> integrableFunction;
-	
-	//double brentMethod(const integrableFunction &function);
-	double brentMethod(integrableFunction function);
+	template <class Function>
+	double brentMethod(const Function &function) const {
+		GSLFunctionWrapper<Function> wrapped(function);
+		return brentMethod(wrapped.asGSLFunction());
+	}
+	double brentMethod(gsl_function *function) const;
 	
-	double integrate_selectItem(const integrableFunction &function, const double lower, const double upper);
+	template <class Function>
+	double integrate_selectItem(const Function &function, const double lower, const double upper) const {
+		return integrator.integrate(function, integrationSubintervals, lower, upper);
+	}
 
 private:
 	/**
@@ -113,45 +186,99 @@ private:
 	 * requires a change in the GSL integration function used in Integrator.
 	 */
 	constexpr static double integrationSubintervals = 10;
-  
-    
-  
-  double likelihood_ltm(double theta);
-	double likelihood_grm(double theta);
-	double likelihood_gpcm(double theta);
-
-	double likelihood_ltm(double theta, size_t question, int answer);
-	double likelihood_grm(double theta, size_t question, int answer);
-	double likelihood_gpcm(double theta, size_t question, int answer);
-  
-  double grm_d1LL(double theta);
-	double gpcm_d1LL(double theta);
-	double ltm_d1LL(double theta);
-
-	double grm_d1LL(double theta, size_t question, int answer);
-	double gpcm_d1LL(double theta, size_t question, int answer);
-	double ltm_d1LL(double theta, size_t question, int answer);
-	
-	double grm_partial_d2LL(double theta, size_t question);	
-	double gpcm_partial_d2LL(double theta, size_t question);	
-	double gpcm_partial_d1LL(double theta, size_t question);	
 
-	double grm_partial_d2LL(double theta, size_t question, int answer);	
-	double gpcm_partial_d2LL(double theta, size_t question, int answer);	
-	double gpcm_partial_d1LL(double theta, size_t question, int answer);	
+	template <class Model> double pwi(int item, Prior &prior) const;
+	template <class Model> double lwi(int item) const;
+	/**
+	 * The block pwi of items if prior is given, and the block lwi otherwise.
+	 */
+	template <class Model> void weightedInfo(const int *items, size_t n, Prior *prior, double *out) const;
+	template <class Model> double fii(int item, const SelectionContext &context) const;
+	template <class Model> double expectedKL(int item, const SelectionContext &context) const;
+	template <class Model> double likelihoodKL(int item, const SelectionContext &context) const;
+	template <class Model> double posteriorKL(int item, const SelectionContext &context) const;
 
-  double grm_d2LL(double theta);
-	double gpcm_d2LL(double theta);
-	double ltm_d2LL(double theta);
+	/**
+	 * What the divergence of each item is multiplied by in the integrals of expectedKL, likelihoodKL, and
+	 * posteriorKL.
+	 */
+	enum class KLWeight {
+		NONE, LIKELIHOOD, POSTERIOR
+	};
+	void klBlock(const int *items, size_t n, const SelectionContext &context, KLWeight weight, double *out) const;
+	template <class Model>
+	void klBlock(const int *items, size_t n, const SelectionContext &context, KLWeight weight, double *out) const;
 
-	double grm_d2LL(double theta, size_t question, int answer);
-	double gpcm_d2LL(double theta, size_t question, int answer);
-	double ltm_d2LL(double theta, size_t question, int answer);
+	double testInfo(double theta) const;
 
-	double polytomous_posterior_variance(int item, Prior &prior);
-	double binary_posterior_variance(int item, Prior &prior);
-	
+protected:
+	/**
+	 * Fisher test information at theta, including the hypothetical answer to question.
+	 */
+	double testInfo(double theta, size_t question, int answer) const;
 
 };
 
 
+template <class Model>
+double Estimator::model_logLikelihood(double theta) const {
+	return Model::logLikelihood(*questionSet.bank, questionSet.applicable_rows.data(), questionSet.applicable_rows.size(),
+	                            questionSet.answers.data(), theta);
+}
+
+template <class Model>
+double Estimator::model_logLikelihood(double theta, size_t question, int answer) const {
+	return model_logLikelihood<Model>(theta) + Model::logResponse(*questionSet.bank, question, answer, theta);
+}
+
+template <class Model>
+double Estimator::model_d1LL(double theta) const {
+	double l_theta = 0.0;
+	for (auto question : questionSet.applicable_rows) {
+		l_theta += Model::d1(*questionSet.bank, question, questionSet.answers[question], theta);
+	}
+	return l_theta;
+}
+
+template <class Model>
+double Estimator::model_d1LL(double theta, size_t question, int answer) const {
+	return model_d1LL<Model>(theta) + Model::d1(*questionSet.bank, question, answer, theta);
+}
+
+template <class Model>
+double Estimator::model_d2LL(double theta) const {
+	double lambda_theta = 0.0;
+	for (auto question : questionSet.applicable_rows) {
+		lambda_theta += Model::d2(*questionSet.bank, question, questionSet.answers[question], theta);
+	}
+	return lambda_theta;
+}
+
+template <class Model>
+double Estimator::model_d2LL(double theta, size_t question, int answer) const {
+	return model_d2LL<Model>(theta) + Model::d2(*questionSet.bank, question, answer, theta);
+}
+
+template <class Model>
+LikelihoodTerms Estimator::model_terms(double theta, bool with_log) const {
+	LikelihoodTerms sum = {0.0, 0.0, 0.0};
+	LikelihoodTerms item;
+	for (auto question : questionSet.applicable_rows) {
+		Model::terms(*questionSet.bank, question, questionSet.answers[question], theta, with_log, item);
+		sum.logL += item.logL;
+		sum.d1 += item.d1;
+		sum.d2 += item.d2;
+	}
+	return sum;
+}
+
+template <class Model>
+LikelihoodTerms Estimator::model_terms(double theta, bool with_log, size_t question, int answer) const {
+	LikelihoodTerms sum = model_terms<Model>(theta, with_log);
+	LikelihoodTerms item;
+	Model::terms(*questionSet.bank, question, answer, theta, with_log, item);
+	sum.logL += item.logL;
+	sum.d1 += item.d1;
+	sum.d2 += item.d2;
+	return sum;
+}
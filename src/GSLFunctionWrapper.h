@@ -1,23 +1,34 @@
 #include <gsl/gsl_integration.h>
-#include <functional>
 #pragma once
 
 /**
  * GSL's integration library requires a function that conforms
  * to gsl_function. This template class enables lambdas which
  * would otherwise meet the requirements to be used as gsl_functions.
- * If this ends up being too slow, std::function can be replaced with a
- * template class.
+ * It refers to the callable by its own type rather than through a
+ * std::function, so the call from invoke is inlined; the callable
+ * must outlive the wrapper.
  */
-
+template <class Function>
 class GSLFunctionWrapper : public gsl_function {
 public:
-	GSLFunctionWrapper(std::function<double(double)> const &func);
+	explicit GSLFunctionWrapper(const Function &func) : _func(func) {
+		function = &GSLFunctionWrapper::invoke;
+		params = this;
+	}
+
+	// params points at the wrapper itself, so a copy would call through the original
+	GSLFunctionWrapper(const GSLFunctionWrapper &) = delete;
+	GSLFunctionWrapper &operator=(const GSLFunctionWrapper &) = delete;
 
-	gsl_function * asGSLFunction();
+	gsl_function *asGSLFunction() {
+		return static_cast<gsl_function *>(this);
+	}
 
 private:
-	std::function<double(double)> _func;
+	const Function &_func;
 
-	static double invoke(double x, void *params);
-};
\ No newline at end of file
+	static double invoke(double x, void *params) {
+		return static_cast<GSLFunctionWrapper *>(params)->_func(x);
+	}
+};
@@ -0,0 +1,358 @@
+#include "GridEAPEstimator.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include "Scratch.h"
+
+
+namespace {
+
+/**
+ * Overwrites diagonal with the eigenvalues of the symmetric tridiagonal matrix with the given diagonal and
+ * off-diagonal, by the implicit QL method (Press et al., Numerical Recipes, section 11.4) without eigenvectors.
+ */
+void tridiagonalEigenvalues(std::vector<double> &diagonal, std::vector<double> off_diagonal) {
+	const size_t n = diagonal.size();
+	off_diagonal.push_back(0.0);
+	for (size_t l = 0; l < n; ++l) {
+		int iteration = 0;
+		size_t m;
+		do {
+			for (m = l; m + 1 < n; ++m) {
+				const double scale = std::abs(diagonal[m]) + std::abs(diagonal[m + 1]);
+				if (std::abs(off_diagonal[m]) <= std::numeric_limits<double>::epsilon() * scale) break;
+			}
+			if (m == l) break;
+			if (++iteration > 60) {
+				throw std::domain_error("Gauss-Hermite nodes did not converge.");
+			}
+
+			double g = (diagonal[l + 1] - diagonal[l]) / (2.0 * off_diagonal[l]);
+			double r = std::hypot(g, 1.0);
+			g = diagonal[m] - diagonal[l] + off_diagonal[l] / (g + std::copysign(r, g));
+			double s = 1.0, c = 1.0, p = 0.0;
+			bool deflated = false;
+			for (size_t i = m; i-- > l;) {
+				const double f = s * off_diagonal[i];
+				const double b = c * off_diagonal[i];
+				r = std::hypot(f, g);
+				off_diagonal[i + 1] = r;
+				if (r == 0.0) {
+					// The matrix split; start again on the smaller block
+					diagonal[i + 1] -= p;
+					off_diagonal[m] = 0.0;
+					deflated = true;
+					break;
+				}
+				s = f / r;
+				c = g / r;
+				g = diagonal[i + 1] - p;
+				r = (diagonal[i] - g) * s + 2.0 * c * b;
+				p = s * r;
+				diagonal[i + 1] = g + p;
+				g = c * r - b;
+			}
+			if (deflated) continue;
+			diagonal[l] -= p;
+			off_diagonal[l] = g;
+			off_diagonal[m] = 0.0;
+		} while (m != l);
+	}
+}
+
+}
+
+
+GridEAPEstimator::GridEAPEstimator(Integrator &integrator, const QuestionSet &questionSet, const CatControl &control)
+		: EAPEstimator(integrator, questionSet),
+		  quadrature(control.quadrature),
+		  points((size_t) control.quadraturePoints),
+		  incremental_updates(0),
+		  grid_built(false),
+		  prior_param0(NAN),
+		  prior_param1(NAN) { }
+
+double GridEAPEstimator::estimateTheta(Prior prior) const {
+	double mean, variance;
+	posterior_moments(prior, false, 0, 0, mean, variance);
+	return mean;
+}
+
+double GridEAPEstimator::estimateTheta(Prior prior, size_t question, int answer) const {
+	double mean, variance;
+	posterior_moments(prior, true, question, answer, mean, variance);
+	return mean;
+}
+
+double GridEAPEstimator::estimateSE(Prior prior) const {
+	double mean, variance;
+	posterior_moments(prior, false, 0, 0, mean, variance);
+	return std::pow(variance, 0.5);
+}
+
+double GridEAPEstimator::estimateSE(Prior prior, size_t question, int answer) const {
+	double mean, variance;
+	posterior_moments(prior, true, question, answer, mean, variance);
+	return std::pow(variance, 0.5);
+}
+
+double GridEAPEstimator::hypotheticalSE(const SelectionContext &context, size_t question, int answer) const {
+	return estimateSE(context.prior, question, answer);
+}
+
+void GridEAPEstimator::posterior_moments(const Prior &prior, bool hypothetical, size_t question, int answer,
+                                         double &mean, double &variance) const {
+	if (grid_built && prior.param0() == prior_param0 && prior.param1() == prior_param1) {
+		posterior_moments(nodes, log_weights, log_likelihood, hypothetical, question, answer, mean, variance);
+		return;
+	}
+
+	// A prior other than the one sync last saw (or a grid sync could not build) is integrated from scratch,
+	// leaving the cached grid as it is
+	std::vector<double> other_nodes, other_weights, other_likelihood;
+	build_grid(prior, other_nodes, other_weights);
+	likelihood_at(other_nodes, other_likelihood);
+	posterior_moments(other_nodes, other_weights, other_likelihood, hypothetical, question, answer, mean, variance);
+}
+
+void GridEAPEstimator::posterior_moments(const std::vector<double> &grid_nodes,
+                                         const std::vector<double> &grid_weights,
+                                         const std::vector<double> &grid_likelihood, bool hypothetical,
+                                         size_t question, int answer, double &mean, double &variance) const {
+	const size_t n = grid_nodes.size();
+	ScratchBuffer log_posterior(n);
+	for (size_t i = 0; i < n; ++i) {
+		log_posterior[i] = grid_weights[i] + grid_likelihood[i];
+	}
+	if (hypothetical) {
+		ScratchBuffer response(n);
+		log_responses(question, answer, grid_nodes, response.data());
+		for (size_t i = 0; i < n; ++i) {
+			log_posterior[i] += response[i];
+		}
+	}
+
+	// Scaling by the largest value keeps the weights representable when the likelihood is tiny everywhere
+	double max_log = -INFINITY;
+	for (size_t i = 0; i < n; ++i) {
+		if (!std::isnan(log_posterior[i])) max_log = std::max(max_log, log_posterior[i]);
+	}
+	if (!std::isfinite(max_log)) {
+		throw std::domain_error("Posterior is zero at every quadrature point.");
+	}
+
+	double total = 0.0, first = 0.0;
+	for (size_t i = 0; i < n; ++i) {
+		log_posterior[i] = std::isnan(log_posterior[i]) ? 0.0 : std::exp(log_posterior[i] - max_log);
+		total += log_posterior[i];
+		first += log_posterior[i] * grid_nodes[i];
+	}
+	mean = first / total;
+
+	double second = 0.0;
+	for (size_t i = 0; i < n; ++i) {
+		const double theta_difference = grid_nodes[i] - mean;
+		second += log_posterior[i] * theta_difference * theta_difference;
+	}
+	variance = second / total;
+}
+
+void GridEAPEstimator::sync(const Prior &prior) {
+	if (!grid_built || prior.param0() != prior_param0 || prior.param1() != prior_param1) {
+		try {
+			build_grid(prior, nodes, log_weights);
+		}
+		catch (std::domain_error &) {
+			// Reported by the estimates, which build the grid again, rather than when the answers change
+			grid_built = false;
+			return;
+		}
+		prior_param0 = prior.param0();
+		prior_param1 = prior.param1();
+		grid_built = true;
+		recompute_likelihood();
+		return;
+	}
+
+	// Answers can be changed through reset_answer or reset_answers, so compare against what the cached
+	// likelihood includes rather than relying on callers to say which items changed.
+	std::vector<int> current(questionSet.answers.size(), NA_INTEGER);
+	for (auto question : questionSet.applicable_rows) {
+		current[question] = questionSet.answers[question];
+	}
+
+	std::vector<size_t> changed;
+	for (size_t q = 0; q < current.size(); ++q) {
+		if (current[q] != included_answers[q]) changed.push_back(q);
+	}
+	if (changed.empty()) {
+		return;
+	}
+
+	// Rebuilding from scratch is no more expensive once most answers changed, and periodically doing so keeps
+	// rounding error from repeated additions and subtractions from accumulating.
+	incremental_updates += changed.size();
+	if (changed.size() >= questionSet.applicable_rows.size() || incremental_updates > 4 * current.size()) {
+		recompute_likelihood();
+		return;
+	}
+
+	bool removed_infinite = false;
+	std::vector<double> response(nodes.size());
+	for (auto q : changed) {
+		if (included_answers[q] != NA_INTEGER) {
+			log_responses(q, included_answers[q], nodes, response.data());
+			for (size_t i = 0; i < nodes.size(); ++i) {
+				removed_infinite |= !std::isfinite(response[i]);
+				log_likelihood[i] -= response[i];
+			}
+		}
+		if (current[q] != NA_INTEGER) {
+			log_responses(q, current[q], nodes, response.data());
+			for (size_t i = 0; i < nodes.size(); ++i) {
+				log_likelihood[i] += response[i];
+			}
+		}
+		included_answers[q] = current[q];
+	}
+
+	// A zero probability cannot be divided back out of the likelihood
+	if (removed_infinite) {
+		recompute_likelihood();
+	}
+}
+
+void GridEAPEstimator::build_grid(const Prior &prior, std::vector<double> &grid_nodes,
+                                  std::vector<double> &grid_weights) const {
+	const double lower = questionSet.bank->lowerBound;
+	const double upper = questionSet.bank->upperBound;
+
+	grid_nodes.clear();
+	grid_weights.clear();
+
+	if (quadrature == "rectangular") {
+		const double width = (upper - lower) / points;
+		for (size_t i = 0; i < points; ++i) {
+			grid_nodes.push_back(lower + (i + 0.5) * width);
+			grid_weights.push_back(std::log(width));
+		}
+	}
+	else {
+		std::vector<double> x, w;
+		gaussHermite(points, x, w);
+
+		// With a normal prior the nodes follow the prior, so the prior is integrated exactly. Otherwise the
+		// nodes are spread over the bounds of integration.
+		double center, scale;
+		if (prior.type() == PriorType::NORMAL) {
+			center = prior.param0();
+			scale = prior.param1();
+		}
+		else {
+			center = (lower + upper) / 2.0;
+			scale = (upper - center) / (M_SQRT2 * x.front());
+		}
+
+		for (size_t i = 0; i < x.size(); ++i) {
+			const double theta = center + M_SQRT2 * scale * x[i];
+			if (theta < lower || theta > upper) continue;
+			grid_nodes.push_back(theta);
+			// change of variables from exp(-x^2) dx to d(theta)
+			grid_weights.push_back(std::log(w[i]) + x[i] * x[i] + std::log(M_SQRT2 * scale));
+		}
+	}
+
+	if (grid_nodes.empty()) {
+		throw std::domain_error("No quadrature points fall between lowerBound and upperBound.");
+	}
+
+	for (size_t i = 0; i < grid_nodes.size(); ++i) {
+		grid_weights[i] += std::log(prior.prior(grid_nodes[i]));
+	}
+}
+
+void GridEAPEstimator::likelihood_at(const std::vector<double> &grid_nodes, std::vector<double> &values) const {
+	values.assign(grid_nodes.size(), 0.0);
+	std::vector<double> response(grid_nodes.size());
+	for (auto question : questionSet.applicable_rows) {
+		log_responses(question, questionSet.answers[question], grid_nodes, response.data());
+		for (size_t i = 0; i < grid_nodes.size(); ++i) {
+			values[i] += response[i];
+		}
+	}
+}
+
+void GridEAPEstimator::recompute_likelihood() {
+	likelihood_at(nodes, log_likelihood);
+	included_answers.assign(questionSet.answers.size(), NA_INTEGER);
+	for (auto question : questionSet.applicable_rows) {
+		included_answers[question] = questionSet.answers[question];
+	}
+	incremental_updates = 0;
+}
+
+void GridEAPEstimator::log_responses(size_t question, int answer, const std::vector<double> &grid_nodes,
+                                     double *values) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		log_responses<GRMModel>(question, answer, grid_nodes, values);
+		break;
+	case ModelType::GPCM:
+		log_responses<GPCMModel>(question, answer, grid_nodes, values);
+		break;
+	default:
+		log_responses<BinaryModel>(question, answer, grid_nodes, values);
+	}
+}
+
+template <class Model>
+void GridEAPEstimator::log_responses(size_t question, int answer, const std::vector<double> &grid_nodes,
+                                     double *values) const {
+	Model::logResponses(*questionSet.bank, question, answer, grid_nodes.data(), grid_nodes.size(), values);
+}
+
+void GridEAPEstimator::gaussHermite(size_t n, std::vector<double> &nodes, std::vector<double> &weights) {
+	// The nodes are the eigenvalues of the Jacobi matrix of the Hermite recurrence (Golub and Welsch), which, unlike
+	// Newton's method from asymptotic initial guesses, finds every root for any n. Each node is then polished by
+	// Newton's method on the orthonormal recurrence, whose derivative also gives the weight to full relative
+	// accuracy even where it is as small as exp(-x^2) at the largest nodes.
+	const double pi_to_minus_quarter = 0.7511255444649425;
+	nodes.assign(n, 0.0);
+	weights.assign(n, 0.0);
+
+	std::vector<double> off_diagonal;
+	for (size_t k = 1; k < n; ++k) {
+		off_diagonal.push_back(std::sqrt(k / 2.0));
+	}
+	tridiagonalEigenvalues(nodes, off_diagonal);
+	std::sort(nodes.begin(), nodes.end(), std::greater<double>());
+
+	for (size_t i = 0; i < (n + 1) / 2; ++i) {
+		double z = nodes[i], derivative = 0.0;
+		bool converged = false;
+		for (int iteration = 0; iteration < 100 && !converged; ++iteration) {
+			double p1 = pi_to_minus_quarter, p2 = 0.0;
+			for (size_t j = 0; j < n; ++j) {
+				const double p3 = p2;
+				p2 = p1;
+				p1 = z * std::sqrt(2.0 / (j + 1)) * p2 - std::sqrt(((double) j) / (j + 1)) * p3;
+			}
+			derivative = std::sqrt(2.0 * n) * p2;
+			const double previous = z;
+			z = previous - p1 / derivative;
+			converged = std::abs(z - previous) <= 1e-14 * std::max(1.0, std::abs(z));
+		}
+		if (!converged) {
+			throw std::domain_error("Gauss-Hermite nodes did not converge.");
+		}
+
+		// The middle node of an odd rule is zero
+		if (2 * i + 1 == n) z = 0.0;
+		nodes[i] = z;
+		nodes[n - 1 - i] = -z;
+		weights[i] = 2.0 / (derivative * derivative);
+		weights[n - 1 - i] = weights[i];
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "EAPEstimator.h"
+#include "CatControl.h"
+#include "Prior.h"
+
+
+/**
+ * EAP estimation on a fixed set of quadrature nodes. The log-likelihood of the stored answers is kept for every
+ * node and brought up to date by sync, which only adds or removes the items whose answers changed since it last
+ * ran, so storing an answer costs O(nodes) and theta, SE, and hypothetical-answer estimates are weighted sums over
+ * the nodes that read the cached likelihood without locking or writing it.
+ */
+class GridEAPEstimator : public EAPEstimator {
+
+public:
+
+	GridEAPEstimator(Integrator &integrator, const QuestionSet &questionSet, const CatControl &control);
+
+	virtual double estimateTheta(Prior prior) const override;
+	virtual double estimateTheta(Prior prior, size_t question, int answer) const override;
+
+	virtual double estimateSE(Prior prior) const override;
+	virtual double estimateSE(Prior prior, size_t question, int answer) const override;
+	/**
+	 * The grid's variance is already taken about the mean, so this is estimateSE with the hypothetical answer.
+	 */
+	virtual double hypotheticalSE(const SelectionContext &context, size_t question, int answer) const override;
+
+	virtual void sync(const Prior &prior) override;
+
+	/**
+	 * Gauss-Hermite nodes and weights for the weight function exp(-x^2).
+	 */
+	static void gaussHermite(size_t n, std::vector<double> &nodes, std::vector<double> &weights);
+
+private:
+	/**
+	 * The nodes for prior and the log of the quadrature weight times the prior density at each of them.
+	 */
+	void build_grid(const Prior &prior, std::vector<double> &grid_nodes, std::vector<double> &grid_weights) const;
+	/**
+	 * The log-likelihood of the stored answers at each of grid_nodes.
+	 */
+	void likelihood_at(const std::vector<double> &grid_nodes, std::vector<double> &values) const;
+	void recompute_likelihood();
+
+	/**
+	 * The log-probability of answer to question at each of grid_nodes, written to values.
+	 */
+	void log_responses(size_t question, int answer, const std::vector<double> &grid_nodes, double *values) const;
+	template <class Model>
+	void log_responses(size_t question, int answer, const std::vector<double> &grid_nodes, double *values) const;
+
+	/**
+	 * Posterior mean and variance over the nodes, optionally including one additional hypothetical answer.
+	 */
+	void posterior_moments(const Prior &prior, bool hypothetical, size_t question, int answer,
+	                       double &mean, double &variance) const;
+	void posterior_moments(const std::vector<double> &grid_nodes, const std::vector<double> &grid_weights,
+	                       const std::vector<double> &grid_likelihood, bool hypothetical, size_t question, int answer,
+	                       double &mean, double &variance) const;
+
+	std::string quadrature;
+	size_t points;
+
+	/**
+	 * The grid and likelihood for the prior and answers sync last saw.
+	 */
+	std::vector<double> nodes;
+	/**
+	 * log of the quadrature weight times the prior density at each node.
+	 */
+	std::vector<double> log_weights;
+	std::vector<double> log_likelihood;
+
+	/**
+	 * The answer to each item currently included in log_likelihood (NA_INTEGER if none).
+	 */
+	std::vector<int> included_answers;
+	size_t incremental_updates;
+
+	bool grid_built;
+	double prior_param0;
+	double prior_param1;
+};
@@ -0,0 +1,84 @@
+#include "InfoBounds.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include "ItemModels.h"
+#include "SharedRegistry.h"
+
+
+InfoBounds::InfoBounds(const std::shared_ptr<const ItemBank> &bank, std::size_t bins)
+		: bank(bank),
+		  bin_count(bins),
+		  lower(bank->lowerBound),
+		  width((bank->upperBound - bank->lowerBound) / double(bins)),
+		  order(bins * bank->size()),
+		  values(bins * bank->size()) {
+	switch (bank->model_type) {
+	case ModelType::GRM:
+		fill<GRMModel>();
+		break;
+	case ModelType::GPCM:
+		fill<GPCMModel>();
+		break;
+	default:
+		fill<BinaryModel>();
+	}
+}
+
+template <class Model>
+void InfoBounds::fill() {
+	const std::size_t items = bank->size();
+	std::vector<double> bound(items);
+	for (std::size_t bin = 0; bin < bin_count; ++bin) {
+		const double bin_lower = lower + bin * width;
+		const double bin_upper = bin + 1 == bin_count ? bank->upperBound : lower + (bin + 1) * width;
+		for (std::size_t item = 0; item < items; ++item) {
+			try {
+				bound[item] = Model::infoBound(*bank, item, bin_lower, bin_upper);
+			}
+			catch (std::domain_error &) {
+				// An item whose probabilities cannot be computed at the ends of the bin is never skipped
+				bound[item] = std::numeric_limits<double>::infinity();
+			}
+			// Room for the rounding of fisherInf, whose terms are as large as discrimination^2 per category
+			const double categories = double(bank->threshold_count(item) + 1);
+			bound[item] += 1e-9 * bound[item] +
+			               1e-12 * std::pow(bank->discrimination[item] * categories, 2.0);
+			// Nor is a degenerate item whose bound is NaN, which would also break the ordering below
+			if (std::isnan(bound[item])) {
+				bound[item] = std::numeric_limits<double>::infinity();
+			}
+		}
+
+		int *bin_order = order.data() + bin * items;
+		std::iota(bin_order, bin_order + items, 0);
+		std::stable_sort(bin_order, bin_order + items, [&](int a, int b) {
+			return bound[a] > bound[b];
+		});
+		double *bin_values = values.data() + bin * items;
+		for (std::size_t i = 0; i < items; ++i) {
+			bin_values[i] = bound[bin_order[i]];
+		}
+	}
+}
+
+std::shared_ptr<const InfoBounds> InfoBounds::shared(const std::shared_ptr<const ItemBank> &bank, std::size_t bins) {
+	static SharedRegistry<std::pair<const ItemBank *, std::size_t>, const InfoBounds> registry;
+
+	// The bounds hold their bank, so the bank's address is not reused while they are registered
+	return registry.get(std::make_pair(bank.get(), bins), [&]() {
+		return std::make_shared<InfoBounds>(bank, bins);
+	});
+}
+
+bool InfoBounds::bin(double theta, std::size_t &bin) const {
+	const double position = (theta - lower) / width;
+	if (!(position >= 0.0 && position <= double(bin_count))) {
+		return false;
+	}
+	bin = std::min(std::size_t(position), bin_count - 1);
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "ItemBank.h"
+
+
+/**
+ * Upper bounds on the Fisher information of every item in a bank over each of a number of equal bins of thetas
+ * from lowerBound to upperBound, for exact MFI selection over large banks. Within each bin the items are ordered
+ * by their bound, largest first, so a search for the item with the most information at a theta can stop at the
+ * first item whose bound is below the best information found.
+ *
+ * The bounds come from each model's infoBound, widened slightly so that they also hold for the information as
+ * rounded by the batch kernels. Like InfoTable, the bounds are built once and shared by every Cat with the same
+ * bank and number of bins.
+ */
+class InfoBounds {
+public:
+	InfoBounds(const std::shared_ptr<const ItemBank> &bank, std::size_t bins);
+
+	InfoBounds(const InfoBounds &) = delete;
+	InfoBounds &operator=(const InfoBounds &) = delete;
+
+	/**
+	 * The bounds for bank with the given number of bins that are in use by some Cat, or new ones.
+	 */
+	static std::shared_ptr<const InfoBounds> shared(const std::shared_ptr<const ItemBank> &bank, std::size_t bins);
+
+	/**
+	 * Sets bin to the bin holding theta and returns true, or returns false if theta is outside every bin.
+	 */
+	bool bin(double theta, std::size_t &bin) const;
+
+	/**
+	 * Every item of the bank, in decreasing order of its bound in bin (ties in increasing item order).
+	 */
+	const int *items(std::size_t bin) const {
+		return order.data() + bin * bank->size();
+	}
+
+	/**
+	 * The bounds of the items in the order of items(bin).
+	 */
+	const double *bounds(std::size_t bin) const {
+		return values.data() + bin * bank->size();
+	}
+
+	std::size_t bins() const {
+		return bin_count;
+	}
+
+private:
+	template <class Model> void fill();
+
+	const std::shared_ptr<const ItemBank> bank;
+	const std::size_t bin_count;
+	const double lower;
+	const double width;
+	std::vector<int> order;
+	std::vector<double> values;
+};
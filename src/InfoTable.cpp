@@ -0,0 +1,64 @@
+#include "InfoTable.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+#include <vector>
+#include "ItemModels.h"
+#include "SharedRegistry.h"
+
+
+InfoTable::InfoTable(const std::shared_ptr<const ItemBank> &bank, std::size_t points)
+		: bank(bank),
+		  point_count(points),
+		  lower(bank->lowerBound),
+		  step((bank->upperBound - bank->lowerBound) / double(points - 1)),
+		  values(points * bank->size()) {
+	switch (bank->model_type) {
+	case ModelType::GRM:
+		fill<GRMModel>();
+		break;
+	case ModelType::GPCM:
+		fill<GPCMModel>();
+		break;
+	default:
+		fill<BinaryModel>();
+	}
+}
+
+template <class Model>
+void InfoTable::fill() {
+	const std::size_t items = bank->size();
+	std::vector<int> all(items);
+	std::iota(all.begin(), all.end(), 0);
+	for (std::size_t point = 0; point < point_count; ++point) {
+		const double theta = point + 1 == point_count ? bank->upperBound : lower + point * step;
+		Model::fisherInf(*bank, all.data(), items, theta, values.data() + point * items);
+	}
+}
+
+std::shared_ptr<const InfoTable> InfoTable::shared(const std::shared_ptr<const ItemBank> &bank, std::size_t points) {
+	static SharedRegistry<std::pair<const ItemBank *, std::size_t>, const InfoTable> registry;
+
+	// A table holds its bank, so the bank's address is not reused while the table is registered
+	return registry.get(std::make_pair(bank.get(), points), [&]() {
+		return std::make_shared<InfoTable>(bank, points);
+	});
+}
+
+bool InfoTable::interpolate(double theta, const int *items, std::size_t n, double *out) const {
+	const double position = (theta - lower) / step;
+	if (!(position >= 0.0 && position <= double(point_count - 1))) {
+		return false;
+	}
+
+	const std::size_t point = std::min(std::size_t(position), point_count - 2);
+	const double fraction = position - double(point);
+	const double *below = values.data() + point * bank->size();
+	const double *above = below + bank->size();
+	for (std::size_t i = 0; i < n; ++i) {
+		const int item = items[i];
+		out[i] = below[item] + fraction * (above[item] - below[item]);
+	}
+	return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include "ItemBank.h"
+
+
+/**
+ * The Fisher information of every item in a bank on an evenly spaced grid of thetas from lowerBound to
+ * upperBound, for MFI selection over large banks. The values are stored one grid point after another, each
+ * point holding all the items in bank order, so interpolating a run of items at one theta reads two
+ * neighbouring rows of the table.
+ *
+ * Tables are built once and shared, like the bank itself, by every Cat with the same bank and number of points.
+ */
+class InfoTable {
+public:
+	InfoTable(const std::shared_ptr<const ItemBank> &bank, std::size_t points);
+
+	InfoTable(const InfoTable &) = delete;
+	InfoTable &operator=(const InfoTable &) = delete;
+
+	/**
+	 * The table for bank with the given number of points that is in use by some Cat, or a new one.
+	 */
+	static std::shared_ptr<const InfoTable> shared(const std::shared_ptr<const ItemBank> &bank, std::size_t points);
+
+	/**
+	 * Writes the information of n items at theta, interpolated linearly between the grid points, to out and
+	 * returns true; returns false without writing anything if theta is outside the grid.
+	 */
+	bool interpolate(double theta, const int *items, std::size_t n, double *out) const;
+
+	std::size_t points() const {
+		return point_count;
+	}
+
+private:
+	template <class Model> void fill();
+
+	const std::shared_ptr<const ItemBank> bank;
+	const std::size_t point_count;
+	const double lower;
+	const double step;
+	AlignedVector<double> values;
+};
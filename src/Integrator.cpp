@@ -1,20 +1,198 @@
 #include "Integrator.h"
 #include <gsl/gsl_integration.h>
 #include <gsl/gsl_errno.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <stdexcept>
+#include "Scratch.h"
+
+
+namespace {
+
+/**
+ * The 61-point Gauss-Kronrod rule on [-1, 1], as in QUADPACK's qk61: the nonnegative Kronrod nodes from largest to
+ * smallest, and the Gauss weights of the nodes with odd indices, which are the 30-point Gauss nodes.
+ */
+const double kronrodNodes[31] = {
+	9.99484410050490601485e-01, 9.96893484074649505189e-01, 9.91630996870404568533e-01,
+	9.83668123279747175225e-01, 9.73116322501126229660e-01, 9.60021864968307547805e-01,
+	9.44374444748560026852e-01, 9.26200047429274309074e-01, 9.05573307699907847912e-01,
+	8.82560535792052736070e-01, 8.57205233546061151628e-01, 8.29565762382768356886e-01,
+	7.99727835821839039276e-01, 7.67777432104826185189e-01, 7.33790062453226754613e-01,
+	6.97850494793315845321e-01, 6.60061064126626906301e-01, 6.20526182989242891530e-01,
+	5.79345235826361659726e-01, 5.36624148142019863350e-01, 4.92480467861778570260e-01,
+	4.47033769538089154061e-01, 4.00401254830394404127e-01, 3.52704725530878115958e-01,
+	3.04073202273625053937e-01, 2.54636926167889854344e-01, 2.04525116682309882066e-01,
+	1.53869913608583541720e-01, 1.02806937966737024781e-01, 5.14718425553176983644e-02,
+	0.0
+};
+
+const double kronrodWeights[31] = {
+	1.38901369867700766499e-03, 3.89046112709988400891e-03, 6.63070391593129256080e-03,
+	9.27327965951776390929e-03, 1.18230152534963411926e-02, 1.43697295070458041372e-02,
+	1.69208891890532710234e-02, 1.94141411939423823296e-02, 2.18280358216091929791e-02,
+	2.41911620780805997066e-02, 2.65099548823331011838e-02, 2.87540487650412915355e-02,
+	3.09072575623877618400e-02, 3.29814470574837231842e-02, 3.49793380280600252341e-02,
+	3.68823646518212297507e-02, 3.86789456247275953427e-02, 4.03745389515359556776e-02,
+	4.19698102151642438162e-02, 4.34525397013560688020e-02, 4.48148001331626633092e-02,
+	4.60592382710069900287e-02, 4.71855465692991513094e-02, 4.81858617570871325397e-02,
+	4.90554345550297810075e-02, 4.97956834270742096371e-02, 5.04059214027823485060e-02,
+	5.08817958987496099521e-02, 5.12215478492587736326e-02, 5.14261285374590232378e-02,
+	5.14947294294515675595e-02
+};
+
+const double gaussWeights[15] = {
+	7.96819249616660500724e-03, 1.84664683110909583208e-02, 2.87847078833233689654e-02,
+	3.87991925696270500978e-02, 4.84026728305940526220e-02, 5.74931562176190652513e-02,
+	6.59742298821804906694e-02, 7.37559747377052044026e-02, 8.07558952294202131439e-02,
+	8.68997872010829758294e-02, 9.21225222377861224787e-02, 9.63687371746442533738e-02,
+	9.95934205867952671021e-02, 1.01762389748405499001e-01, 1.02852652893558840774e-01
+};
+
+const size_t rulePoints = 61;
+
+/**
+ * The GSL workspaces a thread has used. An integral started from inside the integrand of another takes the next
+ * one, so they are taken and returned in LIFO order, as ScratchBuffers are.
+ */
+struct WorkspaceStack {
+	std::vector<gsl_integration_workspace *> workspaces;
+	std::vector<size_t> limits;
+	size_t depth = 0;
+
+	~WorkspaceStack() {
+		for (gsl_integration_workspace *workspace : workspaces) {
+			if (workspace != nullptr) {
+				gsl_integration_workspace_free(workspace);
+			}
+		}
+	}
+};
+
+std::atomic<size_t> workspaceCount(0);
+
+WorkspaceStack &threadWorkspaces() {
+	static thread_local WorkspaceStack stack;
+	return stack;
+}
+
+/**
+ * A workspace for at least the given number of subintervals, held for one integral.
+ */
+class WorkspaceLease {
+public:
+	explicit WorkspaceLease(const size_t intervals) : stack(threadWorkspaces()) {
+		if (stack.depth == stack.workspaces.size()) {
+			stack.workspaces.push_back(nullptr);
+			stack.limits.push_back(0);
+		}
+
+		if (stack.limits[stack.depth] < intervals) {
+			gsl_integration_workspace *replacement = gsl_integration_workspace_alloc(intervals);
+			// Malloc returns a null pointer if there is insufficient memory available
+			// If the workspace allocator returns that null pointer, nothing below
+			// will work - it will rely on dereferencing a null pointer.
+			if (replacement == nullptr) {
+				// No error message is permitted when throwing bad_alloc,
+				// because it needs to be able to be constructed without
+				// using any additional memory
+				throw std::bad_alloc();
+			}
+			if (stack.workspaces[stack.depth] != nullptr) {
+				gsl_integration_workspace_free(stack.workspaces[stack.depth]);
+			}
+			stack.workspaces[stack.depth] = replacement;
+			stack.limits[stack.depth] = intervals;
+			workspaceCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		workspace = stack.workspaces[stack.depth];
+		++stack.depth;
+	}
+
+	~WorkspaceLease() {
+		--stack.depth;
+	}
+
+	WorkspaceLease(const WorkspaceLease &) = delete;
+	WorkspaceLease &operator=(const WorkspaceLease &) = delete;
+
+	gsl_integration_workspace *get() const {
+		return workspace;
+	}
+
+private:
+	WorkspaceStack &stack;
+	gsl_integration_workspace *workspace;
+};
+
+/**
+ * The points of the rule on [lower, upper]: the center, then each pair of nodes below and above it.
+ */
+void rulePointsOn(const double lower, const double upper, double *points) {
+	const double center = 0.5 * (lower + upper);
+	const double half_length = 0.5 * (upper - lower);
+	points[0] = center;
+	for (size_t j = 0; j < 30; ++j) {
+		const double offset = half_length * kronrodNodes[j];
+		points[2 * j + 1] = center - offset;
+		points[2 * j + 2] = center + offset;
+	}
+}
+
+/**
+ * Applies the rule to every component on [lower, upper], with QUADPACK's estimate of the error. values holds the
+ * components at each of the points from rulePointsOn. The error equals the deviation of the component from its
+ * mean when the Gauss and Kronrod results disagree too much for the estimate to be trusted.
+ */
+void gaussKronrod(const size_t components, const double lower, const double upper, const double *values,
+                  double *results, double *errors, double *deviations) {
+	const double half_length = 0.5 * (upper - lower);
+
+	for (size_t k = 0; k < components; ++k) {
+		const double center_value = values[k];
+		double kronrod = kronrodWeights[30] * center_value;
+		double gauss = 0.0;
+		double absolute = std::abs(kronrod);
+		for (size_t j = 0; j < 30; ++j) {
+			const double left = values[(2 * j + 1) * components + k];
+			const double right = values[(2 * j + 2) * components + k];
+			kronrod += kronrodWeights[j] * (left + right);
+			absolute += kronrodWeights[j] * (std::abs(left) + std::abs(right));
+			if (j % 2 == 1) {
+				gauss += gaussWeights[j / 2] * (left + right);
+			}
+		}
+
+		const double mean = 0.5 * kronrod;
+		double deviation = kronrodWeights[30] * std::abs(center_value - mean);
+		for (size_t j = 0; j < 30; ++j) {
+			deviation += kronrodWeights[j] * (std::abs(values[(2 * j + 1) * components + k] - mean) +
+			                                  std::abs(values[(2 * j + 2) * components + k] - mean));
+		}
+
+		results[k] = kronrod * half_length;
+		absolute *= std::abs(half_length);
+		deviation *= std::abs(half_length);
+		double error = std::abs((kronrod - gauss) * half_length);
+		if (deviation != 0.0 && error != 0.0) {
+			error = deviation * std::min(1.0, std::pow(200.0 * error / deviation, 1.5));
+		}
+		if (absolute > GSL_DBL_MIN / (50.0 * GSL_DBL_EPSILON)) {
+			error = std::max(50.0 * GSL_DBL_EPSILON * absolute, error);
+		}
+		errors[k] = error;
+		deviations[k] = deviation;
+	}
+}
+
+}
 
 double Integrator::integrate(const gsl_function *function, const size_t intervals,
                              const double lower, const double upper) const {
-	gsl_integration_workspace *workspace = gsl_integration_workspace_alloc(intervals);
-	// Malloc returns a null pointer if there is insufficient memory available
-	// If the workspace allocator returns that null pointer, nothing below
-	// will work - it will rely on dereferencing a null pointer.
-	if (workspace == nullptr) {
-		// No error message is permitted when throwing bad_alloc,
-		// because it needs to be able to be constructed without
-		// using any additional memory
-		throw std::bad_alloc();
-	}
+	// The workspace is kept by this thread for its next integral, which is usually one more of the same size
+	WorkspaceLease workspace(intervals);
 
 	double result, absolute_error;
 	const int integration_method = GSL_INTEG_GAUSS61;
@@ -23,10 +201,7 @@ double Integrator::integrate(const gsl_function *function, const size_t interval
 
 
 	int error_code = gsl_integration_qag(function, lower, upper, relative_error_limit, absolute_error_limit,
-	                                     intervals, integration_method, workspace, &result, &absolute_error);
-
-	// Always ensure that any allocated memory is freed
-	gsl_integration_workspace_free(workspace);
+	                                     intervals, integration_method, workspace.get(), &result, &absolute_error);
 
 	if (error_code != GSL_SUCCESS) {
 		const char *error_message = gsl_strerror(error_code);
@@ -36,3 +211,85 @@ double Integrator::integrate(const gsl_function *function, const size_t interval
 	return result;
 }
 
+void Integrator::integratePoints(const PointFunction &function, const size_t components, const size_t intervals,
+                                 const double lower, const double upper, double *results) const {
+	const double absolute_error_limit = GSL_SQRT_DBL_EPSILON;
+	const double relative_error_limit = GSL_SQRT_DBL_EPSILON;
+	const size_t max_count = std::max(intervals, size_t(1));
+
+	ScratchBuffer points(rulePoints);
+	ScratchBuffer values(rulePoints * components);
+	// The bounds of each subinterval, and the integral and error of each component over it
+	ScratchBuffer bounds(2 * max_count);
+	ScratchBuffer subintegrals(max_count * components);
+	ScratchBuffer suberrors(max_count * components);
+	ScratchBuffer deviations(components);
+	ScratchBuffer errors(components);
+	ScratchBuffer limits(components);
+
+	auto apply = [&](double left, double right, size_t interval) {
+		rulePointsOn(left, right, points.data());
+		function.function(points.data(), rulePoints, components, values.data(), function.params);
+		gaussKronrod(components, left, right, values.data(), &subintegrals[interval * components],
+		             &suberrors[interval * components], deviations.data());
+	};
+
+	size_t count = 1;
+	bounds[0] = lower;
+	bounds[1] = upper;
+	apply(lower, upper, 0);
+
+	while (true) {
+		std::fill(results, results + components, 0.0);
+		std::fill(errors.data(), errors.data() + components, 0.0);
+		for (size_t i = 0; i < count; ++i) {
+			for (size_t k = 0; k < components; ++k) {
+				results[k] += subintegrals[i * components + k];
+				errors[k] += suberrors[i * components + k];
+			}
+		}
+
+		bool converged = true;
+		for (size_t k = 0; k < components; ++k) {
+			limits[k] = std::max(absolute_error_limit, relative_error_limit * std::abs(results[k]));
+			converged = converged && errors[k] <= limits[k];
+			// As in gsl_integration_qag, an untrustworthy estimate on the whole range is not accepted
+			if (count == 1 && errors[k] != 0.0 && errors[k] == deviations[k]) {
+				converged = false;
+			}
+		}
+		if (converged) {
+			return;
+		}
+		if (count >= intervals) {
+			throw std::runtime_error(gsl_strerror(GSL_EMAXITER));
+		}
+
+		// Bisect the subinterval whose error is largest relative to the limit of its component
+		size_t worst = 0;
+		double worst_error = -1.0;
+		for (size_t i = 0; i < count; ++i) {
+			for (size_t k = 0; k < components; ++k) {
+				const double error = suberrors[i * components + k] / limits[k];
+				if (error > worst_error) {
+					worst = i;
+					worst_error = error;
+				}
+			}
+		}
+
+		const double left = bounds[2 * worst];
+		const double right = bounds[2 * worst + 1];
+		const double middle = 0.5 * (left + right);
+		bounds[2 * worst + 1] = middle;
+		bounds[2 * count] = middle;
+		bounds[2 * count + 1] = right;
+		apply(left, middle, worst);
+		apply(middle, right, count);
+		++count;
+	}
+}
+
+size_t Integrator::workspaceAllocations() {
+	return workspaceCount.load(std::memory_order_relaxed);
+}
@@ -2,15 +2,74 @@
 #include <string>
 #include <vector>
 #include <gsl/gsl_math.h>
+#include "GSLFunctionWrapper.h"
 
 
 /**
  * Handles the task of integration, using GSL's adaptive quadrature functions.
+ *
+ * Integrals run inside the parallel item selection loops, so nothing is allocated per integral: each thread keeps
+ * the GSL workspaces it has used for its later integrals, and the vector-valued integrals take their buffers from
+ * the thread's ScratchBuffer arena.
  */
 class Integrator {
-  
+
 public:
 	double integrate(const gsl_function *function, const size_t intervals,
 	                 const double lower, const double upper) const;
-  
-};
\ No newline at end of file
+
+	/**
+	 * Integrates any callable taking and returning a double. The callable is called through its own type, so it is
+	 * inlined into the function GSL calls.
+	 */
+	template <class Function>
+	double integrate(const Function &function, const size_t intervals,
+	                 const double lower, const double upper) const {
+		GSLFunctionWrapper<Function> wrapped(function);
+		const gsl_function *gsl = wrapped.asGSLFunction();
+		return integrate(gsl, intervals, lower, upper);
+	}
+
+	/**
+	 * Integrates the components of function together, so that integrands sharing an expensive factor (such as
+	 * the moments of a posterior) evaluate it once per point. function(theta, values) writes the value of every
+	 * component at theta to values. The 61-point Gauss-Kronrod rule, bisection of the subinterval with the largest
+	 * error, and error limits are those integrate uses with GSL, and subintervals are bisected until the error of
+	 * every component is within its limit. results must hold components values.
+	 */
+	template <class VectorFunction>
+	void integrate(const VectorFunction &function, const size_t components, const size_t intervals,
+	               const double lower, const double upper, double *results) const {
+		const PointFunction points = {&evaluatePoints<VectorFunction>, &function};
+		integratePoints(points, components, intervals, lower, upper, results);
+	}
+
+	/**
+	 * The number of GSL workspaces any thread has allocated. Like ScratchBuffer::allocations(), it is a profiling
+	 * aid: once the threads running selectItem have done the integrals it needs, it stays the same across calls.
+	 */
+	static size_t workspaceAllocations();
+
+private:
+	/**
+	 * A vector-valued integrand evaluated at all the points of the rule on a subinterval in one call, so the
+	 * integrand itself is called directly from a loop that is compiled for its type.
+	 */
+	struct PointFunction {
+		void (*function)(const double *points, size_t count, size_t components, double *values, const void *params);
+		const void *params;
+	};
+
+	template <class VectorFunction>
+	static void evaluatePoints(const double *points, size_t count, size_t components, double *values,
+	                           const void *params) {
+		const VectorFunction &function = *static_cast<const VectorFunction *>(params);
+		for (size_t i = 0; i < count; ++i) {
+			function(points[i], values + i * components);
+		}
+	}
+
+	void integratePoints(const PointFunction &function, const size_t components, const size_t intervals,
+	                     const double lower, const double upper, double *results) const;
+
+};
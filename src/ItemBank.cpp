@@ -0,0 +1,80 @@
+#include "ItemBank.h"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include "SelectionCache.h"
+#include "SharedRegistry.h"
+
+
+ItemBank::ItemBank(const std::vector<std::vector<double> > &difficulty, const std::vector<double> &discrimination,
+                   const std::vector<double> &guessing)
+		: discrimination(discrimination.begin(), discrimination.end()),
+		  guessing(guessing.begin(), guessing.end()) {
+	if (difficulty.size() != discrimination.size()) {
+		throw std::domain_error("difficulty and discrimination must have the same number of items.");
+	}
+	if (guessing.size() != discrimination.size()) {
+		throw std::domain_error("guessing and discrimination must have the same number of items.");
+	}
+
+	std::size_t total = 0;
+	offsets.reserve(difficulty.size());
+	threshold_counts.reserve(difficulty.size());
+	for (auto const &item : difficulty) {
+		offsets.push_back(total);
+		threshold_counts.push_back(item.size());
+		total += ((item.size() + blockSize - 1) / blockSize) * blockSize;
+	}
+
+	thresholds.assign(total, 0.0);
+	std::map<std::size_t, std::vector<int> > by_count;
+	for (std::size_t i = 0; i < difficulty.size(); ++i) {
+		std::copy(difficulty[i].begin(), difficulty[i].end(), thresholds.begin() + offsets[i]);
+		by_count[difficulty[i].size()].push_back((int) i);
+	}
+
+	for (auto &count : by_count) {
+		groups.push_back(Group{count.first, count.second});
+	}
+}
+
+bool ItemBank::operator==(const ItemBank &other) const {
+	// groups follow from threshold_counts
+	return discrimination == other.discrimination && guessing == other.guessing && thresholds == other.thresholds &&
+	       offsets == other.offsets && threshold_counts == other.threshold_counts && names == other.names &&
+	       model_type == other.model_type && lowerBound == other.lowerBound && upperBound == other.upperBound &&
+	       z == other.z;
+}
+
+std::uint64_t ItemBank::fingerprint() const {
+	SelectionCache::Fingerprint fingerprint;
+	fingerprint.add(discrimination);
+	fingerprint.add(guessing);
+	fingerprint.add(thresholds);
+	fingerprint.add(offsets);
+	fingerprint.add(threshold_counts);
+	fingerprint.add(names.size());
+	for (const std::string &name : names) {
+		fingerprint.add(name);
+	}
+	fingerprint.add(int(model_type));
+	fingerprint.add(lowerBound);
+	fingerprint.add(upperBound);
+	fingerprint.add(z);
+	return fingerprint.value();
+}
+
+std::shared_ptr<const ItemBank> ItemBank::intern(ItemBank &&bank) {
+	static SharedRegistry<std::uint64_t, const ItemBank> registry;
+
+	std::shared_ptr<const ItemBank> built;
+	std::shared_ptr<const ItemBank> shared = registry.get(bank.fingerprint(), [&]() {
+		built = std::make_shared<const ItemBank>(std::move(bank));
+		return built;
+	});
+	if (shared == built || *shared == bank) {
+		return shared;
+	}
+	// A different bank whose fingerprint collides with a registered one is not shared
+	return std::make_shared<const ItemBank>(std::move(bank));
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <vector>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+
+
+/**
+ * Minimal allocator returning memory aligned to Alignment bytes, so parameter arrays start on a cache line
+ * and can be loaded with aligned vector instructions.
+ */
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator {
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+	AlignedAllocator() {}
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(std::size_t n) {
+		// Over-allocate and keep the original pointer just before the aligned block
+		void* raw = std::malloc(n * sizeof(T) + Alignment + sizeof(void*));
+		if (raw == nullptr) {
+			throw std::bad_alloc();
+		}
+		std::size_t address = reinterpret_cast<std::size_t>(raw) + sizeof(void*);
+		address = (address + Alignment - 1) & ~(Alignment - 1);
+		reinterpret_cast<void**>(address)[-1] = raw;
+		return reinterpret_cast<T*>(address);
+	}
+
+	void deallocate(T* p, std::size_t) {
+		if (p != nullptr) {
+			std::free(reinterpret_cast<void**>(p)[-1]);
+		}
+	}
+};
+
+template <typename T, typename U, std::size_t A>
+bool operator==(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&) { return true; }
+template <typename T, typename U, std::size_t A>
+bool operator!=(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&) { return false; }
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T> >;
+
+
+/**
+ * The item response model of a Cat, resolved from the model slot once when the ItemBank is built.
+ */
+enum class ModelType {
+	LTM, TPM, GRM, GPCM
+};
+
+inline bool isBinary(ModelType type) {
+	return (type == ModelType::LTM) || (type == ModelType::TPM);
+}
+
+
+/**
+ * Item parameters in structure-of-arrays form. Every item's difficulty parameters (a single intercept for
+ * ltm/tpm, the thresholds for grm, the category parameters for gpcm) are stored in one contiguous array,
+ * each item's block starting at offsets[item] and padded to a multiple of blockSize doubles with zeros.
+ * The per-item discrimination and guessing parameters are aligned arrays indexed by item.
+ *
+ * Along with the parameters, the bank holds everything else about a Cat's items that does not change as answers
+ * are stored: their names, the model, the integration bounds and z. A bank is never modified once it is built and
+ * is shared, through a std::shared_ptr<const ItemBank>, by the QuestionSet of every copy of a Cat and by the Cats
+ * built from identical items (see intern), so any number of sessions and worker threads read the same parameters.
+ *
+ * Accessors do no bounds checking; indices come from QuestionSet, which only holds valid items.
+ */
+struct ItemBank {
+
+	static const std::size_t blockSize = 4;
+
+	AlignedVector<double> discrimination;
+	AlignedVector<double> guessing;
+	AlignedVector<double> thresholds;
+
+	std::vector<std::size_t> offsets;
+	std::vector<std::size_t> threshold_counts;
+
+	/**
+	 * Items sharing a number of thresholds, in increasing item order, so that kernels over many items can
+	 * run with a fixed inner trip count.
+	 */
+	struct Group {
+		std::size_t threshold_count;
+		std::vector<int> items;
+	};
+	std::vector<Group> groups;
+
+	std::vector<std::string> names;
+	ModelType model_type;
+
+	/**
+	 * Bounds for integration.
+	 */
+	double lowerBound;
+	double upperBound;
+
+	std::vector<double> z;
+
+	ItemBank() {}
+
+	ItemBank(const std::vector<std::vector<double> > &difficulty, const std::vector<double> &discrimination,
+	         const std::vector<double> &guessing);
+
+	std::size_t size() const {
+		return offsets.size();
+	}
+
+	const double* item_thresholds(std::size_t item) const {
+		return thresholds.data() + offsets[item];
+	}
+
+	std::size_t threshold_count(std::size_t item) const {
+		return threshold_counts[item];
+	}
+
+	bool operator==(const ItemBank &other) const;
+
+	/**
+	 * A hash of everything operator== compares.
+	 */
+	std::uint64_t fingerprint() const;
+
+	/**
+	 * A shared bank equal to bank: one already held by another Cat if there is one, otherwise bank itself. Banks
+	 * are registered by fingerprint, and operator== only confirms a match.
+	 */
+	static std::shared_ptr<const ItemBank> intern(ItemBank &&bank);
+};
@@ -0,0 +1,1088 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "ItemBank.h"
+#include "Scratch.h"
+#include "VectorMath.h"
+
+
+/**
+ * Per-model kernels over an ItemBank. Each model is a struct of static functions with the same names, so code
+ * written as a template on the model (see Estimator) is instantiated once per model and the compiler can inline
+ * the response functions into likelihood, derivative, and integrand loops instead of branching on the model
+ * for every item and every evaluation.
+ *
+ * logResponse, d1, and d2 are one item's contribution to the log-likelihood and its first and second
+ * derivatives given an answer; terms computes all three from one evaluation of the item's probabilities (the
+ * logarithm only if with_log), with the same arithmetic as the separate functions. fisherInf is the item's
+ * expected information and kl the item's Kullback-Leibler divergence between two abilities. infoBound is an
+ * upper bound on fisherInf over an interval of abilities, up to rounding.
+ *
+ * Probabilities are clamped to [eps, 1 - eps] for ltm, tpm, and grm, and an exception is thrown when theta is
+ * too extreme for them to be told apart.
+ *
+ * klReference writes the klReferenceCount log-probabilities of an item's categories at the second ability of kl,
+ * so that integrals of the divergence over the first ability compute them once; kl also accepts them in place
+ * of that ability.
+ *
+ * Functions that produce a value per response category write them to a caller's buffer of probabilityCount
+ * doubles; the std::vector overloads of probabilities are for callers outside any integrand, such as the R
+ * interface. Working space per category comes from ScratchBuffer, so no kernel allocates once a thread is warm.
+ *
+ * The batch functions evaluate a block of items at one theta (fisherInf, logLikelihood) or one item at a block of
+ * thetas (logResponses). They take exponentials and logarithms over whole arrays with vexp and vlog, which use
+ * AVX2 or AVX-512 when the package is compiled for them and std::exp and std::log otherwise; the arithmetic
+ * around them is the same as in the single-item functions.
+ */
+static const double modelEpsilon = std::pow(std::pow(2.0, -52.0), 1.0/3.0);
+
+/**
+ * Number of doubles of scratch space the batch functions keep on the stack; longer blocks are done in pieces.
+ */
+static const size_t modelBatchSize = 256;
+
+/**
+ * One item's (or a set of items') log-likelihood and its first and second derivatives with respect to theta,
+ * as computed together by each model's terms function.
+ */
+struct LikelihoodTerms {
+	double logL;
+	double d1;
+	double d2;
+};
+
+
+/**
+ * Binary items (ltm and tpm). The guessing parameter is always applied: it is zero for ltm Cat objects unless
+ * it was set explicitly, and then it has always been used.
+ */
+struct BinaryModel {
+
+	static double probFromExp(double exp_prob_bi, double guess) {
+		if (std::isinf(exp_prob_bi)) {
+			return 1.0 - modelEpsilon;
+		}
+
+		double result = guess + (1 - guess) * (exp_prob_bi / (1 + exp_prob_bi));
+
+		if (result > (1.0 - modelEpsilon)) {
+			result = 1.0 - modelEpsilon;
+		}
+		else if (result < modelEpsilon) {
+			result = modelEpsilon;
+		}
+		return result;
+	}
+
+	static double prob(const ItemBank &bank, size_t item, double theta) {
+		double difficulty = bank.item_thresholds(item)[0];
+		return probFromExp(exp(difficulty + (bank.discrimination[item] * theta)), bank.guessing[item]);
+	}
+
+	static void prob(const ItemBank &bank, const int *items, size_t n, double theta, double *out) {
+		for (size_t i = 0; i < n; ++i) {
+			out[i] = bank.item_thresholds(items[i])[0] + (bank.discrimination[items[i]] * theta);
+		}
+		vexp(out, out, n);
+		for (size_t i = 0; i < n; ++i) {
+			out[i] = probFromExp(out[i], bank.guessing[items[i]]);
+		}
+	}
+
+	static double logResponse(const ItemBank &bank, size_t item, int answer, double theta) {
+		double P = prob(bank, item, theta);
+		return (answer * log(P)) + ((1 - answer) * log(1 - P));
+	}
+
+	static double logLikelihood(const ItemBank &bank, const int *items, size_t n, const int *answers, double theta) {
+		double P[modelBatchSize];
+		double Q[modelBatchSize];
+		double L = 0.0;
+		for (size_t start = 0; start < n; start += modelBatchSize) {
+			const size_t m = std::min(modelBatchSize, n - start);
+			prob(bank, items + start, m, theta, P);
+			for (size_t j = 0; j < m; ++j) {
+				Q[j] = 1 - P[j];
+			}
+			vlog(P, P, m);
+			vlog(Q, Q, m);
+			for (size_t j = 0; j < m; ++j) {
+				int answer = answers[items[start + j]];
+				L += (answer * P[j]) + ((1 - answer) * Q[j]);
+			}
+		}
+		return L;
+	}
+
+	static void logResponses(const ItemBank &bank, size_t item, int answer, const double *thetas, size_t n,
+	                         double *out) {
+		const double difficulty = bank.item_thresholds(item)[0];
+		const double discrimination = bank.discrimination[item];
+		const double guess = bank.guessing[item];
+
+		double Q[modelBatchSize];
+		for (size_t start = 0; start < n; start += modelBatchSize) {
+			const size_t m = std::min(modelBatchSize, n - start);
+			double *P = out + start;
+			for (size_t j = 0; j < m; ++j) {
+				P[j] = difficulty + (discrimination * thetas[start + j]);
+			}
+			vexp(P, P, m);
+			for (size_t j = 0; j < m; ++j) {
+				P[j] = probFromExp(P[j], guess);
+				Q[j] = 1 - P[j];
+			}
+			vlog(P, P, m);
+			vlog(Q, Q, m);
+			for (size_t j = 0; j < m; ++j) {
+				P[j] = (answer * P[j]) + ((1 - answer) * Q[j]);
+			}
+		}
+	}
+
+	static double d1(const ItemBank &bank, size_t item, int answer, double theta) {
+		double P = prob(bank, item, theta);
+		double guess = bank.guessing[item];
+		double discrimination = bank.discrimination[item];
+		return discrimination * ((P - guess) / (P * (1 - guess))) * (answer - P);
+	}
+
+	static double d2(const ItemBank &bank, size_t item, int, double theta) {
+		return -fisherInf(bank, item, theta);
+	}
+
+	static void terms(const ItemBank &bank, size_t item, int answer, double theta, bool with_log,
+	                  LikelihoodTerms &out) {
+		double P = prob(bank, item, theta);
+		double guess = bank.guessing[item];
+		double discrimination = bank.discrimination[item];
+		out.logL = with_log ? (answer * log(P)) + ((1 - answer) * log(1 - P)) : NAN;
+		out.d1 = discrimination * ((P - guess) / (P * (1 - guess))) * (answer - P);
+		out.d2 = -infoFromProb(bank, item, P);
+	}
+
+	static double infoFromProb(const ItemBank &bank, size_t item, double P) {
+		double discrimination = bank.discrimination[item];
+		double guess = bank.guessing[item];
+		double Q = 1 - P;
+		double temp = std::pow((P - guess) / (1.0 - guess), 2.0);
+		return discrimination*discrimination * temp * (Q / P);
+	}
+
+	static double fisherInf(const ItemBank &bank, size_t item, double theta) {
+		return infoFromProb(bank, item, prob(bank, item, theta));
+	}
+
+	static void fisherInf(const ItemBank &bank, const int *items, size_t n, double theta, double *out) {
+		prob(bank, items, n, theta, out);
+		for (size_t i = 0; i < n; ++i) {
+			out[i] = infoFromProb(bank, items[i], out[i]);
+		}
+	}
+
+	/**
+	 * An upper bound on fisherInf over [lower, upper]. The information of a binary item is unimodal in theta and
+	 * peaks where the exponent is log((1 + sqrt(1 + 8 * guess)) / 2), so the bound is the peak when it lies in the
+	 * interval and the larger of the endpoints otherwise.
+	 */
+	static double infoBound(const ItemBank &bank, size_t item, double lower, double upper) {
+		double bound = std::max(fisherInf(bank, item, lower), fisherInf(bank, item, upper));
+		const double discrimination = bank.discrimination[item];
+		if (discrimination != 0.0) {
+			const double exponent = std::log((1.0 + std::sqrt(1.0 + 8.0 * bank.guessing[item])) / 2.0);
+			const double peak = (exponent - bank.item_thresholds(item)[0]) / discrimination;
+			if (peak > lower && peak < upper) {
+				bound = std::max(bound, fisherInf(bank, item, peak));
+			}
+		}
+		return bound;
+	}
+
+	static double kl(const ItemBank &bank, size_t item, double theta_not, double theta) {
+		double log_reference[2];
+		klReference(bank, item, theta, log_reference);
+		return kl(bank, item, theta_not, log_reference);
+	}
+
+	static size_t klReferenceCount(const ItemBank &, size_t) {
+		return 2;
+	}
+
+	static void klReference(const ItemBank &bank, size_t item, double theta, double *log_reference) {
+		double prob_theta_hat = prob(bank, item, theta);
+		log_reference[0] = log(prob_theta_hat);
+		log_reference[1] = log(1 - prob_theta_hat);
+	}
+
+	static double kl(const ItemBank &bank, size_t item, double theta_not, const double *log_reference) {
+		double prob_theta_not = prob(bank, item, theta_not);
+
+		double first_term = prob_theta_not * (log(prob_theta_not) - log_reference[0]);
+		double second_term = (1 - prob_theta_not) * (log(1 - prob_theta_not) - log_reference[1]);
+		return first_term + second_term;
+	}
+};
+
+
+/**
+ * Graded response model. Cumulative probabilities are P*(0) = 0, P*(k) for each threshold, and P*(K+1) = 1;
+ * the probability of answer k is P*(k) - P*(k-1).
+ */
+struct GRMModel {
+
+	static double cumulativeFromExp(double exp_prob) {
+		if (std::isinf(exp_prob)) {
+			return 1.0 - modelEpsilon;
+		}
+
+		double result = exp_prob / (1 + exp_prob);
+
+		if (result > (1.0 - modelEpsilon)) {
+			result = 1.0 - modelEpsilon;
+		}
+		else if (result < modelEpsilon) {
+			result = modelEpsilon;
+		}
+		return result;
+	}
+
+	static double cumulative(double theta_desc, double difficulty) {
+		return cumulativeFromExp(exp(difficulty - theta_desc));
+	}
+
+	/**
+	 * Number of values probabilities writes for item: the threshold_count interior cumulative probabilities
+	 * and the fixed 0 and 1 around them.
+	 */
+	static size_t probabilityCount(const ItemBank &bank, size_t item) {
+		return bank.threshold_count(item) + 2;
+	}
+
+	static void probabilities(const ItemBank &bank, size_t item, double theta, double *out) {
+		const double theta_desc = theta * bank.discrimination[item];
+		const double* thresholds = bank.item_thresholds(item);
+		const size_t threshold_count = bank.threshold_count(item);
+
+		out[0] = 0.0;
+		for (size_t i = 0; i < threshold_count; ++i) {
+			out[i + 1] = cumulative(theta_desc, thresholds[i]);
+		}
+		out[threshold_count + 1] = 1.0;
+
+		// checking for repeated elements
+		if (std::adjacent_find(out, out + threshold_count + 2) != out + threshold_count + 2) {
+			throw std::domain_error("Theta value too extreme for numerical routines.");
+		}
+	}
+
+	static std::vector<double> probabilities(const ItemBank &bank, size_t item, double theta) {
+		std::vector<double> probs(probabilityCount(bank, item));
+		probabilities(bank, item, theta, probs.data());
+		return probs;
+	}
+
+	/**
+	 * Cumulative probabilities at answer-1 and answer.
+	 */
+	static std::pair<double, double> probPair(const ItemBank &bank, size_t item, size_t answer, double theta) {
+		const double theta_desc = theta * bank.discrimination[item];
+		const double* difficulties = bank.item_thresholds(item);
+		const size_t threshold_count = bank.threshold_count(item);
+
+		std::pair<double, double> probs;
+		probs.first = (answer == 1) ? 0.0 : cumulative(theta_desc, difficulties[answer-2]);
+		probs.second = (answer == threshold_count+1) ? 1.0 : cumulative(theta_desc, difficulties[answer-1]);
+
+		if (probs.first == probs.second) {
+			throw std::domain_error("Theta value too extreme for numerical routines.");
+		}
+		return probs;
+	}
+
+	static double logResponse(const ItemBank &bank, size_t item, int answer, double theta) {
+		auto probs = probPair(bank, item, answer, theta);
+		return log(probs.second - probs.first);
+	}
+
+	/**
+	 * The arguments of exp for the cumulative probabilities at answer-1 and answer (0 where that probability is
+	 * the fixed 0 or 1), and the response probability from their exponentials.
+	 */
+	static void pairExponents(const ItemBank &bank, size_t item, size_t answer, double theta_desc, double &lower,
+	                          double &upper) {
+		const double* difficulties = bank.item_thresholds(item);
+		lower = (answer == 1) ? 0.0 : difficulties[answer-2] - theta_desc;
+		upper = (answer == bank.threshold_count(item)+1) ? 0.0 : difficulties[answer-1] - theta_desc;
+	}
+
+	static double pairFromExp(const ItemBank &bank, size_t item, size_t answer, double lower, double upper) {
+		const double first = (answer == 1) ? 0.0 : cumulativeFromExp(lower);
+		const double second = (answer == bank.threshold_count(item)+1) ? 1.0 : cumulativeFromExp(upper);
+		if (first == second) {
+			throw std::domain_error("Theta value too extreme for numerical routines.");
+		}
+		return second - first;
+	}
+
+	static double logLikelihood(const ItemBank &bank, const int *items, size_t n, const int *answers, double theta) {
+		double lower[modelBatchSize];
+		double upper[modelBatchSize];
+		double L = 0.0;
+		for (size_t start = 0; start < n; start += modelBatchSize) {
+			const size_t m = std::min(modelBatchSize, n - start);
+			for (size_t j = 0; j < m; ++j) {
+				const int item = items[start + j];
+				pairExponents(bank, item, answers[item], theta * bank.discrimination[item], lower[j], upper[j]);
+			}
+			vexp(lower, lower, m);
+			vexp(upper, upper, m);
+			for (size_t j = 0; j < m; ++j) {
+				const int item = items[start + j];
+				lower[j] = pairFromExp(bank, item, answers[item], lower[j], upper[j]);
+			}
+			vlog(lower, lower, m);
+			for (size_t j = 0; j < m; ++j) {
+				L += lower[j];
+			}
+		}
+		return L;
+	}
+
+	static void logResponses(const ItemBank &bank, size_t item, int answer, const double *thetas, size_t n,
+	                         double *out) {
+		const double discrimination = bank.discrimination[item];
+
+		double upper[modelBatchSize];
+		for (size_t start = 0; start < n; start += modelBatchSize) {
+			const size_t m = std::min(modelBatchSize, n - start);
+			double *lower = out + start;
+			for (size_t j = 0; j < m; ++j) {
+				pairExponents(bank, item, answer, thetas[start + j] * discrimination, lower[j], upper[j]);
+			}
+			vexp(lower, lower, m);
+			vexp(upper, upper, m);
+			for (size_t j = 0; j < m; ++j) {
+				lower[j] = pairFromExp(bank, item, answer, lower[j], upper[j]);
+			}
+			vlog(lower, lower, m);
+		}
+	}
+
+	static double d1(const ItemBank &bank, size_t item, int answer, double theta) {
+		double P_star2, P_star1;
+		std::tie(P_star2, P_star1) = probPair(bank, item, answer, theta);
+		double P = P_star1 - P_star2;
+		double w = P_star1 * (1.0 - P_star1) - P_star2 * (1 - P_star2);
+		return -1*bank.discrimination[item] * (w / P);
+	}
+
+	/**
+	 * Second derivative of the log of the response probability with respect to discrimination * theta.
+	 */
+	static double partialD2(const ItemBank &bank, size_t item, int answer, double theta) {
+		double P_star1;
+		double P_star2;
+		std::tie(P_star2, P_star1) = probPair(bank, item, answer, theta);
+		return partialD2(P_star2, P_star1);
+	}
+
+	static double partialD2(double P_star2, double P_star1) {
+		double P = P_star1 - P_star2;
+		double Q_star1 = 1 - P_star1;
+		double Q_star2 = 1 - P_star2;
+
+		double w2 = P_star2 * Q_star2;
+		double w1 = P_star1 * Q_star1;
+		double w = w1 - w2;
+
+		double first_term = (-w2 * (Q_star2 - P_star2) + w1 * (Q_star1 - P_star1)) / P;
+		double second_term = std::pow(w, 2.0) / std::pow(P, 2.0);
+		return first_term - second_term;
+	}
+
+	static double d2(const ItemBank &bank, size_t item, int answer, double theta) {
+		return std::pow(bank.discrimination[item], 2.0) * partialD2(bank, item, answer, theta);
+	}
+
+	static void terms(const ItemBank &bank, size_t item, int answer, double theta, bool with_log,
+	                  LikelihoodTerms &out) {
+		double P_star2, P_star1;
+		std::tie(P_star2, P_star1) = probPair(bank, item, answer, theta);
+		double P = P_star1 - P_star2;
+		double w = P_star1 * (1.0 - P_star1) - P_star2 * (1 - P_star2);
+		out.logL = with_log ? log(P) : NAN;
+		out.d1 = -1*bank.discrimination[item] * (w / P);
+		out.d2 = std::pow(bank.discrimination[item], 2.0) * partialD2(P_star2, P_star1);
+	}
+
+	/**
+	 * Information from the threshold_count interior cumulative probabilities of an item.
+	 */
+	static double infoFromCumulative(double discrimination, const double *cumulatives, size_t threshold_count) {
+		double discrimination_squared = std::pow(discrimination, 2.0);
+
+		double output = 0.0;
+		double P_star2 = 0.0;
+		for (size_t i = 0; i <= threshold_count; ++i) {
+			double P_star1 = (i == threshold_count) ? 1.0 : cumulatives[i];
+			if (P_star1 == P_star2) {
+				throw std::domain_error("Theta value too extreme for numerical routines.");
+			}
+			double w1 = P_star1 * (1.0 - P_star1);
+			double w2 = P_star2 * (1.0 - P_star2);
+			output += discrimination_squared * (std::pow(w1 - w2, 2.0) / (P_star1 - P_star2));
+			P_star2 = P_star1;
+		}
+		return output;
+	}
+
+	static double fisherInf(const ItemBank &bank, size_t item, double theta) {
+		const double theta_desc = theta * bank.discrimination[item];
+		const double* thresholds = bank.item_thresholds(item);
+		const size_t threshold_count = bank.threshold_count(item);
+
+		ScratchBuffer cumulatives(threshold_count);
+		for (size_t i = 0; i < threshold_count; ++i) {
+			cumulatives[i] = cumulative(theta_desc, thresholds[i]);
+		}
+		return infoFromCumulative(bank.discrimination[item], cumulatives.data(), threshold_count);
+	}
+
+	static void fisherInf(const ItemBank &bank, const int *items, size_t n, double theta, double *out) {
+		double buffer[modelBatchSize];
+		size_t start = 0;
+		while (start < n) {
+			// As many whole items as fit in the buffer
+			size_t end = start;
+			size_t used = 0;
+			while (end < n && used + bank.threshold_count(items[end]) <= modelBatchSize) {
+				const int item = items[end];
+				const double theta_desc = theta * bank.discrimination[item];
+				const double* thresholds = bank.item_thresholds(item);
+				for (size_t k = 0; k < bank.threshold_count(item); ++k) {
+					buffer[used + k] = thresholds[k] - theta_desc;
+				}
+				used += bank.threshold_count(item);
+				++end;
+			}
+			if (end == start) {
+				out[start] = fisherInf(bank, items[start], theta);
+				++start;
+				continue;
+			}
+
+			vexp(buffer, buffer, used);
+			used = 0;
+			for (size_t i = start; i < end; ++i) {
+				const size_t threshold_count = bank.threshold_count(items[i]);
+				for (size_t k = 0; k < threshold_count; ++k) {
+					buffer[used + k] = cumulativeFromExp(buffer[used + k]);
+				}
+				out[i] = infoFromCumulative(bank.discrimination[items[i]], buffer + used, threshold_count);
+				used += threshold_count;
+			}
+			start = end;
+		}
+	}
+
+	/**
+	 * An upper bound on fisherInf over [lower, upper]. Each term of infoFromCumulative equals
+	 * (P_star1 - P_star2) * (1 - P_star1 - P_star2)^2, and every cumulative probability is monotone in theta, so
+	 * each factor is bounded by the values of the cumulative probabilities at the ends of the interval.
+	 */
+	static double infoBound(const ItemBank &bank, size_t item, double lower, double upper) {
+		const double discrimination = bank.discrimination[item];
+		const double* thresholds = bank.item_thresholds(item);
+		const size_t threshold_count = bank.threshold_count(item);
+
+		double output = 0.0;
+		double low2 = 0.0;
+		double high2 = 0.0;
+		for (size_t i = 0; i <= threshold_count; ++i) {
+			double low1 = 1.0;
+			double high1 = 1.0;
+			if (i < threshold_count) {
+				const double at_lower = cumulative(lower * discrimination, thresholds[i]);
+				const double at_upper = cumulative(upper * discrimination, thresholds[i]);
+				low1 = std::min(at_lower, at_upper);
+				high1 = std::max(at_lower, at_upper);
+			}
+			const double difference = std::max(high1 - low2, high2 - low1);
+			const double center = std::max(std::abs(1.0 - low1 - low2), std::abs(1.0 - high1 - high2));
+			output += difference * center * center;
+			low2 = low1;
+			high2 = high1;
+		}
+		return std::pow(discrimination, 2.0) * output;
+	}
+
+	static double kl(const ItemBank &bank, size_t item, double theta_not, double theta) {
+		ScratchBuffer log_reference(klReferenceCount(bank, item));
+		klReference(bank, item, theta, log_reference.data());
+		return kl(bank, item, theta_not, log_reference.data());
+	}
+
+	static size_t klReferenceCount(const ItemBank &bank, size_t item) {
+		return probabilityCount(bank, item) - 1;
+	}
+
+	static void klReference(const ItemBank &bank, size_t item, double theta, double *log_reference) {
+		const size_t count = probabilityCount(bank, item);
+		ScratchBuffer cdf_theta_hat(count);
+		probabilities(bank, item, theta, cdf_theta_hat.data());
+		for (size_t i = 1; i < count; ++i) {
+			log_reference[i-1] = log(cdf_theta_hat[i] - cdf_theta_hat[i-1]);
+		}
+	}
+
+	static double kl(const ItemBank &bank, size_t item, double theta_not, const double *log_reference) {
+		const size_t count = probabilityCount(bank, item);
+		ScratchBuffer cdf_theta_not(count);
+		probabilities(bank, item, theta_not, cdf_theta_not.data());
+
+		double sum = 0.0;
+		for (size_t i = 1; i < count; ++i) {
+			double prob_theta_not = cdf_theta_not[i] - cdf_theta_not[i-1];
+			sum += prob_theta_not * (log(prob_theta_not) - log_reference[i-1]);
+		}
+		return sum;
+	}
+};
+
+
+/**
+ * Generalized partial credit model. Category k (0-based) has numerator exp(sum_{c<=k} a(theta - b_c)) with
+ * b_0 = 0, and the probabilities are the numerators over their sum.
+ */
+struct GPCMModel {
+
+	/**
+	 * Number of response categories of item, the number of values probabilities and derivatives write.
+	 */
+	static size_t probabilityCount(const ItemBank &bank, size_t item) {
+		return bank.threshold_count(item) + 1;
+	}
+
+	static void probabilities(const ItemBank &bank, size_t item, double theta, double *out) {
+		double discrimination = bank.discrimination[item];
+		const double* categoryparams = bank.item_thresholds(item);
+		const size_t category_count = bank.threshold_count(item);
+
+		double sum = discrimination * theta;
+		double denominator = exp(sum);
+		out[0] = denominator;
+
+		for (size_t c = 0; c < category_count; ++c) {
+			sum += discrimination * (theta - categoryparams[c]);
+			double num = exp(sum);
+			denominator += num;
+			out[c + 1] = num;
+		}
+
+		if (denominator == 0.0 or std::isinf(denominator)) {
+			throw std::domain_error("Theta value too extreme for numerical routines.");
+		}
+
+		for (size_t c = 0; c <= category_count; ++c) {
+			out[c] /= denominator;
+		}
+	}
+
+	static std::vector<double> probabilities(const ItemBank &bank, size_t item, double theta) {
+		std::vector<double> probs(probabilityCount(bank, item));
+		probabilities(bank, item, theta, probs.data());
+		return probs;
+	}
+
+	/**
+	 * Probability of the 0-based category at.
+	 */
+	static double probAt(const ItemBank &bank, size_t item, size_t at, double theta) {
+		double discrimination = bank.discrimination[item];
+		const double* categoryparams = bank.item_thresholds(item);
+		const size_t category_count = bank.threshold_count(item);
+
+		double sum = discrimination * theta;
+		double denominator = exp(sum);
+
+		double result = -1;
+		if (at == 0) {
+			result = denominator;
+			for (size_t c = 0; c < category_count; ++c) {
+				sum += discrimination * (theta - categoryparams[c]);
+				denominator += exp(sum);
+			}
+		}
+		else {
+			at -= 1;
+			for (size_t i = 0; i != at; ++i) {
+				sum += discrimination * (theta - categoryparams[i]);
+				denominator += exp(sum);
+			}
+
+			sum += discrimination * (theta - categoryparams[at]);
+			result = exp(sum);
+			denominator += result;
+
+			for (size_t i = at+1; i < category_count; ++i) {
+				sum += discrimination * (theta - categoryparams[i]);
+				denominator += exp(sum);
+			}
+		}
+
+		if (denominator == 0.0 or std::isinf(denominator)) {
+			throw std::domain_error("Theta value too extreme for numerical routines.");
+		}
+		return result/denominator;
+	}
+
+	/**
+	 * Probabilities and their first and second derivatives with respect to theta for every category.
+	 */
+	static void derivatives(const ItemBank &bank, size_t item, double theta, double *probs, double *first,
+	                        double *second) {
+		double discrimination = bank.discrimination[item];
+		const double* categoryparams = bank.item_thresholds(item);
+		const size_t category_count = bank.threshold_count(item);
+
+		double sum = discrimination * theta;
+		double x = discrimination;
+		double g = exp(sum);
+		double g_prime = g*x;
+		double g_primeprime = g_prime*x;
+
+		probs[0] = g;
+		first[0] = g_prime;
+		second[0] = g_primeprime;
+
+		for (size_t c = 0; c < category_count; ++c) {
+			sum += discrimination * (theta - categoryparams[c]);
+			double num = exp(sum);
+			x += discrimination;
+			double num_x = num*x;
+			double num_xx = num_x*x;
+
+			g += num;
+			g_prime += num_x;
+			g_primeprime += num_xx;
+
+			probs[c + 1] = num;
+			first[c + 1] = num_x;
+			second[c + 1] = num_xx;
+		}
+
+		double b = g*g;
+		double b2 = b*b;
+		double b_prime = 2.0 * g * g_prime;
+
+		for (size_t i = 0; i <= category_count; ++i) {
+			double a = g * first[i] - probs[i] * g_prime;
+			first[i] = a / b;
+
+			double a_prime = second[i] * g - g_primeprime * probs[i];
+			second[i] = (b * a_prime - a * b_prime) / b2;
+
+			probs[i] /= g;
+		}
+	}
+
+	static double logResponse(const ItemBank &bank, size_t item, int answer, double theta) {
+		return log(probAt(bank, item, ((size_t) answer) - 1, theta));
+	}
+
+	/**
+	 * Writes the arguments of exp for the numerator of every category (threshold_count + 1 values) to out.
+	 */
+	static void exponents(const ItemBank &bank, size_t item, double theta, double *out) {
+		double discrimination = bank.discrimination[item];
+		const double* categoryparams = bank.item_thresholds(item);
+		const size_t category_count = bank.threshold_count(item);
+
+		double sum = discrimination * theta;
+		out[0] = sum;
+		for (size_t c = 0; c < category_count; ++c) {
+			sum += discrimination * (theta - categoryparams[c]);
+			out[c + 1] = sum;
+		}
+	}
+
+	/**
+	 * Probability of the 0-based category at from the exponentiated numerators.
+	 */
+	static double probFromExp(const double *numerators, size_t count, size_t at) {
+		double denominator = 0.0;
+		for (size_t c = 0; c < count; ++c) {
+			denominator += numerators[c];
+		}
+		if (denominator == 0.0 or std::isinf(denominator)) {
+			throw std::domain_error("Theta value too extreme for numerical routines.");
+		}
+		return numerators[at]/denominator;
+	}
+
+	static double logLikelihood(const ItemBank &bank, const int *items, size_t n, const int *answers, double theta) {
+		double buffer[modelBatchSize];
+		double probs[modelBatchSize];
+		double L = 0.0;
+		size_t start = 0;
+		while (start < n) {
+			size_t end = start;
+			size_t used = 0;
+			while (end < n && used + bank.threshold_count(items[end]) + 1 <= modelBatchSize) {
+				exponents(bank, items[end], theta, buffer + used);
+				used += bank.threshold_count(items[end]) + 1;
+				++end;
+			}
+			if (end == start) {
+				L += logResponse(bank, items[start], answers[items[start]], theta);
+				++start;
+				continue;
+			}
+
+			vexp(buffer, buffer, used);
+			used = 0;
+			for (size_t i = start; i < end; ++i) {
+				const size_t count = bank.threshold_count(items[i]) + 1;
+				probs[i - start] = probFromExp(buffer + used, count, ((size_t) answers[items[i]]) - 1);
+				used += count;
+			}
+			vlog(probs, probs, end - start);
+			for (size_t i = start; i < end; ++i) {
+				L += probs[i - start];
+			}
+			start = end;
+		}
+		return L;
+	}
+
+	static void logResponses(const ItemBank &bank, size_t item, int answer, const double *thetas, size_t n,
+	                         double *out) {
+		const size_t count = bank.threshold_count(item) + 1;
+		if (count > modelBatchSize) {
+			for (size_t i = 0; i < n; ++i) {
+				out[i] = logResponse(bank, item, answer, thetas[i]);
+			}
+			return;
+		}
+
+		double buffer[modelBatchSize];
+		const size_t per_chunk = modelBatchSize / count;
+		for (size_t start = 0; start < n; start += per_chunk) {
+			const size_t m = std::min(per_chunk, n - start);
+			for (size_t j = 0; j < m; ++j) {
+				exponents(bank, item, thetas[start + j], buffer + j * count);
+			}
+			vexp(buffer, buffer, m * count);
+			for (size_t j = 0; j < m; ++j) {
+				out[start + j] = probFromExp(buffer + j * count, count, ((size_t) answer) - 1);
+			}
+			vlog(out + start, out + start, m);
+		}
+	}
+
+	static double d1(const ItemBank &bank, size_t item, int answer, double theta) {
+		size_t index = ((size_t) answer) - 1;
+
+		double discrimination = bank.discrimination[item];
+		const double* categoryparams = bank.item_thresholds(item);
+		const size_t category_count = bank.threshold_count(item);
+
+		double f = -1;
+		double f_prime = -1;
+		double sum = discrimination * (theta - 0.0);
+		double g = exp(sum);
+		double x = discrimination;
+		double g_prime = g*x;
+
+		if (index == 0) {
+			f = g;
+			f_prime = g_prime;
+
+			for (size_t c = 0; c < category_count; ++c) {
+				sum += discrimination * (theta - categoryparams[c]);
+				double num = exp(sum);
+				x += discrimination;
+				g += num;
+				g_prime += num*x;
+			}
+		}
+		else {
+			index -= 1;
+			for (size_t i = 0; i != index; ++i) {
+				sum += discrimination * (theta - categoryparams[i]);
+				double num = exp(sum);
+				x += discrimination;
+				g += num;
+				g_prime += num*x;
+			}
+
+			sum += discrimination * (theta - categoryparams[index]);
+			f = exp(sum);
+			x += discrimination;
+			f_prime = f*x;
+			g += f;
+			g_prime += f_prime;
+
+			for (size_t i = index+1; i < category_count; ++i) {
+				sum += discrimination * (theta - categoryparams[i]);
+				double num = exp(sum);
+				x += discrimination;
+				g += num;
+				g_prime += num*x;
+			}
+		}
+
+		if (g == 0.0 or std::isinf(g)) {
+			throw std::domain_error("Theta value too extreme for numerical routines.");
+		}
+		return (g*f_prime - f*g_prime)/(g*f);
+	}
+
+	/**
+	 * The numerator of the answered category (f) and the sum of all numerators (g), with their first and second
+	 * derivatives with respect to theta.
+	 */
+	static void answerNumerators(const ItemBank &bank, size_t item, int answer, double theta, double &f,
+	                             double &f_prime, double &f_primeprime, double &g, double &g_prime,
+	                             double &g_primeprime) {
+		size_t index = ((size_t) answer) - 1;
+
+		double discrimination = bank.discrimination[item];
+		const double* categoryparams = bank.item_thresholds(item);
+		const size_t category_count = bank.threshold_count(item);
+
+		double sum = discrimination * (theta - 0.0);
+		g = exp(sum);
+		double x = discrimination;
+		g_prime = g*x;
+		g_primeprime = g_prime*x;
+
+		if (index == 0) {
+			f = g;
+			f_prime = g_prime;
+			f_primeprime = g_primeprime;
+
+			for (size_t c = 0; c < category_count; ++c) {
+				sum += discrimination * (theta - categoryparams[c]);
+				double num = exp(sum);
+				x += discrimination;
+				double num_x = num*x;
+				g += num;
+				g_prime += num_x;
+				g_primeprime += num_x*x;
+			}
+		}
+		else {
+			index -= 1;
+			for (size_t i = 0; i != index; ++i) {
+				sum += discrimination * (theta - categoryparams[i]);
+				double num = exp(sum);
+				x += discrimination;
+				double num_x = num*x;
+				g += num;
+				g_prime += num_x;
+				g_primeprime += num_x*x;
+			}
+
+			sum += discrimination * (theta - categoryparams[index]);
+			f = exp(sum);
+			x += discrimination;
+			f_prime = f*x;
+			f_primeprime = f_prime*x;
+			g += f;
+			g_prime += f_prime;
+			g_primeprime += f_primeprime;
+
+			for (size_t i = index+1; i < category_count; ++i) {
+				sum += discrimination * (theta - categoryparams[i]);
+				double num = exp(sum);
+				x += discrimination;
+				double num_x = num*x;
+				g += num;
+				g_prime += num_x;
+				g_primeprime += num_x*x;
+			}
+		}
+
+		if (g == 0.0 or std::isinf(g)) {
+			throw std::domain_error("Theta value too extreme for numerical routines.");
+		}
+	}
+
+	static double d2(const ItemBank &bank, size_t item, int answer, double theta) {
+		double f, f_prime, f_primeprime, g, g_prime, g_primeprime;
+		answerNumerators(bank, item, answer, theta, f, f_prime, f_primeprime, g, g_prime, g_primeprime);
+		return d2FromNumerators(f, f_prime, f_primeprime, g, g_prime, g_primeprime);
+	}
+
+	static double d2FromNumerators(double f, double f_prime, double f_primeprime, double g, double g_prime,
+	                               double g_primeprime) {
+		double b = g*g;
+		double b2 = b*b;
+		double b_prime = 2.0 * g * g_prime;
+
+		double a = g * f_prime - f * g_prime;
+		f_prime = a / b; // p_prime
+
+		double a_prime = f_primeprime * g - g_primeprime * f;
+		f_primeprime = (b * a_prime - a * b_prime) / b2; // p_primeprime
+
+		f /= g; // p
+
+		return - ((f_prime*f_prime/f - f_primeprime) / f);
+	}
+
+	static void terms(const ItemBank &bank, size_t item, int answer, double theta, bool with_log,
+	                  LikelihoodTerms &out) {
+		double f, f_prime, f_primeprime, g, g_prime, g_primeprime;
+		answerNumerators(bank, item, answer, theta, f, f_prime, f_primeprime, g, g_prime, g_primeprime);
+		out.logL = with_log ? log(f/g) : NAN;
+		out.d1 = (g*f_prime - f*g_prime)/(g*f);
+		out.d2 = d2FromNumerators(f, f_prime, f_primeprime, g, g_prime, g_primeprime);
+	}
+
+	/**
+	 * Information from the exponentiated numerators of an item's count categories.
+	 */
+	static double infoFromExp(double discrimination, const double *numerators, size_t count) {
+		double x = discrimination;
+		double g = numerators[0];
+		double g_prime = g*x;
+		double g_primeprime = g_prime*x;
+		for (size_t c = 1; c < count; ++c) {
+			x += discrimination;
+			double num_x = numerators[c]*x;
+			g += numerators[c];
+			g_prime += num_x;
+			g_primeprime += num_x*x;
+		}
+
+		double b = g*g;
+		double b2 = b*b;
+		double b_prime = 2.0 * g * g_prime;
+
+		double output = 0.0;
+		x = discrimination;
+		for (size_t i = 0; i < count; ++i) {
+			if (i > 0) {
+				x += discrimination;
+			}
+			double num_x = numerators[i]*x;
+			double num_xx = num_x*x;
+
+			double a = g * num_x - numerators[i] * g_prime;
+			double p_prime = a / b;
+			double a_prime = num_xx * g - g_primeprime * numerators[i];
+			double p_primeprime = (b * a_prime - a * b_prime) / b2;
+			double p = numerators[i] / g;
+			output += (std::pow(p_prime, 2.0) / p) - p_primeprime;
+		}
+		return output;
+	}
+
+	static double fisherInf(const ItemBank &bank, size_t item, double theta) {
+		const size_t count = bank.threshold_count(item) + 1;
+		ScratchBuffer numerators(count);
+		exponents(bank, item, theta, numerators.data());
+		for (size_t c = 0; c < count; ++c) {
+			numerators[c] = exp(numerators[c]);
+		}
+		return infoFromExp(bank.discrimination[item], numerators.data(), count);
+	}
+
+	static void fisherInf(const ItemBank &bank, const int *items, size_t n, double theta, double *out) {
+		double buffer[modelBatchSize];
+		size_t start = 0;
+		while (start < n) {
+			size_t end = start;
+			size_t used = 0;
+			while (end < n && used + bank.threshold_count(items[end]) + 1 <= modelBatchSize) {
+				exponents(bank, items[end], theta, buffer + used);
+				used += bank.threshold_count(items[end]) + 1;
+				++end;
+			}
+			if (end == start) {
+				out[start] = fisherInf(bank, items[start], theta);
+				++start;
+				continue;
+			}
+
+			vexp(buffer, buffer, used);
+			used = 0;
+			for (size_t i = start; i < end; ++i) {
+				const size_t count = bank.threshold_count(items[i]) + 1;
+				out[i] = infoFromExp(bank.discrimination[items[i]], buffer + used, count);
+				used += count;
+			}
+			start = end;
+		}
+	}
+
+	/**
+	 * An upper bound on fisherInf over [lower, upper]. The information is discrimination^2 times the variance of
+	 * the category, whose mean is monotone in theta. Each category's probability peaks where the mean equals that
+	 * category, so it is bounded by its larger endpoint value unless the mean crosses it within the interval.
+	 */
+	static double infoBound(const ItemBank &bank, size_t item, double lower, double upper) {
+		const size_t count = probabilityCount(bank, item);
+		ScratchBuffer lower_probs(count);
+		ScratchBuffer upper_probs(count);
+		probabilities(bank, item, lower, lower_probs.data());
+		probabilities(bank, item, upper, upper_probs.data());
+
+		double lower_mean = 0.0;
+		double upper_mean = 0.0;
+		for (size_t c = 0; c < count; ++c) {
+			lower_mean += c * lower_probs[c];
+			upper_mean += c * upper_probs[c];
+		}
+		const double min_mean = std::min(lower_mean, upper_mean);
+		const double max_mean = std::max(lower_mean, upper_mean);
+
+		double variance = 0.0;
+		for (size_t c = 0; c < count; ++c) {
+			const double category = double(c);
+			const double prob = (category >= min_mean && category <= max_mean) ?
+			                    1.0 : std::max(lower_probs[c], upper_probs[c]);
+			const double distance = std::max(std::abs(category - min_mean), std::abs(category - max_mean));
+			variance += prob * distance * distance;
+		}
+		// No distribution over 0 to count - 1 has a larger variance
+		variance = std::min(variance, std::pow(double(count - 1), 2.0) / 4.0);
+		return std::pow(bank.discrimination[item], 2.0) * variance;
+	}
+
+	static double kl(const ItemBank &bank, size_t item, double theta_not, double theta) {
+		ScratchBuffer log_reference(klReferenceCount(bank, item));
+		klReference(bank, item, theta, log_reference.data());
+		return kl(bank, item, theta_not, log_reference.data());
+	}
+
+	static size_t klReferenceCount(const ItemBank &bank, size_t item) {
+		return probabilityCount(bank, item);
+	}
+
+	static void klReference(const ItemBank &bank, size_t item, double theta, double *log_reference) {
+		const size_t count = probabilityCount(bank, item);
+		probabilities(bank, item, theta, log_reference);
+		for (size_t i = 0; i < count; ++i) {
+			log_reference[i] = log(log_reference[i]);
+		}
+	}
+
+	static double kl(const ItemBank &bank, size_t item, double theta_not, const double *log_reference) {
+		const size_t count = probabilityCount(bank, item);
+		ScratchBuffer prob_theta_not(count);
+		probabilities(bank, item, theta_not, prob_theta_not.data());
+
+		double sum = 0.0;
+		for (size_t i = 0; i < count; ++i) {
+			sum += prob_theta_not[i] * (log(prob_theta_not[i]) - log_reference[i]);
+		}
+		return sum;
+	}
+};
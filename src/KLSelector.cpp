@@ -2,15 +2,15 @@
 #include "ParallelUtil.h"
 
 
-struct ExpectedKL : public mpl::FunctionCaller<Prior>
+struct ExpectedKL : public mpl::FunctionCaller<SelectionContext>
 {
-	using Base = mpl::FunctionCaller<Prior>;
+	using Base = mpl::FunctionCaller<SelectionContext>;
 
-	ExpectedKL(Estimator& e, Prior& p):Base{e,p}{}
+	ExpectedKL(const Estimator& e, SelectionContext& c):Base{e,c}{}
 
-	double operator()(int question)
+	void operator()(const int* questions, size_t n, double* values)
 	{
-		return estimator.expectedKL(question, arg);
+		estimator.expectedKL(questions, n, arg, values);
 	}
 };
 
@@ -28,25 +28,26 @@ Selection KLSelector::selectItem() {
 	selection.name = "KL";
 	selection.questions = questionSet.nonapplicable_rows;
 
-	selection.values.resize(selection.questions.size());
+	SelectionContext context = estimator.selectionContext(prior, true);
 
 	//auto func = [&](int question){return this->estimator.expectedKL(question, prior);};
 	//std::transform(selection.questions.begin(),selection.questions.end(),selection.values.begin(), func);
 
-	mpl::ParallelHelper<ExpectedKL> helper(selection.questions, selection.values, estimator, prior);
-   	// call parallelFor to do the work
-  	RcppParallel::parallelFor(0, selection.questions.size(), helper);
-
-	auto max_itr = std::max_element(selection.values.begin(), selection.values.end());
-	selection.item = selection.questions.at(std::distance(selection.values.begin(),max_itr));
+	auto evaluate = [&](const std::vector<int> &questions, std::vector<double> &values) {
+		// Each block of items shares one integral, whose points are evaluated once for all of them
+		mpl::FixedBlockHelper<ExpectedKL> helper(questions, values, integralBlockSize, estimator, context);
+	   	// call parallelFor to do the work
+	  	mpl::parallelFor(0, helper.blocks(), helper);
+	};
+	selectScreened(selection, context.theta, false, evaluate);
 
 	selection.question_names.resize(selection.questions.size());
 
-	auto qn_name = [&](int question){return this->questionSet.question_names.at(question);};
+	auto qn_name = [&](int question){return this->questionSet.bank->names.at(question);};
 	std::transform(selection.questions.begin(),selection.questions.end(),selection.question_names.begin(), qn_name);
 
 	return selection;
 }
 
-KLSelector::KLSelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel) : Selector(questions, estimation,
-                                                                                                        priorModel) { }
\ No newline at end of file
+KLSelector::KLSelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel,
+                       const Screen &screen) : Selector(questions, estimation, priorModel, screen) { }
\ No newline at end of file
@@ -4,7 +4,8 @@
 class KLSelector : public Selector {
 
 public:
-	KLSelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel);
+	KLSelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel,
+	           const Screen &screen = Screen{0, 0, nullptr});
 
 	virtual SelectionType getSelectionType() override;
 
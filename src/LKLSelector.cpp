@@ -2,15 +2,15 @@
 #include "ParallelUtil.h"
 
 
-struct LikelihoodKL : public mpl::FunctionCaller<Prior>
+struct LikelihoodKL : public mpl::FunctionCaller<SelectionContext>
 {
-	using Base = mpl::FunctionCaller<Prior>;
+	using Base = mpl::FunctionCaller<SelectionContext>;
 
-	LikelihoodKL(Estimator& e, Prior& p):Base{e,p}{}
+	LikelihoodKL(const Estimator& e, SelectionContext& c):Base{e,c}{}
 
-	double operator()(int question)
+	void operator()(const int* questions, size_t n, double* values)
 	{
-		return estimator.likelihoodKL(question, arg);
+		estimator.likelihoodKL(questions, n, arg, values);
 	}
 };
 
@@ -25,20 +25,23 @@ Selection LKLSelector::selectItem() {
 
 	selection.values.resize(selection.questions.size());
 
-	mpl::ParallelHelper<LikelihoodKL> helper(selection.questions, selection.values, estimator, prior);
+	SelectionContext context = estimator.selectionContext(prior);
+
+	// Each block of items shares one integral, whose points are evaluated once for all of them
+	mpl::FixedBlockHelper<LikelihoodKL> helper(selection.questions, selection.values, integralBlockSize, estimator, context);
    	// call parallelFor to do the work
-  	RcppParallel::parallelFor(0, selection.questions.size(), helper);
+  	mpl::parallelFor(0, helper.blocks(), helper);
 
 	auto max_itr = std::max_element(selection.values.begin(), selection.values.end());
 	selection.item = selection.questions.at(std::distance(selection.values.begin(),max_itr));
 
 	selection.question_names.resize(selection.questions.size());
 
-	auto qn_name = [&](int question){return this->questionSet.question_names.at(question);};
+	auto qn_name = [&](int question){return this->questionSet.bank->names.at(question);};
 	std::transform(selection.questions.begin(),selection.questions.end(),selection.question_names.begin(), qn_name);
 
 	return selection;
 }
 
-LKLSelector::LKLSelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel) : Selector(questions, estimation,
-                                                                                                        priorModel) { }
\ No newline at end of file
+LKLSelector::LKLSelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel) : Selector(questions, estimation,
+                                                                                                                  priorModel) { }
\ No newline at end of file
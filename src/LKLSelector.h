@@ -4,7 +4,7 @@
 class LKLSelector : public Selector {
 
 public:
-	LKLSelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel);
+	LKLSelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel);
 
 	virtual SelectionType getSelectionType() override;
 
@@ -2,7 +2,7 @@
 using namespace Rcpp;
 #include "MAPEstimator.h"
 
-double MAPEstimator::estimateTheta(Prior prior) {
+double MAPEstimator::estimateTheta(Prior prior) const {
   int iter = 0;
   int max_iter = 200;
   
@@ -15,7 +15,8 @@ double MAPEstimator::estimateTheta(Prior prior) {
 	
 	while (difference > tolerance && iter < max_iter) {
 	  iter++;
-		theta_hat_new = theta_hat_old - d1LL(theta_hat_old, true, prior) / d2LL(theta_hat_old, true, prior);
+		LikelihoodTerms terms = likelihoodTerms(theta_hat_old, true, prior, false);
+		theta_hat_new = theta_hat_old - terms.d1 / terms.d2;
 		difference = std::abs(theta_hat_new - theta_hat_old);
 		theta_hat_old = theta_hat_new;
 	}
@@ -23,13 +24,19 @@ double MAPEstimator::estimateTheta(Prior prior) {
 	return theta_hat_new;
 }
 
-double MAPEstimator::estimateTheta(Prior prior, size_t question, int answer)
+double MAPEstimator::estimateTheta(Prior prior, size_t question, int answer) const
+{
+	bool converged;
+	return newtonTheta(prior, question, answer, 0.0, converged);
+}
+
+double MAPEstimator::newtonTheta(Prior &prior, size_t question, int answer, double start, bool &converged) const
 {
 	int iter = 0;
   	int max_iter = 200;
   
-	double theta_hat_old = 0.0;
-	double theta_hat_new = 1.0;
+	double theta_hat_old = start;
+	double theta_hat_new = start + 1.0;
 
 	const double tolerance = 0.0000001;
 
@@ -37,27 +44,51 @@ double MAPEstimator::estimateTheta(Prior prior, size_t question, int answer)
 	
 	while (difference > tolerance && iter < max_iter) {
 	  	iter++;
-		theta_hat_new = theta_hat_old - d1LL(theta_hat_old, true, prior,question,answer) / d2LL(theta_hat_old, true, prior,question,answer);
+		LikelihoodTerms terms = likelihoodTerms(theta_hat_old, true, prior, question, answer, false);
+		theta_hat_new = theta_hat_old - terms.d1 / terms.d2;
 		difference = std::abs(theta_hat_new - theta_hat_old);
 		theta_hat_old = theta_hat_new;
 	}
 	
+	converged = difference <= tolerance;
 	return theta_hat_new;
 }
 
-double MAPEstimator::estimateSE(Prior prior) {
+double MAPEstimator::estimateSE(Prior prior) const {
   double var = 1.0 / (fisherTestInfo(prior) + (1 / std::pow(prior.param1(), 2)));
   return std::pow(var, 0.5);
 }
 
-double MAPEstimator::estimateSE(Prior prior, size_t question, int answer)
+double MAPEstimator::estimateSE(Prior prior, size_t question, int answer) const
 {
 	double var = 1.0 / (fisherTestInfo(prior,question,answer) + (1 / std::pow(prior.param1(), 2)));
   	return std::pow(var, 0.5);
 }
 
+double MAPEstimator::hypotheticalTheta(const SelectionContext &context, size_t question, int answer) const {
+	if (std::isfinite(context.theta)) {
+		try {
+			bool converged;
+			double theta = newtonTheta(context.prior, question, answer, context.theta, converged);
+			if (converged) {
+				return theta;
+			}
+		}
+		catch (std::domain_error &) {
+		}
+	}
+	// Start from 0 when the warm start does not converge, as estimateTheta does
+	return estimateTheta(context.prior, question, answer);
+}
+
+double MAPEstimator::hypotheticalSE(const SelectionContext &context, size_t question, int answer) const {
+	double theta = hypotheticalTheta(context, question, answer);
+	double var = 1.0 / (testInfo(theta, question, answer) + (1 / std::pow(context.prior.param1(), 2)));
+	return std::pow(var, 0.5);
+}
+
 EstimationType MAPEstimator::getEstimationType() const {
 	return EstimationType::MAP;
 }
 
-MAPEstimator::MAPEstimator(Integrator &integrator, QuestionSet &questionSet) : Estimator(integrator, questionSet) { }
\ No newline at end of file
+MAPEstimator::MAPEstimator(Integrator &integrator, const QuestionSet &questionSet) : Estimator(integrator, questionSet) { }
\ No newline at end of file
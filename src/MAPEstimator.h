@@ -7,14 +7,29 @@ class MAPEstimator : public Estimator {
 
 public:
 
-	MAPEstimator(Integrator &integrator, QuestionSet &questionSet);
+	MAPEstimator(Integrator &integrator, const QuestionSet &questionSet);
 
 	virtual EstimationType getEstimationType() const override;
 
-	virtual double estimateTheta(Prior prior) override;
-	virtual double estimateTheta(Prior prior, size_t question, int answer) override;
+	virtual double estimateTheta(Prior prior) const override;
+	virtual double estimateTheta(Prior prior, size_t question, int answer) const override;
 	
-	virtual double estimateSE(Prior prior) override;
-	virtual double estimateSE(Prior prior, size_t question, int answer) override;
+	virtual double estimateSE(Prior prior) const override;
+	virtual double estimateSE(Prior prior, size_t question, int answer) const override;
+
+	/**
+	 * Newton's method started from context.theta can reach the posterior mode where estimateTheta, which starts
+	 * from 0, stops elsewhere, so the hypothetical estimate for an answer can differ from what estimateTheta
+	 * returns once that answer is stored.
+	 */
+	virtual double hypotheticalTheta(const SelectionContext &context, size_t question, int answer) const override;
+	virtual double hypotheticalSE(const SelectionContext &context, size_t question, int answer) const override;
+
+private:
+	/**
+	 * Newton iterations for the estimate with the hypothetical answer, starting from start; converged is false
+	 * if they stopped at the iteration limit instead.
+	 */
+	double newtonTheta(Prior &prior, size_t question, int answer, double start, bool &converged) const;
 
 };
\ No newline at end of file
@@ -1,11 +1,11 @@
 #include "MEISelector.h"
 #include "ParallelUtil.h"
 
-struct EObsInf_grm : public mpl::FunctionCaller<Prior>
+struct EObsInf_grm : public mpl::FunctionCaller<SelectionContext>
 {
-	using Base = mpl::FunctionCaller<Prior>;
+	using Base = mpl::FunctionCaller<SelectionContext>;
 
-	EObsInf_grm(Estimator& e, Prior& p):Base{e,p}{}
+	EObsInf_grm(const Estimator& e, SelectionContext& c):Base{e,c}{}
 
 	double operator()(int question)
 	{
@@ -13,11 +13,11 @@ struct EObsInf_grm : public mpl::FunctionCaller<Prior>
 	}
 };
 
-struct EObsInf_gpcm: public mpl::FunctionCaller<Prior>
+struct EObsInf_gpcm: public mpl::FunctionCaller<SelectionContext>
 {
-	using Base = mpl::FunctionCaller<Prior>;
+	using Base = mpl::FunctionCaller<SelectionContext>;
 
-	EObsInf_gpcm(Estimator& e, Prior& p):Base{e,p}{}
+	EObsInf_gpcm(const Estimator& e, SelectionContext& c):Base{e,c}{}
 
 	double operator()(int question)
 	{
@@ -25,11 +25,11 @@ struct EObsInf_gpcm: public mpl::FunctionCaller<Prior>
 	}
 };
 
-struct EObsInf_rest: public mpl::FunctionCaller<Prior>
+struct EObsInf_rest: public mpl::FunctionCaller<SelectionContext>
 {
-	using Base = mpl::FunctionCaller<Prior>;
+	using Base = mpl::FunctionCaller<SelectionContext>;
 
-	EObsInf_rest(Estimator& e, Prior& p):Base{e,p}{}
+	EObsInf_rest(const Estimator& e, SelectionContext& c):Base{e,c}{}
 
 	double operator()(int question)
 	{
@@ -37,9 +37,8 @@ struct EObsInf_rest: public mpl::FunctionCaller<Prior>
 	}
 };
 
-MEISelector::MEISelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel) : Selector(questions,
-                                                                                                      estimation,
-                                                                                                      priorModel) { }
+MEISelector::MEISelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel,
+                         const Screen &screen) : Selector(questions, estimation, priorModel, screen) { }
 
 SelectionType MEISelector::getSelectionType() {
 	return SelectionType::MEI;
@@ -51,34 +50,34 @@ Selection MEISelector::selectItem() {
 	selection.values.reserve(questionSet.nonapplicable_rows.size());
 	selection.name = "MEI";
 
-	selection.values.resize(selection.questions.size());
-
-	if(questionSet.model == "grm")
-	{
-		mpl::ParallelHelper<EObsInf_grm> helper(selection.questions, selection.values, estimator, prior);
-   		// call parallelFor to do the work
-  		RcppParallel::parallelFor(0, selection.questions.size(), helper);
-	}
-	else if(questionSet.model == "gpcm")
-	{
-		mpl::ParallelHelper<EObsInf_gpcm> helper(selection.questions, selection.values, estimator, prior);
-   		// call parallelFor to do the work
-  		RcppParallel::parallelFor(0, selection.questions.size(), helper);
-
-	}
-	else
-	{
-		mpl::ParallelHelper<EObsInf_rest> helper(selection.questions, selection.values, estimator, prior);
-   		// call parallelFor to do the work
-  		RcppParallel::parallelFor(0, selection.questions.size(), helper);
-	}
-
-	auto max_itr = std::max_element(selection.values.begin(), selection.values.end());
-	selection.item = selection.questions.at(std::distance(selection.values.begin(),max_itr));
+	SelectionContext context = estimator.selectionContext(prior);
+
+	auto evaluate = [&](const std::vector<int> &questions, std::vector<double> &values) {
+		if(questionSet.bank->model_type == ModelType::GRM)
+		{
+			mpl::ParallelHelper<EObsInf_grm> helper(questions, values, estimator, context);
+	   		// call parallelFor to do the work
+	  		mpl::parallelFor(0, questions.size(), helper);
+		}
+		else if(questionSet.bank->model_type == ModelType::GPCM)
+		{
+			mpl::ParallelHelper<EObsInf_gpcm> helper(questions, values, estimator, context);
+	   		// call parallelFor to do the work
+	  		mpl::parallelFor(0, questions.size(), helper);
+
+		}
+		else
+		{
+			mpl::ParallelHelper<EObsInf_rest> helper(questions, values, estimator, context);
+	   		// call parallelFor to do the work
+	  		mpl::parallelFor(0, questions.size(), helper);
+		}
+	};
+	selectScreened(selection, context.theta, false, evaluate);
 
 	selection.question_names.resize(selection.questions.size());
 
-	auto qn_name = [&](int question){return this->questionSet.question_names.at(question);};
+	auto qn_name = [&](int question){return this->questionSet.bank->names.at(question);};
 	std::transform(selection.questions.begin(),selection.questions.end(),selection.question_names.begin(), qn_name);
 
 	return selection;
@@ -6,7 +6,8 @@
 class MEISelector : public Selector {
 
 public:
-	MEISelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel);
+	MEISelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel,
+	            const Screen &screen = Screen{0, 0, nullptr});
 
 	virtual SelectionType getSelectionType();
 
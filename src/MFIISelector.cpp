@@ -1,11 +1,11 @@
 #include "MFIISelector.h"
 #include "ParallelUtil.h"
 
-struct MFII : public mpl::FunctionCaller<Prior>
+struct MFII : public mpl::FunctionCaller<SelectionContext>
 {
-	using Base = mpl::FunctionCaller<Prior>;
+	using Base = mpl::FunctionCaller<SelectionContext>;
 
-	MFII(Estimator& e, Prior& p):Base{e,p}{}
+	MFII(const Estimator& e, SelectionContext& c):Base{e,c}{}
 
 	double operator()(int question)
 	{
@@ -30,21 +30,23 @@ Selection MFIISelector::selectItem() {
 
 	selection.values.resize(selection.questions.size());
 
-	mpl::ParallelHelper<MFII> helper(selection.questions, selection.values, estimator, prior);
+	SelectionContext context = estimator.selectionContext(prior, true);
+
+	mpl::ParallelHelper<MFII> helper(selection.questions, selection.values, estimator, context);
    	// call parallelFor to do the work
-  	RcppParallel::parallelFor(0, selection.questions.size(), helper);
+  	mpl::parallelFor(0, selection.questions.size(), helper);
 
 	auto max_itr = std::max_element(selection.values.begin(), selection.values.end());
 	selection.item = selection.questions.at(std::distance(selection.values.begin(),max_itr));
 
 	selection.question_names.resize(selection.questions.size());
 
-	auto qn_name = [&](int question){return this->questionSet.question_names.at(question);};
+	auto qn_name = [&](int question){return this->questionSet.bank->names.at(question);};
 	std::transform(selection.questions.begin(),selection.questions.end(),selection.question_names.begin(), qn_name);
 
 	return selection;
 }
 
-MFIISelector::MFIISelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel) : Selector(questions,
-                                                                                                      estimation,
-                                                                                                      priorModel) { }
+MFIISelector::MFIISelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel) : Selector(questions,
+                                                                                                                    estimation,
+                                                                                                                    priorModel) { }
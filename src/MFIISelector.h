@@ -4,7 +4,7 @@
 class MFIISelector : public Selector {
 
 public:
-	MFIISelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel);
+	MFIISelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel);
 	virtual SelectionType getSelectionType();
 
 	virtual Selection selectItem();
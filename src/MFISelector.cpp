@@ -1,15 +1,17 @@
 #include "MFISelector.h"
 #include "ParallelUtil.h"
+#include <limits>
+#include <numeric>
 
 struct MFI : public mpl::FunctionCaller<double>
 {
 	using Base = mpl::FunctionCaller<double>;
 
-	MFI(Estimator& e, double& p):Base{e,p}{}
+	MFI(const Estimator& e, double& p):Base{e,p}{}
 
-	double operator()(int question)
+	void operator()(const int* questions, size_t n, double* values)
 	{
-		return estimator.fisherInf(arg, question);
+		estimator.fisherInf(arg, questions, n, values);
 	}
 };
 
@@ -28,21 +30,96 @@ Selection MFISelector::selectItem() {
 
 	selection.values.resize(selection.questions.size());
 
-	mpl::ParallelHelper<MFI> helper(selection.questions, selection.values, estimator, theta);
-   	// call parallelFor to do the work
-  	RcppParallel::parallelFor(0, selection.questions.size(), helper);
+	size_t bin = 0;
+	int best = -1;
+	if (info_table != nullptr && !selection.questions.empty() &&
+	    info_table->interpolate(theta, selection.questions.data(), selection.questions.size(), selection.values.data())) {
+		selection.item = selection.questions.at(refineBest(theta, selection));
+	}
+	else if (info_bounds != nullptr && !selection.questions.empty() && info_bounds->bin(theta, bin) &&
+	         (best = searchBounds(theta, bin, selection)) >= 0) {
+		selection.item = best;
+	}
+	else {
+		mpl::ParallelBlockHelper<MFI> helper(selection.questions, selection.values, estimator, theta);
+	   	// call parallelFor to do the work
+	  	mpl::parallelFor(0, selection.questions.size(), helper);
 
-	auto max_itr = std::max_element(selection.values.begin(), selection.values.end());
-	selection.item = selection.questions.at(std::distance(selection.values.begin(),max_itr));
+		auto max_itr = std::max_element(selection.values.begin(), selection.values.end());
+		selection.item = selection.questions.at(std::distance(selection.values.begin(),max_itr));
+	}
 
 	selection.question_names.resize(selection.questions.size());
 
-	auto qn_name = [&](int question){return this->questionSet.question_names.at(question);};
+	auto qn_name = [&](int question){return this->questionSet.bank->names.at(question);};
 	std::transform(selection.questions.begin(),selection.questions.end(),selection.question_names.begin(), qn_name);
 
 	return selection;
 }
 
-MFISelector::MFISelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel) : Selector(questions,
-                                                                                                      estimation,
-                                                                                                      priorModel) { }
+size_t MFISelector::refineBest(double theta, Selection &selection) const {
+	std::vector<double> &values = selection.values;
+	auto lower_value = [&](size_t a, size_t b) {
+		return values[a] < values[b] || (values[a] == values[b] && a > b);
+	};
+
+	// A heap of the items not yet refined, highest interpolated value on top
+	std::vector<size_t> order(values.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::make_heap(order.begin(), order.end(), lower_value);
+
+	size_t remaining = order.size();
+	size_t refined = 0;
+	size_t best = 0;
+	double best_value = -std::numeric_limits<double>::infinity();
+	while (remaining > 0 && (refined < refine || values[order.front()] >= best_value)) {
+		std::pop_heap(order.begin(), order.begin() + remaining, lower_value);
+		const size_t index = order[--remaining];
+		values[index] = estimator.fisherInf(theta, selection.questions[index]);
+		++refined;
+		if (values[index] > best_value || (values[index] == best_value && index < best)) {
+			best = index;
+			best_value = values[index];
+		}
+	}
+	return best;
+}
+
+int MFISelector::searchBounds(double theta, size_t bin, Selection &selection) const {
+	const size_t count = questionSet.bank->size();
+	const int *items = info_bounds->items(bin);
+	const double *bounds = info_bounds->bounds(bin);
+	std::fill(selection.values.begin(), selection.values.end(), NA_REAL);
+
+	int block[boundBlockSize];
+	double values[boundBlockSize];
+	int best = -1;
+	double best_value = -std::numeric_limits<double>::infinity();
+	size_t next = 0;
+	while (next < count && bounds[next] >= best_value) {
+		// The next unanswered items that could still beat the best one
+		size_t n = 0;
+		for (; next < count && n < boundBlockSize && bounds[next] >= best_value; ++next) {
+			if (questionSet.answers[items[next]] == NA_INTEGER) {
+				block[n++] = items[next];
+			}
+		}
+		estimator.fisherInf(theta, block, n, values);
+
+		for (size_t i = 0; i < n; ++i) {
+			auto position = std::lower_bound(selection.questions.begin(), selection.questions.end(), block[i]);
+			selection.values[std::distance(selection.questions.begin(), position)] = values[i];
+			// Ties go to the first item, as in a scan in item order
+			if (values[i] > best_value || (values[i] == best_value && block[i] < best)) {
+				best = block[i];
+				best_value = values[i];
+			}
+		}
+	}
+	return best;
+}
+
+MFISelector::MFISelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel,
+                         const InfoTable *info_table, size_t refine, const InfoBounds *info_bounds)
+		: Selector(questions, estimation, priorModel), info_table(info_table), refine(refine),
+		  info_bounds(info_bounds) { }
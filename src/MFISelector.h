@@ -1,12 +1,37 @@
 #pragma once
 #include "Selector.h"
+#include "InfoTable.h"
+#include "InfoBounds.h"
 
 class MFISelector : public Selector {
 
 public:
-	MFISelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel);
+	/**
+	 * With an info_table, the information of every item is interpolated in it, and computed exactly for the refine
+	 * items that interpolate highest, and then for the next highest as long as any of those could still beat the
+	 * best exact value. The selected item is the one with the largest exact information; the values of the items
+	 * not refined are the interpolated ones.
+	 *
+	 * With info_bounds, the items are evaluated in decreasing order of their bound at theta until the next bound
+	 * is below the best information found, so the selected item is the one a full scan selects. The values of the
+	 * items not evaluated are NA.
+	 */
+	MFISelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel,
+	            const InfoTable *info_table = nullptr, size_t refine = 0, const InfoBounds *info_bounds = nullptr);
 	virtual SelectionType getSelectionType();
 
 	virtual Selection selectItem();
-};
 
+private:
+	const InfoTable *info_table;
+	size_t refine;
+	const InfoBounds *info_bounds;
+
+	/**
+	 * Number of items whose information searchBounds computes in one call to the batch kernel.
+	 */
+	static const size_t boundBlockSize = 16;
+
+	size_t refineBest(double theta, Selection &selection) const;
+	int searchBounds(double theta, size_t bin, Selection &selection) const;
+};
@@ -1,24 +1,38 @@
 #include "QuestionSet.h"
 #include "MLEEstimator.h"
+#include <stdexcept>
 
-double MLEEstimator::d1LL_root(){
+namespace {
 
-  integrableFunction d1LL_fctn = [&](double theta) {
+// Answers need a cumulative probability on either side
+void checkAnswer(int answer, size_t count) {
+	if (answer < 1 || size_t(answer) >= count) {
+		throw std::out_of_range("answer is outside the item's cumulative probabilities.");
+	}
+}
+
+}
+
+double MLEEstimator::d1LL_root() const{
+
+  auto d1LL_fctn = [&](double theta) {
     double l_theta = 0.0;
     
 	  for (auto question : questionSet.applicable_rows){
 		  const int answer_k = questionSet.answers.at(question);
-		  auto probs = probability(theta, (size_t) question);
+		  ScratchBuffer probs(probabilityCount((size_t) question));
+		  probability(theta, (size_t) question, probs.data());
+		  checkAnswer(answer_k, probabilityCount((size_t) question));
 		  
-		  double P_star1 = probs.at(answer_k);
+		  double P_star1 = probs[answer_k];
 		  double Q_star1 = 1.0 - P_star1;
-		  double P_star2 = probs.at(answer_k - 1);
+		  double P_star2 = probs[answer_k - 1];
 		  double Q_star2 = 1 - P_star2;
 		  double P = P_star1 - P_star2;
 		  double w2 = P_star2 * Q_star2;
 		  double w1 = P_star1 * Q_star1;
 
-		  l_theta += (-1*questionSet.discrimination.at(question) * ((w1 - w2) / P));
+		  l_theta += (-1*questionSet.bank->discrimination[question] * ((w1 - w2) / P));
 		}
 	  return l_theta;
 	  };
@@ -26,31 +40,35 @@ double MLEEstimator::d1LL_root(){
   return brentMethod(d1LL_fctn);
 }
 
-double MLEEstimator::d1LL_root(size_t question, int answer){
+double MLEEstimator::d1LL_root(size_t question, int answer) const{
 
-  integrableFunction d1LL_fctn = [&](double theta) {
+  auto d1LL_fctn = [&](double theta) {
     double l_theta = 0.0;
     
 	  for (auto q : questionSet.applicable_rows){
 		  int answer_k = questionSet.answers.at(q);
-		  auto probs = probability(theta, (size_t) q);
+		  ScratchBuffer probs(probabilityCount((size_t) q));
+		  probability(theta, (size_t) q, probs.data());
+		  checkAnswer(answer_k, probabilityCount((size_t) q));
 		  
-		  double P_star1 = probs.at(answer_k);
-		  double P_star2 = probs.at(answer_k - 1);
+		  double P_star1 = probs[answer_k];
+		  double P_star2 = probs[answer_k - 1];
 		  double P = P_star1 - P_star2;
 		  double w = P_star1 * (1.0 - P_star1) - P_star2 * (1 - P_star2);
 
-		  l_theta += (-1*questionSet.discrimination.at(q) * (w / P));
+		  l_theta += (-1*questionSet.bank->discrimination[q] * (w / P));
 		}
 
-	  auto probs = probability(theta, (size_t) question);
+	  ScratchBuffer probs(probabilityCount(question));
+	  probability(theta, question, probs.data());
+	  checkAnswer(answer, probabilityCount(question));
 	  
-	  double P_star1 = probs.at(answer);
-	  double P_star2 = probs.at(answer - 1);
+	  double P_star1 = probs[answer];
+	  double P_star2 = probs[answer - 1];
 	  double P = P_star1 - P_star2;
 	  double w = P_star1 * (1.0 - P_star1) - P_star2 * (1 - P_star2);
 
-	  l_theta += (-1*questionSet.discrimination.at(question) * (w / P));
+	  l_theta += (-1*questionSet.bank->discrimination[question] * (w / P));
 
 	  return l_theta;
 	  };
@@ -58,7 +76,7 @@ double MLEEstimator::d1LL_root(size_t question, int answer){
   return brentMethod(d1LL_fctn);
 }
 
-double MLEEstimator::estimateTheta(Prior prior) {
+double MLEEstimator::estimateTheta(Prior prior) const {
   int iter = 0;
   int max_iter = 200;
   
@@ -68,16 +86,17 @@ double MLEEstimator::estimateTheta(Prior prior) {
 	const double tolerance = 0.0000001;
 
 	double difference = std::abs(theta_hat_new - theta_hat_old);
+	LikelihoodTerms terms = likelihoodTerms(theta_hat_old, false, prior, false);
 	
 	while (difference > tolerance && iter < max_iter) {
 	  iter++;
-		theta_hat_new = theta_hat_old - d1LL(theta_hat_old, false, prior) / d2LL(theta_hat_old, false, prior);
+		theta_hat_new = theta_hat_old - terms.d1 / terms.d2;
 
 		difference = std::abs(theta_hat_new - theta_hat_old);
 		
-		// handling if probability (therefore d1LL) throws an error
+		// handling if probability (therefore d1LL) throws an error; otherwise the terms are the next iteration's
 		try {
-		  d1LL(theta_hat_new, false, prior);
+		  terms = likelihoodTerms(theta_hat_new, false, prior, false);
 		} catch (std::domain_error) {
 		  theta_hat_new = d1LL_root();
 		  break;
@@ -92,56 +111,86 @@ double MLEEstimator::estimateTheta(Prior prior) {
 	return theta_hat_new;
 }
 
-double MLEEstimator::estimateSE(Prior prior) {
+double MLEEstimator::estimateSE(Prior prior) const {
   double var = 1.0 / fisherTestInfo(prior);
   return std::pow(var, 0.5);
 }
 
-double MLEEstimator::estimateSE(Prior prior, size_t question, int answer)
+double MLEEstimator::estimateSE(Prior prior, size_t question, int answer) const
 {
 	double var = 1.0 / fisherTestInfo(prior, question, answer);
   	return std::pow(var, 0.5);
 }
 
-double MLEEstimator::estimateTheta(Prior prior, size_t question, int answer)
+double MLEEstimator::estimateTheta(Prior prior, size_t question, int answer) const
+{
+	bool converged;
+	double theta = newtonTheta(prior, question, answer, 0.0, converged);
+	return std::isnan(theta) ? d1LL_root(question, answer) : theta;
+}
+
+double MLEEstimator::newtonTheta(Prior &prior, size_t question, int answer, double start, bool &converged) const
 {
 	int iter = 0;
   	int max_iter = 200;
   
-	double theta_hat_old = 0.0;
-	double theta_hat_new = 1.0;
+	double theta_hat_old = start;
+	double theta_hat_new = start + 1.0;
 
 	const double tolerance = 0.0000001;
 
 	double difference = std::abs(theta_hat_new - theta_hat_old);
+	LikelihoodTerms terms = likelihoodTerms(theta_hat_old, false, prior, question, answer, false);
 	
 	while (difference > tolerance && iter < max_iter) {
 	  iter++;
-		theta_hat_new = theta_hat_old - d1LL(theta_hat_old, false, prior, question, answer) / d2LL(theta_hat_old, false, prior, question, answer);
+		theta_hat_new = theta_hat_old - terms.d1 / terms.d2;
 
 		difference = std::abs(theta_hat_new - theta_hat_old);
 		
-		// handling if probability (therefore d1LL) throws an error
+		// handling if probability (therefore d1LL) throws an error; otherwise the terms are the next iteration's
 		try {
-		  d1LL(theta_hat_new, false, prior, question, answer);
+		  terms = likelihoodTerms(theta_hat_new, false, prior, question, answer, false);
 		} catch (std::domain_error) {
-		  theta_hat_new = d1LL_root(question, answer);
-		  break;
+		  converged = false;
+		  return NAN;
 		}
 
 		theta_hat_old = theta_hat_new;
 		if(std::isnan(theta_hat_old)){
-		  theta_hat_new = d1LL_root(question, answer);
-		  break;
+		  converged = false;
+		  return NAN;
 		}
 	}
+	converged = difference <= tolerance;
 	return theta_hat_new;
 }
   
 
+double MLEEstimator::hypotheticalTheta(const SelectionContext &context, size_t question, int answer) const {
+	if (std::isfinite(context.theta)) {
+		try {
+			bool converged;
+			double theta = newtonTheta(context.prior, question, answer, context.theta, converged);
+			if (converged) {
+				return theta;
+			}
+		}
+		catch (std::domain_error &) {
+		}
+	}
+	// Start from 0, and fall back to the root search, when the warm start does not converge
+	return estimateTheta(context.prior, question, answer);
+}
+
+double MLEEstimator::hypotheticalSE(const SelectionContext &context, size_t question, int answer) const {
+	double var = 1.0 / testInfo(hypotheticalTheta(context, question, answer), question, answer);
+	return std::pow(var, 0.5);
+}
+
 EstimationType MLEEstimator::getEstimationType() const {
 	return EstimationType::MLE;
 }
 
-MLEEstimator::MLEEstimator(Integrator &integrator, QuestionSet &questionSet) : Estimator(integrator, questionSet) { }
+MLEEstimator::MLEEstimator(Integrator &integrator, const QuestionSet &questionSet) : Estimator(integrator, questionSet) { }
 
@@ -9,19 +9,29 @@ class MLEEstimator : public Estimator {
 
 public:
 
-	MLEEstimator(Integrator &integrator, QuestionSet &questionSet);
+	MLEEstimator(Integrator &integrator, const QuestionSet &questionSet);
 
 	virtual EstimationType getEstimationType() const override;
 
-	virtual double estimateTheta(Prior prior) override;
-	virtual double estimateTheta(Prior prior, size_t question, int answer) override;
+	virtual double estimateTheta(Prior prior) const override;
+	virtual double estimateTheta(Prior prior, size_t question, int answer) const override;
 	
-	virtual double estimateSE(Prior prior) override;
-	virtual double estimateSE(Prior prior, size_t question, int answer) override;
+	virtual double estimateSE(Prior prior) const override;
+	virtual double estimateSE(Prior prior, size_t question, int answer) const override;
+
+	virtual double hypotheticalTheta(const SelectionContext &context, size_t question, int answer) const override;
+	virtual double hypotheticalSE(const SelectionContext &context, size_t question, int answer) const override;
 
 //protected:
   
-  double d1LL_root();
-  double d1LL_root(size_t question, int answer);
+  double d1LL_root() const;
+  double d1LL_root(size_t question, int answer) const;
+
+private:
+	/**
+	 * Newton iterations for the estimate with the hypothetical answer, starting from start; converged is false
+	 * if they stopped at the iteration limit instead. NAN when theta becomes too extreme to evaluate.
+	 */
+	double newtonTheta(Prior &prior, size_t question, int answer, double start, bool &converged) const;
 	
 };
\ No newline at end of file
@@ -5,11 +5,11 @@ struct MLWI : public mpl::FunctionCaller<double>
 {
 	using Base = mpl::FunctionCaller<double>;
 
-	MLWI(Estimator& e, double& p):Base{e,p}{}
+	MLWI(const Estimator& e, double& p):Base{e,p}{}
 
-	double operator()(int question)
+	void operator()(const int* questions, size_t n, double* values)
 	{
-		return estimator.lwi(question);
+		estimator.lwi(questions, n, values);
 	}
 };
 
@@ -26,20 +26,21 @@ Selection MLWISelector::selectItem() {
 
 	selection.values.resize(selection.questions.size());
 
-	mpl::ParallelHelper<MLWI> helper(selection.questions, selection.values, estimator, dummy);
+	// Each block of items shares one integral, whose points are evaluated once for all of them
+	mpl::FixedBlockHelper<MLWI> helper(selection.questions, selection.values, integralBlockSize, estimator, dummy);
    	// call parallelFor to do the work
-  	RcppParallel::parallelFor(0, selection.questions.size(), helper);
+  	mpl::parallelFor(0, helper.blocks(), helper);
 
 	auto max_itr = std::max_element(selection.values.begin(), selection.values.end());
 	selection.item = selection.questions.at(std::distance(selection.values.begin(),max_itr));
 
 	selection.question_names.resize(selection.questions.size());
 
-	auto qn_name = [&](int question){return this->questionSet.question_names.at(question);};
+	auto qn_name = [&](int question){return this->questionSet.bank->names.at(question);};
 	std::transform(selection.questions.begin(),selection.questions.end(),selection.question_names.begin(), qn_name);
 
 	return selection;
 }
 
-MLWISelector::MLWISelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel) : Selector(questions, estimation,
-                                                                                                        priorModel) { }
\ No newline at end of file
+MLWISelector::MLWISelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel) : Selector(questions, estimation,
+                                                                                                                    priorModel) { }
\ No newline at end of file
@@ -4,7 +4,7 @@
 class MLWISelector : public Selector {
 
 public:
-	MLWISelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel);
+	MLWISelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel);
 
 	virtual SelectionType getSelectionType() override;
 
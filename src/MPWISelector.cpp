@@ -5,11 +5,11 @@ struct MPWI : public mpl::FunctionCaller<Prior>
 {
 	using Base = mpl::FunctionCaller<Prior>;
 
-	MPWI(Estimator& e, Prior& p):Base{e,p}{}
+	MPWI(const Estimator& e, Prior& p):Base{e,p}{}
 
-	double operator()(int question)
+	void operator()(const int* questions, size_t n, double* values)
 	{
-		return estimator.pwi(question, arg);
+		estimator.pwi(questions, n, arg, values);
 	}
 };
 
@@ -24,20 +24,21 @@ Selection MPWISelector::selectItem() {
 	
 	selection.values.resize(selection.questions.size());
 
-	mpl::ParallelHelper<MPWI> helper(selection.questions, selection.values, estimator, prior);
+	// Each block of items shares one integral, whose points are evaluated once for all of them
+	mpl::FixedBlockHelper<MPWI> helper(selection.questions, selection.values, integralBlockSize, estimator, prior);
    	// call parallelFor to do the work
-  	RcppParallel::parallelFor(0, selection.questions.size(), helper);
+  	mpl::parallelFor(0, helper.blocks(), helper);
 
 	auto max_itr = std::max_element(selection.values.begin(), selection.values.end());
 	selection.item = selection.questions.at(std::distance(selection.values.begin(),max_itr));
 
 	selection.question_names.resize(selection.questions.size());
 
-	auto qn_name = [&](int question){return this->questionSet.question_names.at(question);};
+	auto qn_name = [&](int question){return this->questionSet.bank->names.at(question);};
 	std::transform(selection.questions.begin(),selection.questions.end(),selection.question_names.begin(), qn_name);
 
 	return selection;
 }
 
-MPWISelector::MPWISelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel) : Selector(questions, estimation,
-                                                                                                        priorModel) { }
\ No newline at end of file
+MPWISelector::MPWISelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel) : Selector(questions, estimation,
+                                                                                                                    priorModel) { }
\ No newline at end of file
@@ -4,7 +4,7 @@
 class MPWISelector : public Selector {
 
 public:
-	MPWISelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel);
+	MPWISelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel);
 
 	virtual SelectionType getSelectionType() override;
 
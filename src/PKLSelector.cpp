@@ -1,15 +1,15 @@
 #include "PKLSelector.h"
 #include "ParallelUtil.h"
 
-struct PKL : public mpl::FunctionCaller<Prior>
+struct PKL : public mpl::FunctionCaller<SelectionContext>
 {
-	using Base = mpl::FunctionCaller<Prior>;
+	using Base = mpl::FunctionCaller<SelectionContext>;
 
-	PKL(Estimator& e, Prior& p):Base{e,p}{}
+	PKL(const Estimator& e, SelectionContext& c):Base{e,c}{}
 
-	double operator()(int question)
+	void operator()(const int* questions, size_t n, double* values)
 	{
-		return estimator.posteriorKL(question, arg);
+		estimator.posteriorKL(questions, n, arg, values);
 	}
 };
 
@@ -25,20 +25,23 @@ Selection PKLSelector::selectItem() {
 	
 	selection.values.resize(selection.questions.size());
 
-	mpl::ParallelHelper<PKL> helper(selection.questions, selection.values, estimator, prior);
+	SelectionContext context = estimator.selectionContext(prior);
+
+	// Each block of items shares one integral, whose points are evaluated once for all of them
+	mpl::FixedBlockHelper<PKL> helper(selection.questions, selection.values, integralBlockSize, estimator, context);
    	// call parallelFor to do the work
-  	RcppParallel::parallelFor(0, selection.questions.size(), helper);
+  	mpl::parallelFor(0, helper.blocks(), helper);
 
 	auto max_itr = std::max_element(selection.values.begin(), selection.values.end());
 	selection.item = selection.questions.at(std::distance(selection.values.begin(),max_itr));
 
 	selection.question_names.resize(selection.questions.size());
 
-	auto qn_name = [&](int question){return this->questionSet.question_names.at(question);};
+	auto qn_name = [&](int question){return this->questionSet.bank->names.at(question);};
 	std::transform(selection.questions.begin(),selection.questions.end(),selection.question_names.begin(), qn_name);
 
 	return selection;
 }
 
-PKLSelector::PKLSelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel) : Selector(questions, estimation,
-                                                                                                        priorModel) { }
\ No newline at end of file
+PKLSelector::PKLSelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel) : Selector(questions, estimation,
+                                                                                                                  priorModel) { }
\ No newline at end of file
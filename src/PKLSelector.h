@@ -4,7 +4,7 @@
 class PKLSelector : public Selector {
 
 public:
-	PKLSelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel);
+	PKLSelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel);
 
 	virtual SelectionType getSelectionType() override;
 
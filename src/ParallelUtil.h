@@ -2,19 +2,84 @@
 #include "Estimator.h"
 
 #include <RcppParallel.h>
+#include <atomic>
+#include <exception>
 
 
 //using namespace RcppParallel;
 
 namespace mpl
 {
+	/**
+	 * Set on threads that are already running one unit of an outer parallel loop (e.g. one respondent in
+	 * simulateThetas); item loops started from such a thread then run serially instead of starting another
+	 * parallelFor for every selection step.
+	 */
+	inline bool& inParallelRegion()
+	{
+		static thread_local bool flag = false;
+		return flag;
+	}
+
+	struct ParallelRegion
+	{
+		bool previous;
+		ParallelRegion() : previous(inParallelRegion()) { inParallelRegion() = true; }
+		~ParallelRegion() { inParallelRegion() = previous; }
+	};
+
+	/**
+	 * The flag that cancels the selection running on this thread, or null if it cannot be cancelled. The item
+	 * loop helpers below read it when they are created and stop taking items once it is set, and parallelFor
+	 * then throws Cancelled, so an abandoned speculation stops within an item (or a block of items).
+	 */
+	inline const std::atomic<bool>*& cancellation()
+	{
+		static thread_local const std::atomic<bool>* flag = nullptr;
+		return flag;
+	}
+
+	inline bool isCancelled(const std::atomic<bool>* flag)
+	{
+		return flag != nullptr && flag->load(std::memory_order_relaxed);
+	}
+
+	struct CancellationScope
+	{
+		const std::atomic<bool>* previous;
+		explicit CancellationScope(const std::atomic<bool>* flag) : previous(cancellation()) { cancellation() = flag; }
+		~CancellationScope() { cancellation() = previous; }
+	};
+
+	struct Cancelled : public std::exception
+	{
+		const char* what() const noexcept override { return "the selection was cancelled"; }
+	};
+
+	template<typename Worker>
+	void parallelFor(std::size_t begin, std::size_t end, Worker& worker)
+	{
+		if (inParallelRegion())
+		{
+			worker(begin, end);
+		}
+		else
+		{
+			RcppParallel::parallelFor(begin, end, worker);
+		}
+		if (isCancelled(cancellation()))
+		{
+			throw Cancelled();
+		}
+	}
+
 	template<typename Arg>
 	struct FunctionCaller
 	{
-		Estimator &estimator;
+		const Estimator &estimator;
 		Arg &arg;
 
-		FunctionCaller(Estimator& e, Arg& a)
+		FunctionCaller(const Estimator& e, Arg& a)
 		: estimator(e)
 		, arg(a)
 		{}
@@ -28,19 +93,93 @@ namespace mpl
 	   const std::vector<int>& input; // source vector
 	   std::vector<double>& output; // destination vector
 	   Function f;
+	   const std::atomic<bool>* cancelled;
 	   
 	   // initialize with source and destination
 	   template<typename T1, typename T2, typename Arg>
-	   ParallelHelper(const T1& input, T2& output, Estimator& e, Arg& a) 
+	   ParallelHelper(const T1& input, T2& output, const Estimator& e, Arg& a) 
 	      : input(input)
 	      , output(output)
 	      , f{e,a}
+	      , cancelled(cancellation())
 	      {}
 	   
 	   // take the range of elements requested
 	   void operator()(std::size_t begin, std::size_t end)
 	   {
-	      std::transform(input.begin() + begin, input.begin() + end, output.begin() + begin, f);
+	      Function function = f;
+	      for (std::size_t i = begin; i < end && !isCancelled(cancelled); ++i)
+	      {
+	         output[i] = function(input[i]);
+	      }
+	   }
+	};
+
+	/**
+	 * Like ParallelHelper, but Function is handed each worker's whole range at once, as
+	 * f(const int* questions, size_t n, double* values), so it can use the batch kernels.
+	 */
+	template<typename Function>
+	struct ParallelBlockHelper : public RcppParallel::Worker
+	{
+	   const std::vector<int>& input; // source vector
+	   std::vector<double>& output; // destination vector
+	   Function f;
+	   const std::atomic<bool>* cancelled;
+
+	   template<typename T1, typename T2, typename Arg>
+	   ParallelBlockHelper(const T1& input, T2& output, const Estimator& e, Arg& a)
+	      : input(input)
+	      , output(output)
+	      , f{e,a}
+	      , cancelled(cancellation())
+	      {}
+
+	   void operator()(std::size_t begin, std::size_t end)
+	   {
+	      if (!isCancelled(cancelled))
+	      {
+	         f(input.data() + begin, end - begin, output.data() + begin);
+	      }
+	   }
+	};
+
+	/**
+	 * Like ParallelBlockHelper, but the questions are cut into blocks of a fixed size and the loop runs over the
+	 * blocks, so the questions Function is handed together, and so its results, do not depend on how the loop
+	 * is split between threads. Call parallelFor(0, helper.blocks(), helper).
+	 */
+	template<typename Function>
+	struct FixedBlockHelper : public RcppParallel::Worker
+	{
+	   const std::vector<int>& input; // source vector
+	   std::vector<double>& output; // destination vector
+	   std::size_t block_size;
+	   Function f;
+	   const std::atomic<bool>* cancelled;
+
+	   template<typename T1, typename T2, typename Arg>
+	   FixedBlockHelper(const T1& input, T2& output, std::size_t block_size, const Estimator& e, Arg& a)
+	      : input(input)
+	      , output(output)
+	      , block_size(block_size)
+	      , f{e,a}
+	      , cancelled(cancellation())
+	      {}
+
+	   std::size_t blocks() const
+	   {
+	      return (input.size() + block_size - 1) / block_size;
+	   }
+
+	   void operator()(std::size_t begin, std::size_t end)
+	   {
+	      for (std::size_t block = begin; block < end && !isCancelled(cancelled); ++block)
+	      {
+	         const std::size_t first = block * block_size;
+	         const std::size_t n = std::min(block_size, input.size() - first);
+	         f(input.data() + first, n, output.data() + first);
+	      }
 	   }
 	};
-}
\ No newline at end of file
+}
@@ -26,14 +26,17 @@ void Prior::set_pdf_function(const std::string& name)
   if(name == "STUDENT_T")
   {
     pdf_ptr = &Prior::dt;
+    prior_type = PriorType::STUDENT_T;
   }
   else if (name == "UNIFORM")
   {
     pdf_ptr = &Prior::uniform;
+    prior_type = PriorType::UNIFORM;
   }
   else if (name == "NORMAL")
   {
     pdf_ptr = &Prior::normal;
+    prior_type = PriorType::NORMAL;
   }
   else
   {  
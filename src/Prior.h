@@ -4,6 +4,10 @@
 #include <Rcpp.h>
 #include <array>
 
+enum class PriorType {
+  NORMAL, STUDENT_T, UNIFORM
+};
+
 /**
   * Represents the prior model used in other calculations.
   */
@@ -18,7 +22,7 @@ private:
   typedef double (Prior::*pdf_ptr_t)(double,double,double) const;
   pdf_ptr_t pdf_ptr;
 
-  //std::string name; //If at all needed, use enum/int representing the name
+  PriorType prior_type;
   std::array<double, 2> parameters;
 
 public:
@@ -30,6 +34,10 @@ public:
   {
     return parameters[1];
   }
+  PriorType type() const
+  {
+    return prior_type;
+  }
   double prior(double x) const;
   
   Prior(Rcpp::S4 cat_df);
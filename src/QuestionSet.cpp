@@ -2,36 +2,48 @@
 
 QuestionSet::QuestionSet(Rcpp::S4 &cat_df) {
 	answers = Rcpp::as<std::vector<int> >(cat_df.slot("answers"));
-	guessing = Rcpp::as<std::vector<double> >(cat_df.slot("guessing"));
-	discrimination = Rcpp::as<std::vector<double> >(cat_df.slot("discrimination"));
-	z = Rcpp::as<std::vector<double> >(cat_df.slot("z"));
-	
-	lowerBound = Rcpp::as<double >(cat_df.slot("lowerBound"));
-	upperBound = Rcpp::as<double >(cat_df.slot("upperBound"));
-	
-	Rcpp::NumericVector discrim_names = cat_df.slot("discrimination");
-  	Rcpp::CharacterVector names = discrim_names.names();
-  	question_names = Rcpp::as<std::vector<std::string> >(names);
-
-  	model = Rcpp::as<std::string >(cat_df.slot("model"));
-
 
+	std::vector<std::vector<double> > difficulty;
 	for (auto item : (Rcpp::List) cat_df.slot("difficulty")) {
 		difficulty.push_back(Rcpp::as<std::vector<double> >(item));
 	}
+	ItemBank items(difficulty, Rcpp::as<std::vector<double> >(cat_df.slot("discrimination")),
+	               Rcpp::as<std::vector<double> >(cat_df.slot("guessing")));
+
+	items.z = Rcpp::as<std::vector<double> >(cat_df.slot("z"));
+	items.lowerBound = Rcpp::as<double >(cat_df.slot("lowerBound"));
+	items.upperBound = Rcpp::as<double >(cat_df.slot("upperBound"));
+
+	Rcpp::NumericVector discrim_names = cat_df.slot("discrimination");
+	Rcpp::CharacterVector names = discrim_names.names();
+	items.names = Rcpp::as<std::vector<std::string> >(names);
+
+	std::string model = Rcpp::as<std::string >(cat_df.slot("model"));
+	if (model == "ltm") {
+		items.model_type = ModelType::LTM;
+	}
+	else if (model == "tpm") {
+		items.model_type = ModelType::TPM;
+	}
+	else if (model == "grm") {
+		items.model_type = ModelType::GRM;
+	}
+	else if (model == "gpcm") {
+		items.model_type = ModelType::GPCM;
+	}
+	else {
+		throw std::domain_error("model must be one of ltm, tpm, grm, or gpcm.");
+	}
+
+	bank = ItemBank::intern(std::move(items));
 
-	
 	reset_applicables();
 	reset_all_extreme();
 }
 
-void QuestionSet::reset_answers(Rcpp::DataFrame& responses, size_t row)
+void QuestionSet::reset_answers(const ResponseMatrix& responses, size_t row)
 {
-	for(size_t i = 0; i < answers.size(); ++i)
-	{
-		Rcpp::IntegerVector col = responses[i]; 
-		answers[i] = col[row];
-	}
+	responses.copy_row(row, answers.data());
 	
 	reset_applicables();
 	reset_all_extreme();
@@ -159,14 +171,14 @@ void QuestionSet::reset_all_extreme()
 	bool maxAnswer_negDiscrim = false;
 	bool ans_not_extreme = false;
 	
-	int max_response = ((model == "ltm") | (model == "tpm")) ? 1.0 : difficulty[1].size() + 1.0;
-	int min_response = ((model == "ltm") | (model == "tpm")) ? 0.0 : 1.0;
+	int max_response = isBinary(bank->model_type) ? 1.0 : bank->threshold_count(1) + 1.0;
+	int min_response = isBinary(bank->model_type) ? 0.0 : 1.0;
 
 	for (auto i : applicable_rows) {
-	  	if (discrimination.at(i) < 0.0 and answers.at(i) == min_response) minAnswer_negDiscrim = true;
-	  	else if (discrimination.at(i) < 0.0 and answers.at(i) == max_response) maxAnswer_negDiscrim = true;
-	  	else if (discrimination.at(i) > 0.0 and answers.at(i) == min_response) minAnswer_posDiscrim = true;
-	  	else if (discrimination.at(i) > 0.0 and answers.at(i) == max_response) maxAnswer_posDiscrim = true;
+	  	if (bank->discrimination[i] < 0.0 and answers.at(i) == min_response) minAnswer_negDiscrim = true;
+	  	else if (bank->discrimination[i] < 0.0 and answers.at(i) == max_response) maxAnswer_negDiscrim = true;
+	  	else if (bank->discrimination[i] > 0.0 and answers.at(i) == min_response) minAnswer_posDiscrim = true;
+	  	else if (bank->discrimination[i] > 0.0 and answers.at(i) == max_response) maxAnswer_posDiscrim = true;
 	  	else
 	  	{
 	  		ans_not_extreme = true;
@@ -1,40 +1,35 @@
 #pragma once
 #include <Rcpp.h>
+#include <memory>
 #include <vector>
+#include "ItemBank.h"
+#include "ItemModels.h"
+#include "ResponseMatrix.h"
 
 /**
- * Contains the various lists of values necessary for a Cat.
+ * The answers of one respondent, and the items they refer to. The items are an immutable ItemBank shared with
+ * every copy of the QuestionSet (and other Cats with the same items), so a copy only duplicates the answers and
+ * the lists derived from them.
  */
 struct QuestionSet {
-  std::vector<std::string> question_names;
-	std::vector<std::vector<double> > difficulty;
+	std::shared_ptr<const ItemBank> bank;
 
 	std::vector<int> applicable_rows;
 	std::vector<int> nonapplicable_rows;
 	std::vector<int> skipped;
 	
-	std::vector<double> guessing;
-	std::vector<double> discrimination;
-	std::vector<double> z;
-	
 	/**
 	 * The user's answer to each question.
 	 */
 	std::vector<int> answers;
-	std::string model;
 	/**
 	 * Keeping track of extreme answers for MLEEstimator.
 	 */	
 	bool all_extreme;
-	/**
-	 * Bounds for integration.
-	 */		
-	double lowerBound;
-	double upperBound;
 
 	QuestionSet(Rcpp::S4 &cat_df);
 
-	void reset_answers(Rcpp::DataFrame& responses, size_t row);
+	void reset_answers(const ResponseMatrix& responses, size_t row);
 	void reset_answer(size_t question, int answer);
 	void reset_answers(std::vector<int> const& source);
 private:
@@ -13,7 +13,7 @@ Selection RANDOMSelector::selectItem() {
 	selection.question_names.reserve(questionSet.nonapplicable_rows.size());
 	
 	for (int item : questionSet.nonapplicable_rows) {
-	  selection.question_names.push_back(questionSet.question_names.at(item));
+	  selection.question_names.push_back(questionSet.bank->names.at(item));
 	  item = 0;
 		selection.values.push_back(item);
 	}
@@ -24,5 +24,5 @@ Selection RANDOMSelector::selectItem() {
 	return selection;
 }
 
-RANDOMSelector::RANDOMSelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel) : Selector(questions, estimation,
-                                                                                                        priorModel) { }
\ No newline at end of file
+RANDOMSelector::RANDOMSelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel) : Selector(questions, estimation,
+                                                                                                                        priorModel) { }
\ No newline at end of file
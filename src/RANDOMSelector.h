@@ -4,7 +4,7 @@
 class RANDOMSelector : public Selector {
 
 public:
-	RANDOMSelector(QuestionSet &questions, Estimator &estimation, Prior &priorModel);
+	RANDOMSelector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel);
 
 	virtual SelectionType getSelectionType() override;
 
@@ -83,14 +83,15 @@ BEGIN_RCPP
 END_RCPP
 }
 // estimateThetas
-NumericVector estimateThetas(S4 catObj, DataFrame responses);
-RcppExport SEXP catSurv_estimateThetas(SEXP catObjSEXP, SEXP responsesSEXP) {
+NumericVector estimateThetas(S4 catObj, DataFrame responses, List control);
+RcppExport SEXP catSurv_estimateThetas(SEXP catObjSEXP, SEXP responsesSEXP, SEXP controlSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< S4 >::type catObj(catObjSEXP);
     Rcpp::traits::input_parameter< DataFrame >::type responses(responsesSEXP);
-    rcpp_result_gen = Rcpp::wrap(estimateThetas(catObj, responses));
+    Rcpp::traits::input_parameter< List >::type control(controlSEXP);
+    rcpp_result_gen = Rcpp::wrap(estimateThetas(catObj, responses, control));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -108,6 +109,53 @@ BEGIN_RCPP
 END_RCPP
 }
 
+// makeTree
+SEXP makeTree(S4 catObj, bool flat);
+RcppExport SEXP catSurv_makeTree(SEXP catObjSEXP, SEXP flatSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< S4 >::type catObj(catObjSEXP);
+    Rcpp::traits::input_parameter< bool >::type flat(flatSEXP);
+    rcpp_result_gen = Rcpp::wrap(makeTree(catObj, flat));
+    return rcpp_result_gen;
+END_RCPP
+}
+// writeTree
+void writeTree(S4 catObj, std::string file, bool estimates);
+RcppExport SEXP catSurv_writeTree(SEXP catObjSEXP, SEXP fileSEXP, SEXP estimatesSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< S4 >::type catObj(catObjSEXP);
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< bool >::type estimates(estimatesSEXP);
+    writeTree(catObj, file, estimates);
+    return R_NilValue;
+END_RCPP
+}
+// readTree
+SEXP readTree(std::string file);
+RcppExport SEXP catSurv_readTree(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(readTree(file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// treeSelectItem
+List treeSelectItem(SEXP tree, IntegerVector answers);
+RcppExport SEXP catSurv_treeSelectItem(SEXP treeSEXP, SEXP answersSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type tree(treeSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type answers(answersSEXP);
+    rcpp_result_gen = Rcpp::wrap(treeSelectItem(tree, answers));
+    return rcpp_result_gen;
+END_RCPP
+}
 // obsInf
 double obsInf(S4 catObj, double theta, int item);
 RcppExport SEXP catSurv_obsInf(SEXP catObjSEXP, SEXP thetaSEXP, SEXP itemSEXP) {
@@ -250,3 +298,158 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// catSession
+SEXP catSession(S4 catObj, List control);
+RcppExport SEXP catSurv_catSession(SEXP catObjSEXP, SEXP controlSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< S4 >::type catObj(catObjSEXP);
+    Rcpp::traits::input_parameter< List >::type control(controlSEXP);
+    rcpp_result_gen = Rcpp::wrap(catSession(catObj, control));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sessionStoreAnswer
+void sessionStoreAnswer(SEXP session, int item, int answer);
+RcppExport SEXP catSurv_sessionStoreAnswer(SEXP sessionSEXP, SEXP itemSEXP, SEXP answerSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< int >::type item(itemSEXP);
+    Rcpp::traits::input_parameter< int >::type answer(answerSEXP);
+    sessionStoreAnswer(session, item, answer);
+    return R_NilValue;
+END_RCPP
+}
+// sessionSelectItem
+List sessionSelectItem(SEXP session);
+RcppExport SEXP catSurv_sessionSelectItem(SEXP sessionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    rcpp_result_gen = Rcpp::wrap(sessionSelectItem(session));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sessionEstimateTheta
+double sessionEstimateTheta(SEXP session);
+RcppExport SEXP catSurv_sessionEstimateTheta(SEXP sessionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    rcpp_result_gen = Rcpp::wrap(sessionEstimateTheta(session));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sessionEstimateSE
+double sessionEstimateSE(SEXP session);
+RcppExport SEXP catSurv_sessionEstimateSE(SEXP sessionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    rcpp_result_gen = Rcpp::wrap(sessionEstimateSE(session));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sessionCheckStopRules
+bool sessionCheckStopRules(SEXP session);
+RcppExport SEXP catSurv_sessionCheckStopRules(SEXP sessionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    rcpp_result_gen = Rcpp::wrap(sessionCheckStopRules(session));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sessionSaveCache
+void sessionSaveCache(SEXP session, std::string file);
+RcppExport SEXP catSurv_sessionSaveCache(SEXP sessionSEXP, SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    sessionSaveCache(session, file);
+    return R_NilValue;
+END_RCPP
+}
+// sessionLoadCache
+void sessionLoadCache(SEXP session, std::string file);
+RcppExport SEXP catSurv_sessionLoadCache(SEXP sessionSEXP, SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    sessionLoadCache(session, file);
+    return R_NilValue;
+END_RCPP
+}
+// sessionScreenDiagnostics
+List sessionScreenDiagnostics(SEXP session);
+RcppExport SEXP catSurv_sessionScreenDiagnostics(SEXP sessionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    rcpp_result_gen = Rcpp::wrap(sessionScreenDiagnostics(session));
+    return rcpp_result_gen;
+END_RCPP
+}
+// scratchAllocations
+double scratchAllocations();
+RcppExport SEXP catSurv_scratchAllocations() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(scratchAllocations());
+    return rcpp_result_gen;
+END_RCPP
+}
+// integrationWorkspaces
+double integrationWorkspaces();
+RcppExport SEXP catSurv_integrationWorkspaces() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(integrationWorkspaces());
+    return rcpp_result_gen;
+END_RCPP
+}
+// vectorExp
+std::vector<double> vectorExp(std::vector<double> x);
+RcppExport SEXP catSurv_vectorExp(SEXP xSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::vector<double> >::type x(xSEXP);
+    rcpp_result_gen = Rcpp::wrap(vectorExp(x));
+    return rcpp_result_gen;
+END_RCPP
+}
+// vectorLog
+std::vector<double> vectorLog(std::vector<double> x);
+RcppExport SEXP catSurv_vectorLog(SEXP xSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::vector<double> >::type x(xSEXP);
+    rcpp_result_gen = Rcpp::wrap(vectorLog(x));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sameItemBank
+bool sameItemBank(S4 first, S4 second);
+RcppExport SEXP catSurv_sameItemBank(SEXP firstSEXP, SEXP secondSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< S4 >::type first(firstSEXP);
+    Rcpp::traits::input_parameter< S4 >::type second(secondSEXP);
+    rcpp_result_gen = Rcpp::wrap(sameItemBank(first, second));
+    return rcpp_result_gen;
+END_RCPP
+}
@@ -0,0 +1,52 @@
+#include "ResponseMatrix.h"
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+
+ResponseMatrix::ResponseMatrix(Rcpp::DataFrame &responses, std::size_t items)
+		: row_count(responses.nrow()), column_count(items), codes(row_count * items) {
+	if ((std::size_t) responses.ncol() < items) {
+		throw std::domain_error("number of questions doesnt match with catObj");
+	}
+
+	for (std::size_t column = 0; column < column_count; ++column) {
+		Rcpp::IntegerVector values = responses[column];
+		for (std::size_t row = 0; row < row_count; ++row) {
+			int answer = values[row];
+			if (answer == NA_INTEGER) {
+				codes[row * column_count + column] = naCode;
+			}
+			else if (answer < -1 || answer > INT8_MAX) {
+				throw std::domain_error("responses must be NA or integers between -1 and 127.");
+			}
+			else {
+				codes[row * column_count + column] = (std::int8_t) answer;
+			}
+		}
+	}
+}
+
+void ResponseMatrix::copy_row(std::size_t row, int *out) const {
+	const std::int8_t *codes_row = codes.data() + row * column_count;
+	for (std::size_t column = 0; column < column_count; ++column) {
+		out[column] = codes_row[column] == naCode ? NA_INTEGER : codes_row[column];
+	}
+}
+
+std::vector<std::size_t> ResponseMatrix::distinct_rows(std::vector<std::size_t> &pattern) const {
+	std::vector<std::size_t> first_rows;
+	std::unordered_map<std::string, std::size_t> patterns;
+	patterns.reserve(row_count);
+	pattern.resize(row_count);
+
+	for (std::size_t row = 0; row < row_count; ++row) {
+		const char *codes_row = reinterpret_cast<const char *>(codes.data() + row * column_count);
+		auto inserted = patterns.insert(std::make_pair(std::string(codes_row, column_count), first_rows.size()));
+		if (inserted.second) {
+			first_rows.push_back(row);
+		}
+		pattern[row] = inserted.first->second;
+	}
+	return first_rows;
+}
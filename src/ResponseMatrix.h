@@ -0,0 +1,58 @@
+#pragma once
+#include <Rcpp.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * Respondents' answers in row-major form, one byte per answer, so that a respondent's answers are contiguous
+ * and can be read without going through R. Answers are stored as they are in QuestionSet::answers (-1 for a
+ * skipped item), except that NA is stored as naCode.
+ *
+ * The data frame is read once on construction; afterwards the matrix does not touch R objects and can be
+ * read from worker threads.
+ */
+class ResponseMatrix {
+public:
+	static const std::int8_t naCode = INT8_MIN;
+
+	/**
+	 * Reads the first items columns of responses, each converted as an integer vector. Throws if an answer
+	 * is not NA and lies outside [-1, 127].
+	 */
+	ResponseMatrix(Rcpp::DataFrame &responses, std::size_t items);
+
+	std::size_t rows() const {
+		return row_count;
+	}
+
+	std::size_t columns() const {
+		return column_count;
+	}
+
+	/**
+	 * The answer of respondent row to item column, with NA as NA_INTEGER.
+	 */
+	int at(std::size_t row, std::size_t column) const {
+		std::int8_t code = codes[row * column_count + column];
+		return code == naCode ? NA_INTEGER : code;
+	}
+
+	/**
+	 * Writes respondent row's answers to out, which must hold columns() values.
+	 */
+	void copy_row(std::size_t row, int *out) const;
+
+	/**
+	 * Groups respondents with identical answers, hashing each row's packed answers. Returns the first row
+	 * of every distinct answer pattern, in order of appearance, and sets pattern[row] to the index of that
+	 * row's pattern in the result.
+	 */
+	std::vector<std::size_t> distinct_rows(std::vector<std::size_t> &pattern) const;
+
+private:
+	std::size_t row_count;
+	std::size_t column_count;
+	std::vector<std::int8_t> codes;
+};
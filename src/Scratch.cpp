@@ -0,0 +1,65 @@
+#include "Scratch.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+
+namespace {
+
+/**
+ * Blocks of doubles handed out from the front; the buffers in use are the ones before (block, used).
+ */
+struct Arena {
+	std::vector<std::unique_ptr<double[]> > blocks;
+	std::vector<std::size_t> sizes;
+	std::size_t block = 0;
+	std::size_t used = 0;
+};
+
+const std::size_t minimumBlockSize = 1024;
+
+std::atomic<std::size_t> arenaAllocations(0);
+
+Arena &threadArena() {
+	static thread_local Arena arena;
+	return arena;
+}
+
+}
+
+ScratchBuffer::ScratchBuffer(std::size_t n) {
+	Arena &arena = threadArena();
+	block = arena.block;
+	used = arena.used;
+
+	if (arena.blocks.empty() || arena.used + n > arena.sizes[arena.block]) {
+		// Blocks after the current one are unused, so one too small for n is replaced
+		std::size_t next = arena.blocks.empty() ? 0 : arena.block + 1;
+		if (next == arena.blocks.size() || arena.sizes[next] < n) {
+			std::size_t size = std::max(n, minimumBlockSize);
+			if (next == arena.blocks.size()) {
+				arena.blocks.emplace_back();
+				arena.sizes.push_back(0);
+			}
+			arena.blocks[next].reset(new double[size]);
+			arena.sizes[next] = size;
+			arenaAllocations.fetch_add(1, std::memory_order_relaxed);
+		}
+		arena.block = next;
+		arena.used = 0;
+	}
+
+	values = arena.blocks[arena.block].get() + arena.used;
+	arena.used += n;
+}
+
+ScratchBuffer::~ScratchBuffer() {
+	Arena &arena = threadArena();
+	arena.block = block;
+	arena.used = used;
+}
+
+std::size_t ScratchBuffer::allocations() {
+	return arenaAllocations.load(std::memory_order_relaxed);
+}
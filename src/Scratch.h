@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+
+
+/**
+ * Temporary doubles taken from a per-thread arena, for kernels that need a few values per response category of
+ * an item (see ItemModels.h). Buffers are released in the reverse order they were taken, which scoping them as
+ * locals guarantees, and the arena keeps its memory for the life of the thread, so once a thread has evaluated
+ * an item of the largest size it sees, taking a buffer is a pointer bump and nothing is allocated.
+ *
+ * allocations() counts the times any thread's arena had to grow. It is a profiling aid: it stays the same
+ * across repeated selectItem calls, whose integrands then run without touching the heap.
+ */
+class ScratchBuffer {
+public:
+	explicit ScratchBuffer(std::size_t n);
+	~ScratchBuffer();
+
+	ScratchBuffer(const ScratchBuffer &) = delete;
+	ScratchBuffer &operator=(const ScratchBuffer &) = delete;
+
+	double *data() {
+		return values;
+	}
+
+	double &operator[](std::size_t i) {
+		return values[i];
+	}
+
+	static std::size_t allocations();
+
+private:
+	double *values;
+	std::size_t block;
+	std::size_t used;
+};
@@ -0,0 +1,376 @@
+#include "SelectionCache.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include "SharedRegistry.h"
+
+
+namespace {
+
+const char cacheMagic[8] = {'c', 'a', 't', 'C', 'a', 'c', 'h', 'e'};
+const std::uint32_t byteOrderMark = 0x01020304;
+
+const std::uint32_t hasSelectionFlag = 1;
+const std::uint32_t hasThetaFlag = 2;
+const std::uint32_t hasSEFlag = 4;
+
+struct Header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byte_order;
+	std::uint64_t fingerprint;
+	std::uint64_t node_count;
+};
+
+/**
+ * A node as read from a file, before it is added to the trie.
+ */
+struct Record {
+	std::int32_t parent;
+	std::pair<int, int> key;
+	std::uint32_t flags;
+	double theta;
+	double se;
+	Selection selection;
+};
+
+template <typename T>
+void writeValue(std::ofstream &out, const T &value) {
+	out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+void readValues(std::ifstream &in, T *values, std::size_t count, const std::string &file) {
+	in.read(reinterpret_cast<char *>(values), count * sizeof(T));
+	if (!in) {
+		throw std::domain_error(file + " is truncated.");
+	}
+}
+
+/**
+ * Throws unless the file holds at least count more values of type T, so a corrupt count cannot make load
+ * allocate more than the file could fill.
+ */
+template <typename T>
+void checkRemaining(std::ifstream &in, std::streamoff file_size, std::size_t count, const std::string &file) {
+	const std::streamoff position = in.tellg();
+	if (position < 0 || std::uint64_t(file_size - position) / sizeof(T) < count) {
+		throw std::domain_error(file + " is truncated.");
+	}
+}
+
+template <typename T>
+T readValue(std::ifstream &in, const std::string &file) {
+	T value;
+	readValues(in, &value, 1, file);
+	return value;
+}
+
+}
+
+void SelectionCache::Fingerprint::add(const void *data, std::size_t size) {
+	// FNV-1a
+	const unsigned char *bytes = static_cast<const unsigned char *>(data);
+	for (std::size_t i = 0; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+}
+
+void SelectionCache::Fingerprint::add(const std::string &value) {
+	add(value.size());
+	add(value.data(), value.size());
+}
+
+SelectionCache::SelectionCache(std::uint64_t fingerprint, std::size_t capacity) : config(fingerprint),
+                                                                                  max_nodes(capacity) {
+	root.parent = nullptr;
+	root.has_theta = false;
+	root.has_se = false;
+}
+
+std::shared_ptr<SelectionCache> SelectionCache::shared(std::uint64_t fingerprint, std::size_t capacity) {
+	static SharedRegistry<std::pair<std::uint64_t, std::size_t>, SelectionCache> registry;
+
+	return registry.get(std::make_pair(fingerprint, capacity), [&]() {
+		return std::make_shared<SelectionCache>(fingerprint, capacity);
+	});
+}
+
+bool SelectionCache::findSelection(const Path &path, Selection &selection) {
+	std::lock_guard<std::mutex> lock(mutex);
+	Node *node = find(path, false);
+	if (node == nullptr || !node->selection) {
+		return false;
+	}
+	selection = *node->selection;
+	return true;
+}
+
+void SelectionCache::storeSelection(const Path &path, const Selection &selection) {
+	std::unique_ptr<Selection> stored(new Selection());
+	stored->questions = selection.questions;
+	stored->values = selection.values;
+	stored->name = selection.name;
+	stored->item = selection.item;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	Node *node = find(path, true);
+	if (node != nullptr) {
+		node->selection = std::move(stored);
+	}
+}
+
+bool SelectionCache::findEstimate(const Path &path, Estimate estimate, double &value) {
+	std::lock_guard<std::mutex> lock(mutex);
+	Node *node = find(path, false);
+	if (node == nullptr || !(estimate == Estimate::THETA ? node->has_theta : node->has_se)) {
+		return false;
+	}
+	value = estimate == Estimate::THETA ? node->theta : node->se;
+	return true;
+}
+
+void SelectionCache::storeEstimate(const Path &path, Estimate estimate, double value) {
+	std::lock_guard<std::mutex> lock(mutex);
+	Node *node = find(path, true);
+	if (node == nullptr) {
+		return;
+	}
+	if (estimate == Estimate::THETA) {
+		node->theta = value;
+		node->has_theta = true;
+	}
+	else {
+		node->se = value;
+		node->has_se = true;
+	}
+}
+
+std::size_t SelectionCache::size() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return recent.size();
+}
+
+std::uint64_t SelectionCache::childKey(const std::pair<int, int> &key) {
+	return (std::uint64_t(std::uint32_t(key.first)) << 32) | std::uint32_t(key.second);
+}
+
+SelectionCache::Node *SelectionCache::find(const Path &path, bool create) {
+	std::vector<Node *> visited;
+	visited.reserve(path.size());
+
+	Node *node = &root;
+	for (const std::pair<int, int> &key : path) {
+		auto child = node->children.find(childKey(key));
+		if (child != node->children.end()) {
+			node = child->second.get();
+		}
+		else if (create && path.size() <= max_nodes) {
+			node = addChild(node, key, true);
+		}
+		else {
+			node = nullptr;
+			break;
+		}
+		visited.push_back(node);
+	}
+
+	for (auto used = visited.rbegin(); used != visited.rend(); ++used) {
+		touch(*used);
+	}
+	while (recent.size() > max_nodes) {
+		evict();
+	}
+	return node;
+}
+
+SelectionCache::Node *SelectionCache::addChild(Node *parent, const std::pair<int, int> &key, bool most_recent) {
+	std::unique_ptr<Node> child(new Node());
+	child->parent = parent;
+	child->key = key;
+	child->has_theta = false;
+	child->has_se = false;
+	child->position = recent.insert(most_recent ? recent.begin() : recent.end(), child.get());
+
+	Node *added = child.get();
+	parent->children[childKey(key)] = std::move(child);
+	return added;
+}
+
+void SelectionCache::touch(Node *node) {
+	recent.splice(recent.begin(), recent, node->position);
+}
+
+void SelectionCache::evict() {
+	// The least recently used node is a leaf, since using a node also uses its ancestors afterwards
+	Node *node = recent.back();
+	recent.pop_back();
+	node->parent->children.erase(childKey(node->key));
+}
+
+void SelectionCache::save(const std::string &file) const {
+	std::ofstream out(file.c_str(), std::ios::binary | std::ios::trunc);
+	if (!out) {
+		throw std::runtime_error("could not open " + file + " for writing.");
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = version;
+	header.byte_order = byteOrderMark;
+	header.fingerprint = config;
+	header.node_count = recent.size() + 1;
+	writeValue(out, header);
+
+	// Parents are used more recently than their children, so each parent is written first
+	std::unordered_map<const Node *, std::int32_t> indices;
+	std::vector<const Node *> nodes(1, &root);
+	nodes.insert(nodes.end(), recent.begin(), recent.end());
+
+	for (const Node *node : nodes) {
+		std::uint32_t flags = (node->selection ? hasSelectionFlag : 0) | (node->has_theta ? hasThetaFlag : 0) |
+		                      (node->has_se ? hasSEFlag : 0);
+		writeValue(out, std::int32_t(node->parent ? indices[node->parent] : -1));
+		writeValue(out, std::int32_t(node->key.first));
+		writeValue(out, std::int32_t(node->key.second));
+		writeValue(out, flags);
+		if (node->has_theta) {
+			writeValue(out, node->theta);
+		}
+		if (node->has_se) {
+			writeValue(out, node->se);
+		}
+		if (node->selection) {
+			const Selection &selection = *node->selection;
+			writeValue(out, std::int32_t(selection.item));
+			writeValue(out, std::uint32_t(selection.name.size()));
+			out.write(selection.name.data(), selection.name.size());
+			writeValue(out, std::uint32_t(selection.questions.size()));
+			out.write(reinterpret_cast<const char *>(selection.questions.data()),
+			          selection.questions.size() * sizeof(int));
+			out.write(reinterpret_cast<const char *>(selection.values.data()),
+			          selection.values.size() * sizeof(double));
+		}
+		const std::int32_t index = std::int32_t(indices.size());
+		indices[node] = index;
+	}
+
+	if (!out) {
+		throw std::runtime_error("could not write " + file + ".");
+	}
+}
+
+void SelectionCache::load(const std::string &file, std::size_t items) {
+	std::ifstream in(file.c_str(), std::ios::binary | std::ios::ate);
+	if (!in) {
+		throw std::runtime_error("could not open " + file + ".");
+	}
+	const std::streamoff file_size = in.tellg();
+	in.seekg(0);
+
+	Header header;
+	in.read(reinterpret_cast<char *>(&header), sizeof(header));
+	if (!in || std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0) {
+		throw std::domain_error(file + " is not a selection cache file.");
+	}
+	if (header.version != version) {
+		throw std::domain_error(file + " has selection cache version " + std::to_string(header.version) +
+		                        ", but this version of catSurv reads version " + std::to_string(version) + ".");
+	}
+	if (header.byte_order != byteOrderMark) {
+		throw std::domain_error(file + " was written on a machine with a different byte order.");
+	}
+	if (header.fingerprint != config) {
+		throw std::domain_error(file + " was saved from a session with a different Cat configuration.");
+	}
+	if (header.node_count == 0 || header.node_count > std::numeric_limits<std::int32_t>::max()) {
+		throw std::domain_error(file + " is corrupt.");
+	}
+	// Every node takes at least its parent, key, and flags
+	checkRemaining<std::int32_t>(in, file_size, 4 * header.node_count, file);
+
+	// Everything is read before the trie is changed, so a bad file leaves the cache as it was
+	std::vector<Record> records;
+	for (std::size_t i = 0; i < header.node_count; ++i) {
+		records.push_back(Record());
+		Record &record = records.back();
+		record.parent = readValue<std::int32_t>(in, file);
+		record.key.first = readValue<std::int32_t>(in, file);
+		record.key.second = readValue<std::int32_t>(in, file);
+		record.flags = readValue<std::uint32_t>(in, file);
+		if ((i == 0) != (record.parent < 0) || record.parent >= std::int32_t(i)) {
+			throw std::domain_error(file + " is corrupt.");
+		}
+		if (record.flags & hasThetaFlag) {
+			record.theta = readValue<double>(in, file);
+		}
+		if (record.flags & hasSEFlag) {
+			record.se = readValue<double>(in, file);
+		}
+		if (record.flags & hasSelectionFlag) {
+			record.selection.item = readValue<std::int32_t>(in, file);
+			const std::uint32_t name_size = readValue<std::uint32_t>(in, file);
+			checkRemaining<char>(in, file_size, name_size, file);
+			record.selection.name.resize(name_size);
+			readValues(in, &record.selection.name[0], name_size, file);
+			const std::uint32_t count = readValue<std::uint32_t>(in, file);
+			checkRemaining<char>(in, file_size, std::size_t(count) * (sizeof(int) + sizeof(double)), file);
+			record.selection.questions.resize(count);
+			record.selection.values.resize(count);
+			readValues(in, record.selection.questions.data(), count, file);
+			readValues(in, record.selection.values.data(), count, file);
+
+			// Sessions look the names of these items up, so they must be items of the bank
+			auto outside = [items](int question) {
+				return question < 0 || std::size_t(question) >= items;
+			};
+			if (outside(record.selection.item) || std::any_of(record.selection.questions.begin(),
+			                                                   record.selection.questions.end(), outside)) {
+				throw std::domain_error(file + " is corrupt.");
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<Node *> nodes(records.size(), nullptr);
+	nodes[0] = &root;
+	for (std::size_t i = 0; i < records.size(); ++i) {
+		const Record &record = records[i];
+		Node *node = nodes[0];
+		if (i > 0) {
+			Node *parent = nodes[record.parent];
+			if (parent == nullptr) {
+				continue;
+			}
+			auto child = parent->children.find(childKey(record.key));
+			if (child != parent->children.end()) {
+				node = child->second.get();
+			}
+			else if (recent.size() < max_nodes) {
+				// Nodes from the file are used less recently than those already in the cache
+				node = addChild(parent, record.key, false);
+			}
+			else {
+				continue;
+			}
+			nodes[i] = node;
+		}
+
+		// Entries already in the cache are kept
+		if ((record.flags & hasSelectionFlag) && !node->selection) {
+			node->selection.reset(new Selection(record.selection));
+		}
+		if ((record.flags & hasThetaFlag) && !node->has_theta) {
+			node->theta = record.theta;
+			node->has_theta = true;
+		}
+		if ((record.flags & hasSEFlag) && !node->has_se) {
+			node->se = record.se;
+			node->has_se = true;
+		}
+	}
+}
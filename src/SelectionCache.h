@@ -0,0 +1,138 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Selection.h"
+
+
+/**
+ * Selections, and optionally theta and SE estimates, shared by every session created from the same Cat
+ * configuration. Entries are kept in a trie keyed by the (item, answer) pairs a session stored since it was
+ * created, so the popular early paths of a test are stored once and found by walking one node per answer.
+ *
+ * The number of nodes is bounded by a capacity; when it is exceeded, the least recently used nodes are
+ * evicted. Every lookup touches the nodes on its path from the deepest one up, so a node is always used more
+ * recently than its descendants and the least recently used node is a leaf.
+ *
+ * All methods are safe to call from several threads.
+ */
+class SelectionCache {
+public:
+	static const std::uint32_t version = 1;
+
+	/**
+	 * The answers stored in a session, in the order they were stored, as (item, answer) pairs.
+	 */
+	typedef std::vector<std::pair<int, int> > Path;
+
+	enum class Estimate {
+		THETA, SE
+	};
+
+	/**
+	 * Builds a fingerprint of everything that determines a selection, so that caches are only shared, and
+	 * files only loaded, between sessions that would select the same items.
+	 */
+	class Fingerprint {
+	public:
+		Fingerprint() : hash(14695981039346656037ULL) {}
+
+		void add(const void *data, std::size_t size);
+		void add(const std::string &value);
+
+		template <typename T>
+		void add(const T &value) {
+			add(&value, sizeof(T));
+		}
+
+		template <typename T, typename A>
+		void add(const std::vector<T, A> &values) {
+			add(values.size());
+			add(values.data(), values.size() * sizeof(T));
+		}
+
+		std::uint64_t value() const {
+			return hash;
+		}
+
+	private:
+		std::uint64_t hash;
+	};
+
+	SelectionCache(std::uint64_t fingerprint, std::size_t capacity);
+
+	SelectionCache(const SelectionCache &) = delete;
+	SelectionCache &operator=(const SelectionCache &) = delete;
+
+	/**
+	 * The cache for fingerprint and capacity that is in use by some session, or a new one holding at most
+	 * capacity nodes. Sessions whose cacheSize differs get caches of their own.
+	 */
+	static std::shared_ptr<SelectionCache> shared(std::uint64_t fingerprint, std::size_t capacity);
+
+	/**
+	 * Copies the selection stored for path into selection and returns true, or returns false if there is
+	 * none. The question names of the selection are not stored and are left empty.
+	 */
+	bool findSelection(const Path &path, Selection &selection);
+	void storeSelection(const Path &path, const Selection &selection);
+
+	bool findEstimate(const Path &path, Estimate estimate, double &value);
+	void storeEstimate(const Path &path, Estimate estimate, double value);
+
+	/**
+	 * Writes every node to file, most recently used first. load adds the nodes of a file written for the
+	 * same fingerprint, while there is room for them, and throws if the fingerprint differs or the file is
+	 * corrupt, including when a selection refers to an item outside [0, items).
+	 */
+	void save(const std::string &file) const;
+	void load(const std::string &file, std::size_t items);
+
+	std::size_t size() const;
+
+	std::size_t capacity() const {
+		return max_nodes;
+	}
+
+	std::uint64_t fingerprint() const {
+		return config;
+	}
+
+private:
+	struct Node {
+		Node *parent;
+		std::pair<int, int> key;
+		std::unordered_map<std::uint64_t, std::unique_ptr<Node> > children;
+		std::list<Node *>::iterator position;
+
+		std::unique_ptr<Selection> selection;
+		bool has_theta;
+		bool has_se;
+		double theta;
+		double se;
+	};
+
+	static std::uint64_t childKey(const std::pair<int, int> &key);
+
+	/**
+	 * The node for path, or nullptr when it is not stored. create adds the missing nodes (and may return
+	 * nullptr if path is longer than the capacity). Either way, the nodes found are marked as used.
+	 */
+	Node *find(const Path &path, bool create);
+	Node *addChild(Node *parent, const std::pair<int, int> &key, bool most_recent);
+	void touch(Node *node);
+	void evict();
+
+	const std::uint64_t config;
+	const std::size_t max_nodes;
+
+	mutable std::mutex mutex;
+	Node root;
+	std::list<Node *> recent;
+};
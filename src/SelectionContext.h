@@ -0,0 +1,14 @@
+#pragma once
+#include "Prior.h"
+
+/**
+ * Respondent-level quantities shared by every candidate item in one selectItem() call. The selectors build it
+ * once with Estimator::selectionContext() before scoring items, so the estimate of theta (and, for the KL and
+ * MFII interval, the test information at it) is not recomputed for each item.
+ */
+struct SelectionContext {
+	Prior &prior;
+	double theta;
+	// Fisher test information at theta; NaN unless requested when the context was built
+	double test_info;
+};
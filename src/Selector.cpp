@@ -1,7 +1,66 @@
 #include "Selector.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
 
 /**
  * An abstract class that represents the various ways of selecting the next question.
  */
-Selector::Selector(QuestionSet &questions, Estimator &estimation, Prior &priorModel)
-		: questionSet(questions), estimator(estimation), prior(priorModel) {}
+Selector::Selector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel, const Screen &screen)
+		: questionSet(questions), estimator(estimation), prior(priorModel), screen(screen) {}
+
+std::vector<int> Selector::screenedQuestions(double theta, const std::vector<int> &questions) const {
+	if (screen.size == 0 || screen.size >= questions.size()) {
+		return std::vector<int>();
+	}
+
+	std::vector<double> information(questions.size());
+	try {
+		estimator.fisherInf(theta, questions.data(), questions.size(), information.data());
+	}
+	catch (std::domain_error &) {
+		// Without the information to rank them by, every item gets the criterion
+		return std::vector<int>();
+	}
+
+	// Items whose information is NaN go last, so the comparison below is a strict weak ordering
+	std::vector<size_t> order(questions.size());
+	std::iota(order.begin(), order.end(), 0);
+	auto ranked_end = std::stable_partition(order.begin(), order.end(), [&](size_t i) {
+		return !std::isnan(information[i]);
+	});
+	const size_t ranked = std::min(screen.size, size_t(std::distance(order.begin(), ranked_end)));
+	std::partial_sort(order.begin(), order.begin() + ranked, ranked_end, [&](size_t a, size_t b) {
+		return information[a] > information[b] || (information[a] == information[b] && a < b);
+	});
+
+	std::vector<int> candidates(screen.size);
+	for (size_t i = 0; i < screen.size; ++i) {
+		candidates[i] = questions[order[i]];
+	}
+	// In item order, so ties in the criterion go to the same item as without screening
+	std::sort(candidates.begin(), candidates.end());
+	return candidates;
+}
+
+bool Selector::startScreenedSelection() const {
+	if (screen.diagnostics == nullptr) {
+		return false;
+	}
+	const size_t count = screen.diagnostics->selections.fetch_add(1);
+	return screen.audit > 0 && count % screen.audit == 0;
+}
+
+void Selector::recordAudit(bool disagreed) const {
+	screen.diagnostics->audits.fetch_add(1);
+	if (disagreed) {
+		screen.diagnostics->disagreements.fetch_add(1);
+	}
+}
+
+size_t Selector::bestValue(const std::vector<double> &values, bool minimize) {
+	auto best = minimize ? std::min_element(values.begin(), values.end()) :
+	            std::max_element(values.begin(), values.end());
+	return std::distance(values.begin(), best);
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include "Selection.h"
 #include "QuestionSet.h"
 #include "Estimator.h"
@@ -9,17 +11,103 @@ enum class SelectionType {
 };
 
 
+/**
+ * How often screened selections were made, how many of them were audited by also computing the criterion for
+ * every item, and how many of those audits found a different best item. Kept by a session's Cat only; its copies
+ * have none.
+ */
+struct ScreenDiagnostics {
+	std::atomic<size_t> selections;
+	std::atomic<size_t> audits;
+	std::atomic<size_t> disagreements;
+
+	ScreenDiagnostics() : selections(0), audits(0), disagreements(0) {}
+};
+
+/**
+ * Two-stage selection for the criteria that are expensive per item (EPV, MEI, and KL): the size unanswered items
+ * with the most Fisher information at the current estimate are screened in, and only they get the criterion.
+ * Every audit-th screened selection (none if audit is 0) also computes the criterion for every item and records
+ * in diagnostics whether the best item differs; without diagnostics, selections are neither counted nor audited. A
+ * size of 0 turns screening off.
+ */
+struct Screen {
+	size_t size;
+	size_t audit;
+	ScreenDiagnostics *diagnostics;
+};
+
+
 class Selector {
 public:
 	virtual SelectionType getSelectionType() = 0;
 
 	virtual Selection selectItem() = 0;
 
-	Selector(QuestionSet &questions, Estimator &estimation, Prior &priorModel);
+	Selector(const QuestionSet &questions, const Estimator &estimation, Prior &priorModel,
+	         const Screen &screen = Screen{0, 0, nullptr});
 
 protected:
-	QuestionSet &questionSet;
-	Estimator &estimator;
+	/**
+	 * Number of candidate items whose MPWI, MLWI, KL, LKL, or PKL integrals are computed together (see
+	 * Estimator::expectedKL). Larger blocks share more likelihood evaluations; smaller ones leave more blocks to
+	 * run in parallel.
+	 */
+	static const size_t integralBlockSize = 16;
+
+	const QuestionSet &questionSet;
+	const Estimator &estimator;
 	Prior &prior;
+	const Screen screen;
+
+	/**
+	 * Sets selection.values and selection.item from evaluate(questions, values), which writes the criterion of
+	 * each of questions to values, choosing the first smallest value if minimize and the first largest otherwise.
+	 * With screening, only the screened items are evaluated (unless the selection is audited) and the values of
+	 * the others are NA.
+	 */
+	template <class Evaluate>
+	void selectScreened(Selection &selection, double theta, bool minimize, const Evaluate &evaluate) const {
+		const std::vector<int> &questions = selection.questions;
+		selection.values.resize(questions.size());
+
+		std::vector<int> candidates = screenedQuestions(theta, questions);
+		if (candidates.empty()) {
+			evaluate(questions, selection.values);
+			selection.item = questions.at(bestValue(selection.values, minimize));
+			return;
+		}
+
+		std::vector<double> candidate_values(candidates.size());
+		evaluate(candidates, candidate_values);
+		selection.item = candidates.at(bestValue(candidate_values, minimize));
+
+		if (startScreenedSelection()) {
+			evaluate(questions, selection.values);
+			recordAudit(selection.item != questions.at(bestValue(selection.values, minimize)));
+			return;
+		}
+
+		std::fill(selection.values.begin(), selection.values.end(), NA_REAL);
+		for (size_t i = 0; i < candidates.size(); ++i) {
+			auto position = std::lower_bound(questions.begin(), questions.end(), candidates[i]);
+			selection.values[std::distance(questions.begin(), position)] = candidate_values[i];
+		}
+	}
+
+private:
+	/**
+	 * The items screened in from questions, in increasing order, or none if screening is off, would keep every
+	 * item, or the information at theta cannot be computed.
+	 */
+	std::vector<int> screenedQuestions(double theta, const std::vector<int> &questions) const;
+
+	/**
+	 * Counts a screened selection and returns whether it is audited.
+	 */
+	bool startScreenedSelection() const;
+	void recordAudit(bool disagreed) const;
+
+	static size_t bestValue(const std::vector<double> &values, bool minimize);
 };
 
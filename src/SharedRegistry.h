@@ -0,0 +1,38 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <mutex>
+
+
+/**
+ * Objects that are built once per key and shared by every Cat that asks for the same key while any of them is
+ * alive. The registry only holds weak pointers, so an object is freed with the last Cat that uses it, and its
+ * entry is dropped the next time an object has to be built.
+ */
+template <class Key, class Value>
+class SharedRegistry {
+public:
+	/**
+	 * The object registered for key if some Cat still holds it, or else the one returned by make(), which is
+	 * then registered for key.
+	 */
+	template <class Make>
+	std::shared_ptr<Value> get(const Key &key, Make make) {
+		std::lock_guard<std::mutex> lock(mutex);
+		std::weak_ptr<Value> &entry = entries[key];
+		std::shared_ptr<Value> value = entry.lock();
+		if (!value) {
+			value = make();
+			entry = value;
+			// Forget the objects whose Cats are all gone
+			for (auto other = entries.begin(); other != entries.end();) {
+				other = other->second.expired() ? entries.erase(other) : std::next(other);
+			}
+		}
+		return value;
+	}
+
+private:
+	std::mutex mutex;
+	std::map<Key, std::weak_ptr<Value> > entries;
+};
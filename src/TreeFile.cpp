@@ -0,0 +1,224 @@
+#include "TreeFile.h"
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+const char treeMagic[8] = {'c', 'a', 't', 'T', 'r', 'e', 'e', '\0'};
+const std::uint32_t byteOrderMark = 0x01020304;
+
+template <typename T>
+void writeValue(std::ofstream &out, const T &value) {
+	out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+}
+
+void TreeFile::write(const std::string &path, const CatTree &tree, const std::vector<std::string> &item_names,
+                     int lowest_answer, bool estimates) {
+	if (tree.size() > std::numeric_limits<std::uint32_t>::max()) {
+		throw std::domain_error("tree has too many nodes to be written to a file.");
+	}
+
+	std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+	if (!out) {
+		throw std::runtime_error("could not open " + path + " for writing.");
+	}
+
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, treeMagic, sizeof(treeMagic));
+	header.version = version;
+	header.byte_order = byteOrderMark;
+	header.flags = estimates ? hasEstimatesFlag : 0;
+	header.lowest_answer = lowest_answer;
+	header.node_count = tree.size();
+	header.item_count = item_names.size();
+	writeValue(out, header);
+
+	for (const TreeNode &node : tree) {
+		Node record = {node.item, std::uint32_t(node.first_child), std::uint32_t(node.child_count), 0};
+		writeValue(out, record);
+	}
+
+	if (estimates) {
+		for (const TreeNode &node : tree) {
+			writeValue(out, node.theta);
+		}
+		for (const TreeNode &node : tree) {
+			writeValue(out, node.se);
+		}
+	}
+
+	for (const std::string &name : item_names) {
+		writeValue(out, std::uint32_t(name.size()));
+		out.write(name.data(), name.size());
+	}
+
+	if (!out) {
+		throw std::runtime_error("could not write " + path + ".");
+	}
+}
+
+TreeFile::TreeFile(const std::string &path) : data(nullptr), size(0), nodes(nullptr), thetas(nullptr), ses(nullptr),
+                                              node_count(0), lowest_answer(0) {
+	map(path);
+	try {
+		Header header;
+		if (size < sizeof(Header)) {
+			throw std::domain_error(path + " is not a tree file.");
+		}
+		std::memcpy(&header, data, sizeof(Header));
+		if (std::memcmp(header.magic, treeMagic, sizeof(treeMagic)) != 0) {
+			throw std::domain_error(path + " is not a tree file.");
+		}
+		if (header.version != version) {
+			throw std::domain_error(path + " has tree file version " + std::to_string(header.version) +
+			                        ", but this version of catSurv reads version " + std::to_string(version) + ".");
+		}
+		if (header.byte_order != byteOrderMark) {
+			throw std::domain_error(path + " was written on a machine with a different byte order.");
+		}
+
+		const bool estimates = header.flags & hasEstimatesFlag;
+		const std::size_t node_bytes = sizeof(Node) + (estimates ? 2 * sizeof(double) : 0);
+		if (header.node_count == 0 || header.node_count > (size - sizeof(Header)) / node_bytes) {
+			throw std::domain_error(path + " is truncated.");
+		}
+
+		node_count = header.node_count;
+		lowest_answer = header.lowest_answer;
+		const char *position = data + sizeof(Header);
+		nodes = reinterpret_cast<const Node *>(position);
+		position += node_count * sizeof(Node);
+		if (estimates) {
+			thetas = reinterpret_cast<const double *>(position);
+			ses = thetas + node_count;
+			position += 2 * node_count * sizeof(double);
+		}
+
+		const char *end = data + size;
+		item_names.reserve(header.item_count);
+		for (std::uint32_t i = 0; i < header.item_count; ++i) {
+			std::uint32_t length;
+			if (std::size_t(end - position) < sizeof(length)) {
+				throw std::domain_error(path + " is truncated.");
+			}
+			std::memcpy(&length, position, sizeof(length));
+			position += sizeof(length);
+			if (std::size_t(end - position) < length) {
+				throw std::domain_error(path + " is truncated.");
+			}
+			item_names.push_back(std::string(position, length));
+			position += length;
+		}
+	}
+	catch (...) {
+		unmap();
+		throw;
+	}
+}
+
+TreeFile::~TreeFile() {
+	unmap();
+}
+
+std::size_t TreeFile::route(const int *answers, std::size_t items) const {
+	std::size_t node = 0;
+	while (nodes[node].child_count > 0) {
+		const Node &current = nodes[node];
+		if (current.item < 0 || std::size_t(current.item) >= items) {
+			throw std::domain_error("answers must have a value for every item in the tree.");
+		}
+
+		const int answer = answers[current.item];
+		if (answer == NA_INTEGER) {
+			break;
+		}
+		if (answer != -1 && answer < lowest_answer) {
+			throw std::domain_error("answer is not a valid response option for this item.");
+		}
+		const std::size_t option = answer == -1 ? 0 : std::size_t(answer - lowest_answer) + 1;
+		if (option >= current.child_count) {
+			throw std::domain_error("answer is not a valid response option for this item.");
+		}
+		// Children follow their parent in the level order writeTree uses, so a child at or before its parent
+		// could only lead back around the same nodes forever
+		if (current.first_child <= node || current.first_child + option >= node_count) {
+			throw std::domain_error("tree file is corrupt.");
+		}
+		node = current.first_child + option;
+	}
+	return node;
+}
+
+#ifdef _WIN32
+
+// Windows builds read the file instead of mapping it
+void TreeFile::map(const std::string &path) {
+	std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+	if (!in) {
+		throw std::runtime_error("could not open " + path + ".");
+	}
+	contents.resize(std::size_t(in.tellg()));
+	in.seekg(0);
+	in.read(contents.data(), contents.size());
+	if (!in) {
+		throw std::runtime_error("could not read " + path + ".");
+	}
+	data = contents.data();
+	size = contents.size();
+}
+
+void TreeFile::unmap() {
+	std::vector<char>().swap(contents);
+	data = nullptr;
+	size = 0;
+}
+
+#else
+
+void TreeFile::map(const std::string &path) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("could not open " + path + ".");
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) != 0) {
+		close(fd);
+		throw std::runtime_error("could not read " + path + ".");
+	}
+
+	size = status.st_size;
+	if (size > 0) {
+		void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("could not map " + path + " into memory.");
+		}
+		data = static_cast<const char *>(mapped);
+	}
+	// The mapping stays valid after the descriptor is closed
+	close(fd);
+}
+
+void TreeFile::unmap() {
+	if (data != nullptr) {
+		munmap(const_cast<char *>(data), size);
+	}
+	data = nullptr;
+	size = 0;
+}
+
+#endif
@@ -0,0 +1,116 @@
+#pragma once
+#include <Rcpp.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CatTree.h"
+
+
+/**
+ * A branching tree written by Cat::writeTree, mapped into memory so that respondents can be routed through it
+ * without running an estimator or reading the whole file.
+ *
+ * The file holds, in the machine's byte order:
+ *  - a Header, starting with "catTree" and the format version;
+ *  - one Node per tree node, in the order of CatTree, the root first;
+ *  - if the estimates flag is set, theta and then SE for every node, as doubles;
+ *  - the name of every item, each as a uint32 length followed by that many bytes.
+ *
+ * The child of a node for an answer is the node at first_child plus the position of the answer among -1
+ * (skipped) and lowest_answer upwards, so routing reads one node per item answered.
+ */
+class TreeFile {
+public:
+	static const std::uint32_t version = 1;
+
+	/**
+	 * Writes tree to path. estimates adds each node's theta and SE, which must then be set in tree.
+	 * lowest_answer is 0 for binary models and 1 for polytomous ones.
+	 */
+	static void write(const std::string &path, const CatTree &tree, const std::vector<std::string> &item_names,
+	                  int lowest_answer, bool estimates);
+
+	/**
+	 * Maps path into memory. Throws if it is not a tree file of this version and byte order.
+	 */
+	explicit TreeFile(const std::string &path);
+	~TreeFile();
+
+	TreeFile(const TreeFile &) = delete;
+	TreeFile &operator=(const TreeFile &) = delete;
+
+	/**
+	 * Follows answers (zero-indexed by item, NA for unanswered items) from the root, and returns the first
+	 * node whose item is unanswered, or the leaf the answers lead to. Throws if an answer on the way is not a
+	 * response option of the item.
+	 */
+	std::size_t route(const int *answers, std::size_t items) const;
+
+	/**
+	 * The item (zero-indexed) selected at node, or -1 when all items are answered there.
+	 */
+	int item(std::size_t node) const {
+		return nodes[node].item;
+	}
+
+	bool hasEstimates() const {
+		return thetas != nullptr;
+	}
+
+	/**
+	 * Estimates from the answers leading to node, NA when the file has none.
+	 */
+	double theta(std::size_t node) const {
+		return thetas ? thetas[node] : NA_REAL;
+	}
+
+	double se(std::size_t node) const {
+		return ses ? ses[node] : NA_REAL;
+	}
+
+	std::size_t nodeCount() const {
+		return node_count;
+	}
+
+	const std::vector<std::string> &itemNames() const {
+		return item_names;
+	}
+
+private:
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t byte_order;
+		std::uint32_t flags;
+		std::int32_t lowest_answer;
+		std::uint64_t node_count;
+		std::uint32_t item_count;
+		std::uint32_t reserved;
+	};
+
+	struct Node {
+		std::int32_t item;
+		std::uint32_t first_child;
+		std::uint32_t child_count;
+		std::uint32_t reserved;
+	};
+
+	static const std::uint32_t hasEstimatesFlag = 1;
+
+	const char *data;
+	std::size_t size;
+#ifdef _WIN32
+	std::vector<char> contents;
+#endif
+
+	const Node *nodes;
+	const double *thetas;
+	const double *ses;
+	std::size_t node_count;
+	int lowest_answer;
+	std::vector<std::string> item_names;
+
+	void map(const std::string &path);
+	void unmap();
+};
@@ -0,0 +1,214 @@
+#include "VectorMath.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+
+namespace {
+
+/**
+ * The operations the approximations need, for each instruction set. mask is the result of a comparison and
+ * select(m, a, b) picks a where m is set.
+ */
+#if defined(__AVX512F__)
+struct Ops {
+	typedef __m512d vd;
+	typedef __mmask8 mask;
+	static const std::size_t width = 8;
+
+	static vd load(const double *p) { return _mm512_loadu_pd(p); }
+	static void store(double *p, vd v) { _mm512_storeu_pd(p, v); }
+	static vd set1(double x) { return _mm512_set1_pd(x); }
+	static vd add(vd a, vd b) { return _mm512_add_pd(a, b); }
+	static vd sub(vd a, vd b) { return _mm512_sub_pd(a, b); }
+	static vd mul(vd a, vd b) { return _mm512_mul_pd(a, b); }
+	static vd div(vd a, vd b) { return _mm512_div_pd(a, b); }
+	static vd round(vd a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+	static vd floor(vd a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+	static mask lt(vd a, vd b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+	static mask gt(vd a, vd b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+	static mask eq(vd a, vd b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+	static mask unordered(vd a) { return _mm512_cmp_pd_mask(a, a, _CMP_UNORD_Q); }
+	static vd select(mask m, vd a, vd b) { return _mm512_mask_blend_pd(m, b, a); }
+	static vd shiftLeft52(vd a) { return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_castpd_si512(a), 52)); }
+	static vd shiftRight52(vd a) { return _mm512_castsi512_pd(_mm512_srli_epi64(_mm512_castpd_si512(a), 52)); }
+	static vd bitAnd(vd a, vd b) {
+		return _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(a), _mm512_castpd_si512(b)));
+	}
+	static vd bitOr(vd a, vd b) {
+		return _mm512_castsi512_pd(_mm512_or_si512(_mm512_castpd_si512(a), _mm512_castpd_si512(b)));
+	}
+	static vd bits(long long x) { return _mm512_castsi512_pd(_mm512_set1_epi64(x)); }
+};
+#else
+struct Ops {
+	typedef __m256d vd;
+	typedef __m256d mask;
+	static const std::size_t width = 4;
+
+	static vd load(const double *p) { return _mm256_loadu_pd(p); }
+	static void store(double *p, vd v) { _mm256_storeu_pd(p, v); }
+	static vd set1(double x) { return _mm256_set1_pd(x); }
+	static vd add(vd a, vd b) { return _mm256_add_pd(a, b); }
+	static vd sub(vd a, vd b) { return _mm256_sub_pd(a, b); }
+	static vd mul(vd a, vd b) { return _mm256_mul_pd(a, b); }
+	static vd div(vd a, vd b) { return _mm256_div_pd(a, b); }
+	static vd round(vd a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+	static vd floor(vd a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+	static mask lt(vd a, vd b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+	static mask gt(vd a, vd b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+	static mask eq(vd a, vd b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+	static mask unordered(vd a) { return _mm256_cmp_pd(a, a, _CMP_UNORD_Q); }
+	static vd select(mask m, vd a, vd b) { return _mm256_blendv_pd(b, a, m); }
+	static vd shiftLeft52(vd a) { return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(a), 52)); }
+	static vd shiftRight52(vd a) { return _mm256_castsi256_pd(_mm256_srli_epi64(_mm256_castpd_si256(a), 52)); }
+	static vd bitAnd(vd a, vd b) {
+		return _mm256_castsi256_pd(_mm256_and_si256(_mm256_castpd_si256(a), _mm256_castpd_si256(b)));
+	}
+	static vd bitOr(vd a, vd b) {
+		return _mm256_castsi256_pd(_mm256_or_si256(_mm256_castpd_si256(a), _mm256_castpd_si256(b)));
+	}
+	static vd bits(long long x) { return _mm256_castsi256_pd(_mm256_set1_epi64x(x)); }
+};
+#endif
+
+typedef Ops::vd vd;
+
+// 2^52 + 2^51: adding it to an integral double leaves the integer in the low mantissa bits
+const double roundingMagic = 6755399441055744.0;
+
+/**
+ * 2^n for integral n in [-1022, 1023], built directly from the exponent bits.
+ */
+inline vd pow2(vd n) {
+	return Ops::shiftLeft52(Ops::add(n, Ops::set1(roundingMagic + 1023.0)));
+}
+
+/**
+ * Cephes exp: exp(x) = 2^n exp(r) with |r| <= ln(2)/2, and exp(r) = 1 + 2r P(r^2) / (Q(r^2) - r P(r^2)).
+ */
+inline vd exp_kernel(vd x) {
+	const vd n = Ops::round(Ops::mul(x, Ops::set1(1.4426950408889634073599)));
+	vd r = Ops::sub(x, Ops::mul(n, Ops::set1(6.93145751953125E-1)));
+	r = Ops::sub(r, Ops::mul(n, Ops::set1(1.42860682030941723212E-6)));
+
+	const vd rr = Ops::mul(r, r);
+	vd p = Ops::set1(1.26177193074810590878E-4);
+	p = Ops::add(Ops::mul(p, rr), Ops::set1(3.02994407707441961300E-2));
+	p = Ops::add(Ops::mul(p, rr), Ops::set1(9.99999999999999999910E-1));
+	p = Ops::mul(p, r);
+
+	vd q = Ops::set1(3.00198505138664455042E-6);
+	q = Ops::add(Ops::mul(q, rr), Ops::set1(2.52448340349684104192E-3));
+	q = Ops::add(Ops::mul(q, rr), Ops::set1(2.27265548208155028766E-1));
+	q = Ops::add(Ops::mul(q, rr), Ops::set1(2.00000000000000000009E0));
+
+	vd result = Ops::add(Ops::set1(1.0), Ops::mul(Ops::set1(2.0), Ops::div(p, Ops::sub(q, p))));
+
+	// Scaling in two steps keeps both factors normal when the result is subnormal or close to overflow
+	const vd n1 = Ops::floor(Ops::mul(n, Ops::set1(0.5)));
+	const vd n2 = Ops::sub(n, n1);
+	result = Ops::mul(Ops::mul(result, pow2(n1)), pow2(n2));
+
+	result = Ops::select(Ops::gt(x, Ops::set1(709.782712893383996843)), Ops::set1(INFINITY), result);
+	result = Ops::select(Ops::lt(x, Ops::set1(-745.13321910194110842)), Ops::set1(0.0), result);
+	return Ops::select(Ops::unordered(x), x, result);
+}
+
+/**
+ * Cephes log: with x = m 2^e and m in [sqrt(1/2), sqrt(2)), log(x) = e log(2) + log(m), and
+ * log(1 + f) = f - f^2/2 + f^3 P(f) / Q(f).
+ */
+inline vd log_kernel(vd x) {
+	// Subnormal inputs are scaled into the normal range first
+	const Ops::mask subnormal = Ops::lt(x, Ops::set1(std::numeric_limits<double>::min()));
+	const vd scaled = Ops::select(subnormal, Ops::mul(x, Ops::set1(18014398509481984.0)), x);
+	const vd exponent_shift = Ops::select(subnormal, Ops::set1(-54.0 - 1022.0), Ops::set1(-1022.0));
+
+	// Biased exponent field converted to double through the low mantissa bits of 2^52
+	const vd biased = Ops::sub(Ops::bitOr(Ops::shiftRight52(scaled), Ops::bits(0x4330000000000000LL)),
+	                           Ops::set1(4503599627370496.0));
+	vd e = Ops::add(biased, exponent_shift);
+	// Mantissa in [0.5, 1)
+	vd m = Ops::bitOr(Ops::bitAnd(scaled, Ops::bits(0x000FFFFFFFFFFFFFLL)), Ops::bits(0x3FE0000000000000LL));
+
+	const Ops::mask small = Ops::lt(m, Ops::set1(0.70710678118654752440));
+	e = Ops::select(small, Ops::sub(e, Ops::set1(1.0)), e);
+	const vd f = Ops::select(small, Ops::sub(Ops::add(m, m), Ops::set1(1.0)), Ops::sub(m, Ops::set1(1.0)));
+
+	vd p = Ops::set1(1.01875663804580931796E-4);
+	p = Ops::add(Ops::mul(p, f), Ops::set1(4.97494994976747001425E-1));
+	p = Ops::add(Ops::mul(p, f), Ops::set1(4.70579119878881725854E0));
+	p = Ops::add(Ops::mul(p, f), Ops::set1(1.44989225341610930846E1));
+	p = Ops::add(Ops::mul(p, f), Ops::set1(1.79368678507819816313E1));
+	p = Ops::add(Ops::mul(p, f), Ops::set1(7.70838733755885391666E0));
+
+	vd q = Ops::add(f, Ops::set1(1.12873587189167450590E1));
+	q = Ops::add(Ops::mul(q, f), Ops::set1(4.52279145837532221105E1));
+	q = Ops::add(Ops::mul(q, f), Ops::set1(8.29875266912776603211E1));
+	q = Ops::add(Ops::mul(q, f), Ops::set1(7.11544750618563894466E1));
+	q = Ops::add(Ops::mul(q, f), Ops::set1(2.31251620126765340583E1));
+
+	const vd z = Ops::mul(f, f);
+	vd y = Ops::mul(f, Ops::div(Ops::mul(z, p), q));
+	y = Ops::sub(y, Ops::mul(e, Ops::set1(2.121944400546905827679e-4)));
+	y = Ops::sub(y, Ops::mul(z, Ops::set1(0.5)));
+	vd result = Ops::add(f, y);
+	result = Ops::add(result, Ops::mul(e, Ops::set1(0.693359375)));
+
+	result = Ops::select(Ops::eq(x, Ops::set1(INFINITY)), x, result);
+	result = Ops::select(Ops::eq(x, Ops::set1(0.0)), Ops::set1(-INFINITY), result);
+	result = Ops::select(Ops::lt(x, Ops::set1(0.0)), Ops::set1(NAN), result);
+	return Ops::select(Ops::unordered(x), x, result);
+}
+
+template <vd (*Kernel)(vd)>
+void apply(const double *in, double *out, std::size_t n) {
+	std::size_t i = 0;
+	for (; i + Ops::width <= n; i += Ops::width) {
+		Ops::store(out + i, Kernel(Ops::load(in + i)));
+	}
+	if (i < n) {
+		double tail[Ops::width];
+		std::fill(tail, tail + Ops::width, 1.0);
+		std::copy(in + i, in + n, tail);
+		Ops::store(tail, Kernel(Ops::load(tail)));
+		std::copy(tail, tail + (n - i), out + i);
+	}
+}
+
+}
+
+void vexp(const double *in, double *out, std::size_t n) {
+	apply<exp_kernel>(in, out, n);
+}
+
+void vlog(const double *in, double *out, std::size_t n) {
+	apply<log_kernel>(in, out, n);
+}
+
+std::size_t vectorWidth() {
+	return Ops::width;
+}
+
+#else
+
+void vexp(const double *in, double *out, std::size_t n) {
+	for (std::size_t i = 0; i < n; ++i) {
+		out[i] = std::exp(in[i]);
+	}
+}
+
+void vlog(const double *in, double *out, std::size_t n) {
+	for (std::size_t i = 0; i < n; ++i) {
+		out[i] = std::log(in[i]);
+	}
+}
+
+std::size_t vectorWidth() {
+	return 1;
+}
+
+#endif
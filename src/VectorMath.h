@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * exp and log over arrays, used by the batch item kernels in ItemModels.h. in and out may be the same array.
+ *
+ * When the package is compiled with AVX-512 (__AVX512F__) or AVX2 (__AVX2__) enabled, for example with
+ * -march=native in ~/.R/Makevars, values are evaluated 8 or 4 at a time with Cephes-style rational approximations
+ * that are accurate to a few units in the last place, and a final partial vector is padded so every value goes
+ * through the same approximation. Otherwise std::exp and std::log are used, so default builds give exactly the
+ * same results as the per-item code.
+ */
+void vexp(const double *in, double *out, std::size_t n);
+void vlog(const double *in, double *out, std::size_t n);
+
+/**
+ * Number of doubles evaluated per vector instruction by vexp and vlog (1 without AVX).
+ */
+std::size_t vectorWidth();
@@ -1,181 +1,119 @@
 #include "WLEEstimator.h"
 
 
-double WLEEstimator::ltm_estimateTheta(Prior prior){
+double WLEEstimator::ltm_estimateTheta() const{
   
-  integrableFunction W = [&](double theta) {
+  auto W = [&](double theta) {
     double B = 0.0;
     double I = 0.0;
     for (auto item : questionSet.applicable_rows) {
-      double a = (questionSet.difficulty.at(item)).at(0);
-      double b = questionSet.discrimination.at(item);
-      double c = questionSet.guessing.at(item);
+      double a = questionSet.bank->item_thresholds(item)[0];
+      double b = questionSet.bank->discrimination[item];
+      double c = questionSet.bank->guessing[item];
 
       double exp_part = exp(a + b * theta);
       double dP = b * (1 - c) * (exp_part / std::pow((1.0 + exp_part), 2.0));
       double d2P = std::pow(b, 2.0) * exp_part * (1 - exp_part) * ((1 - c) / std::pow((1.0 + exp_part), 3.0));
 
-      double P = prob_ltm(theta, item);
+      double P = BinaryModel::prob(*questionSet.bank, item, theta);
       B += (dP * d2P) / (P * (1.0 - P));
-      I += fisherInf(theta, item);
+      I += BinaryModel::fisherInf(*questionSet.bank, item, theta);
     }
-    double L_theta = d1LL(theta, false, prior);
+    double L_theta = model_d1LL<BinaryModel>(theta);
     return L_theta + (B / (2 * I));
   };
   
   return brentMethod(W);
 }
 
-double WLEEstimator::ltm_estimateTheta(Prior prior, size_t question, int answer){
+double WLEEstimator::ltm_estimateTheta(size_t question, int answer) const{
   
-  integrableFunction W = [&](double theta) {
+  auto W = [&](double theta) {
     double B = 0.0;
     double I = 0.0;
     for (auto item : questionSet.applicable_rows) {
-      double a = (questionSet.difficulty.at(item)).at(0);
-      double b = questionSet.discrimination.at(item);
-      double c = questionSet.guessing.at(item);
+      double a = questionSet.bank->item_thresholds(item)[0];
+      double b = questionSet.bank->discrimination[item];
+      double c = questionSet.bank->guessing[item];
 
       double exp_part = exp(a + b * theta);
       double dP = b * (1 - c) * (exp_part / std::pow((1.0 + exp_part), 2.0));
       double d2P = std::pow(b, 2.0) * exp_part * (1 - exp_part) * ((1 - c) / std::pow((1.0 + exp_part), 3.0));
 
-      double P = prob_ltm(theta, item);
+      double P = BinaryModel::prob(*questionSet.bank, item, theta);
       B += (dP * d2P) / (P * (1.0 - P));
-      I += fisherInf(theta, item, questionSet.answers.at(item));
+      I += BinaryModel::fisherInf(*questionSet.bank, item, theta);
     }
 
-    double a = questionSet.difficulty.at(question).at(0);
-    double b = questionSet.discrimination.at(question);
-    double c = questionSet.guessing.at(question);
+    double a = questionSet.bank->item_thresholds(question)[0];
+    double b = questionSet.bank->discrimination[question];
+    double c = questionSet.bank->guessing[question];
 
     double exp_part = exp(a + b * theta);
     double dP = b * (1 - c) * (exp_part / std::pow((1.0 + exp_part), 2.0));
     double d2P = std::pow(b, 2.0) * exp_part * (1 - exp_part) * ((1 - c) / std::pow((1.0 + exp_part), 3.0));
 
-    double P = prob_ltm(theta, question);
+    double P = BinaryModel::prob(*questionSet.bank, question, theta);
     B += (dP * d2P) / (P * (1.0 - P));
-    I += fisherInf(theta, question, answer);
+    I += BinaryModel::fisherInf(*questionSet.bank, question, theta);
 
-    double L_theta = d1LL(theta, false, prior, question, answer);
+    double L_theta = model_d1LL<BinaryModel>(theta, question, answer);
     return L_theta + (B / (2 * I));
   };
   
   return brentMethod(W);
 }
 
-double WLEEstimator::gpcm_estimateTheta(Prior prior){
+double WLEEstimator::gpcm_estimateTheta() const{
   
-  integrableFunction W = [&](double theta) {
+  auto W = [&](double theta) {
     double B = 0.0;
     double I = 0.0;
 
-    std::vector<double> p;
-    std::vector<double> p_prime;
-    std::vector<double> p_primeprime;
-  
     for (auto item : questionSet.applicable_rows) {
-      I += fisherInf(theta, item);
-      
-      prob_derivs_gpcm(theta, item, p, p_prime, p_primeprime);
-      
-      for (size_t k = 0; k < p.size(); ++k) {
-        B += (p_prime.at(k) * p_primeprime.at(k)) / p.at(k);
-      }
+      I += GPCMModel::fisherInf(*questionSet.bank, item, theta);
+      add_gpcm_bias(item, theta, B);
     }
-    double L_theta = d1LL(theta, false, prior);
+    double L_theta = model_d1LL<GPCMModel>(theta);
     return L_theta + (B / (2 * I));
   };
   
   return brentMethod(W);
 }
 
-double WLEEstimator::gpcm_estimateTheta(Prior prior, size_t question, int answer){
+double WLEEstimator::gpcm_estimateTheta(size_t question, int answer) const{
   
-  integrableFunction W = [&](double theta) {
+  auto W = [&](double theta) {
     double B = 0.0;
     double I = 0.0;
-  
-    std::vector<double> p;
-    std::vector<double> p_prime;
-    std::vector<double> p_primeprime;
 
     for (auto item : questionSet.applicable_rows) {
-      I += fisherInf(theta, item, questionSet.answers.at(item));
-      
-      prob_derivs_gpcm(theta, item, p, p_prime, p_primeprime);
-      
-      for (size_t k = 0; k < p.size(); ++k) {
-        B += (p_prime.at(k) * p_primeprime.at(k)) / p.at(k);
-      }
-    }
-
-    I += fisherInf(theta, question, answer);
-    
-    prob_derivs_gpcm(theta, question, p, p_prime, p_primeprime);
-    
-    for (size_t k = 0; k < p.size(); ++k) {
-      B += (p_prime.at(k) * p_primeprime.at(k)) / p.at(k);
+      I += GPCMModel::fisherInf(*questionSet.bank, item, theta);
+      add_gpcm_bias(item, theta, B);
     }
 
+    I += GPCMModel::fisherInf(*questionSet.bank, question, theta);
+    add_gpcm_bias(question, theta, B);
 
-    double L_theta = d1LL(theta, false, prior, question, answer);
+    double L_theta = model_d1LL<GPCMModel>(theta, question, answer);
     return L_theta + (B / (2 * I));
   };
   
   return brentMethod(W);
 }
 
-double WLEEstimator::grm_estimateTheta(Prior prior){
+double WLEEstimator::grm_estimateTheta() const{
   
-  integrableFunction W = [&](double theta) {
+  auto W = [&](double theta) {
     double B = 0.0;
     double I = 0.0;
 
     for (auto item : questionSet.applicable_rows) {
-      I += fisherInf(theta, item);
-      
-      double beta = questionSet.discrimination.at(item);
-      std::vector<double> P_stars = prob_grm(theta, item);
-      
-      std::vector<double> P;
-      for (size_t i = 1; i < P_stars.size(); ++i) {
-        double P1 = P_stars.at(i);
-        double P2 = P_stars.at(i-1);
-        P.push_back(P1 - P2);
-      }
-    
-      std::vector<double> P_star_prime;
-      std::vector<double> P_star_2prime;
-      std::vector<double> P_prime;
-      std::vector<double> P_2prime;
-
-      for (size_t k = 0; k < P_stars.size(); ++k) {
-        double P_star = P_stars.at(k);
-        double Q_star = 1 - P_star;
-        double P_star_p = -1 * beta * P_star * Q_star;
-        P_star_prime.push_back(P_star_p);
-        
-        double P_star_2p = -1 * beta * (P_star_p - (2 * P_star * P_star_p));
-        P_star_2prime.push_back(P_star_2p);
-      }
-      
-      for (size_t j = 1; j < P_star_prime.size(); ++j) {
-        double P_prime1 = P_star_prime.at(j);
-        double P_prime2 = P_star_prime.at(j-1);
-        P_prime.push_back(P_prime1 - P_prime2);
-      
-        double P_2prime1 = P_star_2prime.at(j);
-        double P_2prime2 = P_star_2prime.at(j-1);
-        P_2prime.push_back(P_2prime1 - P_2prime2);
-      }
-    
-      for (size_t k = 0; k < P.size(); ++k) {
-        B += (P_prime.at(k) * P_2prime.at(k)) / P.at(k);
-      }
+      I += GRMModel::fisherInf(*questionSet.bank, item, theta);
+      add_grm_bias(item, theta, B);
     }
     
-    double L_theta = d1LL(theta, false, prior);
+    double L_theta = model_d1LL<GRMModel>(theta);
 
     return L_theta + (B / (2 * I));
   };
@@ -183,73 +121,21 @@ double WLEEstimator::grm_estimateTheta(Prior prior){
   return brentMethod(W);
 }
 
-double WLEEstimator::grm_estimateTheta(Prior prior, size_t question, int answer){
+double WLEEstimator::grm_estimateTheta(size_t question, int answer) const{
   
-  integrableFunction W = [&](double theta) {
+  auto W = [&](double theta) {
     double B = 0.0;
     double I = 0.0;
 
-    std::vector<double> P_star_prime;
-    std::vector<double> P_star_2prime;
-
     for (auto item : questionSet.applicable_rows) {
-      I += fisherInf(theta, item, questionSet.answers.at(item));
-      
-      double beta = questionSet.discrimination.at(item);
-      std::vector<double> P_stars = prob_grm(theta, item);
-
-      P_star_prime.clear();
-      P_star_prime.reserve(P_stars.size());
-
-      P_star_2prime.clear();
-      P_star_2prime.reserve(P_stars.size());
-
-      for (auto P_star : P_stars) {
-        double Q_star = 1 - P_star;
-        double P_star_p = -1 * beta * P_star * Q_star;
-        P_star_prime.push_back(P_star_p);
-        
-        double P_star_2p = -1 * beta * (P_star_p - (2 * P_star * P_star_p));
-        P_star_2prime.push_back(P_star_2p);
-      }
-      
-      for (size_t j = 1; j < P_stars.size(); ++j) {
-        double P_prime = (P_star_prime.at(j) - P_star_prime.at(j-1));      
-        double P_2prime = (P_star_2prime.at(j) - P_star_2prime.at(j-1));
-        double P = P_stars.at(j) - P_stars.at(j-1);
-        B += (P_prime* P_2prime) / P;
-      }
-
+      I += GRMModel::fisherInf(*questionSet.bank, item, theta);
+      add_grm_bias(item, theta, B);
     }
 
-    I += fisherInf(theta, question, answer);
-    
-    double beta = questionSet.discrimination.at(question);
-    std::vector<double> P_stars = prob_grm(theta, question);
-
-    P_star_prime.clear();
-    P_star_prime.reserve(P_stars.size());
-
-    P_star_2prime.clear();
-    P_star_2prime.reserve(P_stars.size());
-
-    for (auto P_star : P_stars) {
-      double Q_star = 1 - P_star;
-      double P_star_p = -1 * beta * P_star * Q_star;
-      P_star_prime.push_back(P_star_p);
-      
-      double P_star_2p = -1 * beta * (P_star_p - (2 * P_star * P_star_p));
-      P_star_2prime.push_back(P_star_2p);
-    }
+    I += GRMModel::fisherInf(*questionSet.bank, question, theta);
+    add_grm_bias(question, theta, B);
     
-    for (size_t j = 1; j < P_stars.size(); ++j) {
-      double P_prime = (P_star_prime.at(j) - P_star_prime.at(j-1));      
-      double P_2prime = (P_star_2prime.at(j) - P_star_2prime.at(j-1));
-      double P = P_stars.at(j) - P_stars.at(j-1);
-      B += (P_prime* P_2prime) / P;
-    }
-    
-    double L_theta = d1LL(theta, false, prior, question, answer);
+    double L_theta = model_d1LL<GRMModel>(theta, question, answer);
 
     return L_theta + (B / (2 * I));
   };
@@ -257,47 +143,37 @@ double WLEEstimator::grm_estimateTheta(Prior prior, size_t question, int answer)
   return brentMethod(W);
 }
 
-double WLEEstimator::estimateTheta(Prior prior) {
-  double theta = 0.0;
-
-  if ((questionSet.model == "ltm") | (questionSet.model == "tpm")) {
-	  theta = ltm_estimateTheta(prior);
+double WLEEstimator::estimateTheta(Prior /*prior*/) const {
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return grm_estimateTheta();
+	case ModelType::GPCM:
+		return gpcm_estimateTheta();
+	default:
+		return ltm_estimateTheta();
 	}
-	if (questionSet.model == "grm") {
-	  theta = grm_estimateTheta(prior);
-	}
-	if (questionSet.model == "gpcm"){
-		theta = gpcm_estimateTheta(prior);
-	}
-	
-	return theta;
 }
 
-double WLEEstimator::estimateTheta(Prior prior, size_t question, int answer)
+double WLEEstimator::estimateTheta(Prior /*prior*/, size_t question, int answer) const
 {
-  double theta = 0.0;
-
-  if ((questionSet.model == "ltm") | (questionSet.model == "tpm")) {
-    theta = ltm_estimateTheta(prior, question, answer);
-  }
-  if (questionSet.model == "grm") {
-    theta = grm_estimateTheta(prior, question, answer);
-  }
-  if (questionSet.model == "gpcm"){
-    theta = gpcm_estimateTheta(prior, question, answer);
-  }
-  
-  return theta;
+	switch (questionSet.bank->model_type) {
+	case ModelType::GRM:
+		return grm_estimateTheta(question, answer);
+	case ModelType::GPCM:
+		return gpcm_estimateTheta(question, answer);
+	default:
+		return ltm_estimateTheta(question, answer);
+	}
 }
 
 
-double WLEEstimator::estimateSE(Prior prior) {
+double WLEEstimator::estimateSE(Prior prior) const {
   double I_theta = fisherTestInfo(prior);
   double var = 1 / I_theta;
   return std::pow(var, 0.5);
 }
 
-double WLEEstimator::estimateSE(Prior prior, size_t question, int answer)
+double WLEEstimator::estimateSE(Prior prior, size_t question, int answer) const
 {
   double I_theta = fisherTestInfo(prior, question, answer);
   return std::pow(1 / I_theta, 0.5);
@@ -308,5 +184,42 @@ EstimationType WLEEstimator::getEstimationType() const {
 	return EstimationType::WLE;
 }
 
-WLEEstimator::WLEEstimator(Integrator &integrator, QuestionSet &questionSet) : Estimator(integrator, questionSet) { }
+WLEEstimator::WLEEstimator(Integrator &integrator, const QuestionSet &questionSet) : Estimator(integrator, questionSet) { }
 
+void WLEEstimator::add_gpcm_bias(size_t item, double theta, double &B) const {
+  const size_t count = GPCMModel::probabilityCount(*questionSet.bank, item);
+  ScratchBuffer p(count);
+  ScratchBuffer p_prime(count);
+  ScratchBuffer p_primeprime(count);
+  GPCMModel::derivatives(*questionSet.bank, item, theta, p.data(), p_prime.data(), p_primeprime.data());
+
+  for (size_t k = 0; k < count; ++k) {
+    B += (p_prime[k] * p_primeprime[k]) / p[k];
+  }
+}
+
+void WLEEstimator::add_grm_bias(size_t item, double theta, double &B) const {
+  const size_t count = GRMModel::probabilityCount(*questionSet.bank, item);
+  ScratchBuffer P_stars(count);
+  GRMModel::probabilities(*questionSet.bank, item, theta, P_stars.data());
+
+  // Derivatives of the cumulative probabilities; each category's are the difference of two neighbours
+  double beta = questionSet.bank->discrimination[item];
+  double P_star_prime = 0.0;
+  double P_star_2prime = 0.0;
+  for (size_t j = 0; j < count; ++j) {
+    double P_star = P_stars[j];
+    double Q_star = 1 - P_star;
+    double P_star_p = -1 * beta * P_star * Q_star;
+    double P_star_2p = -1 * beta * (P_star_p - (2 * P_star * P_star_p));
+
+    if (j > 0) {
+      double P_prime = (P_star_p - P_star_prime);
+      double P_2prime = (P_star_2p - P_star_2prime);
+      double P = P_stars[j] - P_stars[j-1];
+      B += (P_prime* P_2prime) / P;
+    }
+    P_star_prime = P_star_p;
+    P_star_2prime = P_star_2p;
+  }
+}
@@ -9,25 +9,31 @@ class WLEEstimator : public Estimator {
 
 public:
 
-	WLEEstimator(Integrator &integrator, QuestionSet &questionSet);
+	WLEEstimator(Integrator &integrator, const QuestionSet &questionSet);
 
 	virtual EstimationType getEstimationType() const override;
 
-	virtual double estimateTheta(Prior prior) override;
-	virtual double estimateTheta(Prior prior, size_t question, int answer) override;
+	virtual double estimateTheta(Prior prior) const override;
+	virtual double estimateTheta(Prior prior, size_t question, int answer) const override;
 
-	virtual double estimateSE(Prior prior) override;
-  virtual double estimateSE(Prior prior, size_t question, int answer) override;
+	virtual double estimateSE(Prior prior) const override;
+  virtual double estimateSE(Prior prior, size_t question, int answer) const override;
 
 private:
   
-  double ltm_estimateTheta(Prior prior);
-  double ltm_estimateTheta(Prior prior, size_t question, int answer);
+  double ltm_estimateTheta() const;
+  double ltm_estimateTheta(size_t question, int answer) const;
   
-  double grm_estimateTheta(Prior prior);
-  double grm_estimateTheta(Prior prior, size_t question, int answer);
+  double grm_estimateTheta() const;
+  double grm_estimateTheta(size_t question, int answer) const;
 
-  double gpcm_estimateTheta(Prior prior);
-  double gpcm_estimateTheta(Prior prior, size_t question, int answer);
+  double gpcm_estimateTheta() const;
+  double gpcm_estimateTheta(size_t question, int answer) const;
+
+  /**
+   * Add one item's term of the bias correction B at theta, in the W functions whose root is the estimate.
+   */
+  void add_grm_bias(size_t item, double theta, double &B) const;
+  void add_gpcm_bias(size_t item, double theta, double &B) const;
 
 };
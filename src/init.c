@@ -26,8 +26,26 @@ extern SEXP catSurv_posteriorKL(SEXP, SEXP);
 extern SEXP catSurv_prior(SEXP, SEXP, SEXP);
 extern SEXP catSurv_probability(SEXP, SEXP, SEXP);
 extern SEXP catSurv_selectItem(SEXP);
-extern SEXP catSurv_estimateThetas(SEXP,SEXP);
+extern SEXP catSurv_estimateThetas(SEXP,SEXP,SEXP);
 extern SEXP catSurv_simulateThetas(SEXP,SEXP);
+extern SEXP catSurv_makeTree(SEXP,SEXP);
+extern SEXP catSurv_writeTree(SEXP,SEXP,SEXP);
+extern SEXP catSurv_readTree(SEXP);
+extern SEXP catSurv_treeSelectItem(SEXP,SEXP);
+extern SEXP catSurv_catSession(SEXP, SEXP);
+extern SEXP catSurv_sessionStoreAnswer(SEXP, SEXP, SEXP);
+extern SEXP catSurv_sessionSelectItem(SEXP);
+extern SEXP catSurv_sessionEstimateTheta(SEXP);
+extern SEXP catSurv_sessionEstimateSE(SEXP);
+extern SEXP catSurv_sessionCheckStopRules(SEXP);
+extern SEXP catSurv_sessionSaveCache(SEXP, SEXP);
+extern SEXP catSurv_sessionLoadCache(SEXP, SEXP);
+extern SEXP catSurv_sessionScreenDiagnostics(SEXP);
+extern SEXP catSurv_scratchAllocations(void);
+extern SEXP catSurv_integrationWorkspaces(void);
+extern SEXP catSurv_vectorExp(SEXP);
+extern SEXP catSurv_vectorLog(SEXP);
+extern SEXP catSurv_sameItemBank(SEXP, SEXP);
 
 
 static const R_CallMethodDef CallEntries[] = {
@@ -49,8 +67,26 @@ static const R_CallMethodDef CallEntries[] = {
     {"catSurv_prior",          (DL_FUNC) &catSurv_prior,          3},
     {"catSurv_probability",    (DL_FUNC) &catSurv_probability,    3},
     {"catSurv_selectItem",     (DL_FUNC) &catSurv_selectItem,     1},
-    {"catSurv_estimateThetas", (DL_FUNC) &catSurv_estimateThetas, 2},
+    {"catSurv_estimateThetas", (DL_FUNC) &catSurv_estimateThetas, 3},
     {"catSurv_simulateThetas",    (DL_FUNC) &catSurv_simulateThetas,    2},
+    {"catSurv_makeTree",          (DL_FUNC) &catSurv_makeTree,          2},
+    {"catSurv_writeTree",         (DL_FUNC) &catSurv_writeTree,         3},
+    {"catSurv_readTree",          (DL_FUNC) &catSurv_readTree,          1},
+    {"catSurv_treeSelectItem",    (DL_FUNC) &catSurv_treeSelectItem,    2},
+    {"catSurv_catSession",             (DL_FUNC) &catSurv_catSession,             2},
+    {"catSurv_sessionStoreAnswer",     (DL_FUNC) &catSurv_sessionStoreAnswer,     3},
+    {"catSurv_sessionSelectItem",      (DL_FUNC) &catSurv_sessionSelectItem,      1},
+    {"catSurv_sessionEstimateTheta",   (DL_FUNC) &catSurv_sessionEstimateTheta,   1},
+    {"catSurv_sessionEstimateSE",      (DL_FUNC) &catSurv_sessionEstimateSE,      1},
+    {"catSurv_sessionCheckStopRules",  (DL_FUNC) &catSurv_sessionCheckStopRules,  1},
+    {"catSurv_sessionSaveCache",       (DL_FUNC) &catSurv_sessionSaveCache,       2},
+    {"catSurv_sessionLoadCache",       (DL_FUNC) &catSurv_sessionLoadCache,       2},
+    {"catSurv_sessionScreenDiagnostics", (DL_FUNC) &catSurv_sessionScreenDiagnostics, 1},
+    {"catSurv_scratchAllocations",     (DL_FUNC) &catSurv_scratchAllocations,     0},
+    {"catSurv_integrationWorkspaces",  (DL_FUNC) &catSurv_integrationWorkspaces,  0},
+    {"catSurv_vectorExp",              (DL_FUNC) &catSurv_vectorExp,              1},
+    {"catSurv_vectorLog",              (DL_FUNC) &catSurv_vectorLog,              1},
+    {"catSurv_sameItemBank",           (DL_FUNC) &catSurv_sameItemBank,           2},
     {NULL, NULL, 0}
 };
 
@@ -1,5 +1,8 @@
 #include <Rcpp.h>
 #include "Cat.h"
+#include "Scratch.h"
+#include "TreeFile.h"
+#include "VectorMath.h"
 #include <boost/variant.hpp>
 using namespace Rcpp;
 
@@ -407,6 +410,7 @@ double estimateTheta(S4 catObj) {
 //'
 //' @param catObj An object of class \code{Cat}
 //' @param responses A dataframe of complete response profiles
+//' @param control A named list of options.  See \strong{Details}.
 //'
 //' @return The function \code{estimateThetas} returns a vector of the expected values of the respondents' ability parameters.
 //'
@@ -425,6 +429,13 @@ double estimateTheta(S4 catObj) {
 //' Estimating \eqn{\theta} requires root finding with the ``Brent'' method in the GNU Scientific
 //'  Library (GSL) with initial search interval of \code{[-5,5]}.
 //' 
+//' Respondents are estimated in parallel.  The \code{control} list accepts the options described for \code{\link{catSession}},
+//' and in addition:
+//' \itemize{
+//' \item \code{deduplicate}: If \code{TRUE} (the default), each distinct response profile is estimated once and the estimate is
+//' shared by every respondent who gave the same answers.  The results are the same either way.
+//' }
+//' 
 //' @examples
 //'## Loading ltm Cat object
 //'data(ltm_cat)
@@ -434,6 +445,9 @@ double estimateTheta(S4 catObj) {
 //'setEstimation(ltm_cat) <- "EAP"
 //'estimateThetas(ltm_cat, responses = npi[1:25, ])
 //'
+//'## Estimate every respondent, even when response profiles repeat
+//'estimateThetas(ltm_cat, responses = npi[1:25, ], control = list(deduplicate = FALSE))
+//'
 //' 
 //' @author Haley Acevedo, Ryden Butler, Josh W. Cutler, Matt Malis, Jacob M. Montgomery,
 //'  Tom Wilkinson, Erin Rossiter, Min Hee Seo, Alex Weil 
@@ -448,8 +462,8 @@ double estimateTheta(S4 catObj) {
 //' @seealso \code{\link{Cat-class}}, \code{\link{estimateTheta}}
 //' @export
 // [[Rcpp::export]]
-NumericVector estimateThetas(S4 catObj, DataFrame responses){
-	return Cat(catObj).estimateThetas(responses);
+NumericVector estimateThetas(S4 catObj, DataFrame responses, List control = List::create()){
+	return Cat(catObj, CatControl(control)).estimateThetas(responses);
 }
 
 
@@ -501,6 +515,157 @@ NumericVector simulateThetas(S4 catObj, DataFrame responses){
 }
 
 
+//' Make Tree of Possible Question Combinations
+//'
+//' Pre-calculates a complete branching scheme of all possible questions-answer combinations and stores it as a list of lists or a flattened table of values.
+//'
+//' @param catObj An object of class \code{Cat}
+//' @param flat A logical indicating whether to return tree as as a list of lists or a table
+//'
+//'
+//' @details The function takes a \code{Cat} object and generates a tree of all possible question-answer combinations, conditional on previous answers in the branching scheme and the current \eqn{\theta} estimates for the branch.
+//' The tree is stored as a list of lists, iteratively generated by filling in a possible answer, calculating the next question via \code{selectItem}, filling in a possible answer for that question, and so forth.
+//' The branches of each level of the tree are expanded in parallel, except with \code{"RANDOM"} selection.
+//' 
+//' The length of each complete branching scheme within the tree is dictated by the \code{lengthThreshold} slot within the \code{Cat} object.
+//' 
+//' @return The function \code{makeTree} returns either a list or a table.  If the argument \code{flat} is \code{FALSE}, the default value, the function returns a list of lists.
+//' 
+//' If the argument \code{flat} is \code{TRUE}, the function takes the list of lists and configures it into a flattened table where the columns represent the battery items and the rows represent the possible answer profiles.
+//' 
+//' @note This function is computationally expensive.  If there are \eqn{k} response options and the researcher wants a complete branching scheme to include \eqn{n} items, \eqn{k^{n-1}} complete branching schemes will be calculated.  Setting \eqn{n} is done via the \code{lengthThreshold} slot in the \code{Cat} object.  See \strong{Examples}.
+//' 
+//' This function is to allow users to access the internal functions of the package. During item selection, all calculations are done in compiled \code{C++} code.
+//' 
+//' 
+//' @seealso \code{\link{Cat-class}}, \code{\link{checkStopRules}}, \code{\link{selectItem}}
+//' 
+//' 
+//' @examples
+//' ## Loading ltm Cat object
+//' data(ltm_cat)
+//' 
+//' ## Setting complete branches to include 3 items
+//' setLengthThreshold(ltm_cat) <- 3
+//' 
+//' ## Object returned is list of lists
+//' ltm_list <- makeTree(ltm_cat)
+//' 
+//' ## Object returned is table
+//' ltm_table <- makeTree(ltm_cat, flat = TRUE)
+//' 
+//' 
+//' 
+//' 
+//' @author Haley Acevedo, Ryden Butler, Josh W. Cutler, Matt Malis, Jacob M. Montgomery, Tom Wilkinson, Erin Rossiter, Min Hee Seo, Alex Weil 
+//' 
+//' @rdname makeTree
+//' 
+//' @export
+// [[Rcpp::export]]
+SEXP makeTree(S4 catObj, bool flat = false){
+	return Cat(catObj).makeTree(flat);
+}
+
+
+/**
+ * A catTree is an external pointer to a TreeFile, which keeps the file mapped until the pointer is
+ * garbage collected.
+ */
+static TreeFile& treeFile(SEXP tree) {
+  if (TYPEOF(tree) != EXTPTRSXP || !Rf_inherits(tree, "catTree")) {
+    stop("tree must be an object created by readTree.");
+  }
+  XPtr<TreeFile> ptr(tree);
+  if (ptr.get() == NULL) {
+    stop("catTree is no longer valid (was it saved and reloaded?). Read the file again with readTree.");
+  }
+  return *ptr;
+}
+
+//' Precomputed Tree Files
+//'
+//' Writes the tree of \code{\link{makeTree}} to a compact binary file, and administers items from such a file without
+//' estimating the ability parameter or selecting items.
+//'
+//' @param catObj An object of class \code{Cat}
+//' @param file The path of the tree file
+//' @param estimates A logical indicating whether to store the estimate of \eqn{\theta} and its standard error for every node
+//' @param tree An object of class \code{catTree} created by \code{readTree}
+//' @param answers A vector with the respondent's answer to each item, \code{NA} for unanswered items and \code{-1} for skipped items
+//'
+//' @return The function \code{writeTree} invisibly returns \code{NULL}.
+//'
+//' The function \code{readTree} returns an object of class \code{catTree}.
+//'
+//' The function \code{treeSelectItem} returns a list with \code{next_item}, the index of the item the tree gives for \code{answers}
+//' (\code{NA} when the branch ends because every item is answered), and \code{theta} and \code{se}, the estimates
+//' stored for that node (\code{NA} when the file was written with \code{estimates = FALSE}).
+//'
+//' @details \code{writeTree} builds the same tree as \code{\link{makeTree}}, so its length is set by the \code{lengthThreshold}
+//' slot, and stores it as an array of nodes. Each node holds its item, the position of its children (one for each response option,
+//' starting with a skipped item), and optionally the estimates from the answers leading to it.
+//'
+//' \code{readTree} maps the file into memory rather than reading it (on Windows the file is read), so large trees are available
+//' immediately. \code{treeSelectItem} follows the stored answers from the first item of the tree, reading one node for each
+//' item answered, and returns the node where the respondent's next item is unanswered, or where the branch ends.
+//' Answers to items that are not on the respondent's branch are ignored.
+//'
+//' The file stores numbers in the byte order of the machine that wrote it, and includes a format version; \code{readTree} gives an error
+//' for files with a different byte order or version. A \code{catTree} is not preserved by \code{save} or \code{saveRDS}.
+//'
+//' @examples
+//'## Loading ltm Cat object
+//'data(ltm_cat)
+//'setLengthThreshold(ltm_cat) <- 3
+//'
+//'## Write the tree once
+//'file <- tempfile(fileext = ".cattree")
+//'writeTree(ltm_cat, file)
+//'
+//'## Administer items from the file
+//'tree <- readTree(file)
+//'answers <- rep(NA, length(ltm_cat@answers))
+//'first <- treeSelectItem(tree, answers)
+//'answers[first$next_item] <- 1
+//'treeSelectItem(tree, answers)
+//'
+//' @author Haley Acevedo, Ryden Butler, Josh W. Cutler, Matt Malis, Jacob M. Montgomery,
+//'  Tom Wilkinson, Erin Rossiter, Min Hee Seo, Alex Weil 
+//'
+//' @seealso \code{\link{makeTree}}, \code{\link{selectItem}}
+//' @export
+// [[Rcpp::export]]
+void writeTree(S4 catObj, std::string file, bool estimates = true) {
+  Cat(catObj).writeTree(file, estimates);
+}
+
+//' @rdname writeTree
+//' @export
+// [[Rcpp::export]]
+SEXP readTree(std::string file) {
+  XPtr<TreeFile> ptr(new TreeFile(file), true);
+  ptr.attr("class") = "catTree";
+  return ptr;
+}
+
+//' @rdname writeTree
+//' @export
+// [[Rcpp::export]]
+List treeSelectItem(SEXP tree, IntegerVector answers) {
+  const TreeFile& file = treeFile(tree);
+  if (size_t(answers.size()) != file.itemNames().size()) {
+    stop("answers must have one value for each item in the tree.");
+  }
+
+  size_t node = file.route(answers.begin(), answers.size());
+  int item = file.item(node);
+  return List::create(Named("next_item") = item < 0 ? NA_INTEGER : item + 1,
+                      Named("theta") = file.theta(node),
+                      Named("se") = file.se(node));
+}
+
+
 //' Observed Information
 //'
 //' Calculates the observed information of the likelihood of a respondent's ability \eqn{\theta} for a given \code{item}.
@@ -1162,3 +1327,272 @@ bool checkStopRules(S4 catObj) {
 
 
 
+
+
+/**
+ * A catSession is an external pointer to a C++ Cat object that outlives a single call from R. It is built
+ * once from the S4 object and then updated in place, so that each respondent step only costs the
+ * estimation and selection math rather than the conversion of every slot of the Cat object.
+ */
+static Cat& sessionCat(SEXP session) {
+  if (TYPEOF(session) != EXTPTRSXP || !Rf_inherits(session, "catSession")) {
+    stop("session must be an object created by catSession.");
+  }
+  XPtr<Cat> ptr(session);
+  if (ptr.get() == NULL) {
+    stop("catSession is no longer valid (was it saved and reloaded?). Create a new session with catSession.");
+  }
+  return *ptr;
+}
+
+//' Persistent Cat Sessions
+//'
+//' Creates a compiled copy of a \code{Cat} object that is kept alive between calls, and provides functions to store answers,
+//' select the next item, estimate the ability parameter, and check stopping rules against it.
+//'
+//' @param catObj An object of class \code{Cat}
+//' @param control A named list of options for the session.  See \strong{Details}.
+//' @param session An object of class \code{catSession} created by \code{catSession}
+//' @param item An integer indicating the index of the question item
+//' @param answer An integer indicating the response to the question item. Use \code{-1} for a skipped item and \code{NA}
+//' to remove a previously stored answer.
+//' @param file A character string giving the path of a selection cache file
+//'
+//' @return The function \code{catSession} returns an object of class \code{catSession}.
+//' 
+//' The functions \code{sessionStoreAnswer}, \code{sessionSaveCache}, and \code{sessionLoadCache} invisibly return \code{NULL}; \code{sessionStoreAnswer} updates the session in place.
+//' 
+//' The functions \code{sessionSelectItem}, \code{sessionEstimateTheta}, \code{sessionEstimateSE}, and \code{sessionCheckStopRules}
+//' return the same values as \code{\link{selectItem}}, \code{\link{estimateTheta}}, \code{\link{estimateSE}}, and \code{\link{checkStopRules}}
+//' would for a \code{Cat} object holding the same answers.
+//'
+//' The function \code{sessionScreenDiagnostics} returns a list with the number of screened \code{selections} the session has made itself,
+//' the number of \code{audits} among them, and the number of audits in which screening selected a different item (\code{disagreements}).
+//' Selections made in the background by \code{speculate} are neither counted nor audited.  It throws an error for a session created
+//' without \code{screen}.
+//'
+//' @details Every other function in this package converts the \code{Cat} object into its compiled representation on each call.
+//' When items are administered one at a time, a \code{catSession} avoids repeating that conversion: the session is created once
+//' and answers are stored directly in the compiled object.
+//' 
+//' When the \code{estimation} slot is \code{"MLE"} or \code{"WLE"}, the session switches to and from the approach in the
+//' \code{estimationDefault} slot as answers are stored, exactly as a newly created \code{Cat} object would.
+//' 
+//' A \code{catSession} refers to memory held by the compiled code. It is not preserved by \code{save} or \code{saveRDS},
+//' and changes made to the session are not reflected in the \code{Cat} object it was created from.
+//' 
+//' The \code{control} list may contain the following elements:
+//' \itemize{
+//' \item \code{quadrature}: How EAP estimates are integrated.  The default, \code{"adaptive"}, uses adaptive quadrature
+//' as in \code{\link{estimateTheta}}.  With \code{"hermite"} (Gauss-Hermite) or \code{"rectangular"} (midpoint rule) the posterior
+//' is kept on a fixed set of points, and storing an answer only updates the likelihood at those points, so each estimate is a weighted sum.
+//' Gauss-Hermite points are centered and scaled by the prior when \code{priorName} is \code{"NORMAL"}; otherwise, and for the
+//' rectangular rule, the points cover \code{lowerBound} to \code{upperBound}.
+//' \item \code{quadraturePoints}: The number of points used when \code{quadrature} is not \code{"adaptive"}, between 2 and 200 (default 61).
+//' \item \code{speculate}: If \code{TRUE}, each time \code{sessionSelectItem} selects an item, the session starts selecting the item to follow
+//' every possible answer to it on another thread (default \code{FALSE}).  When that answer is stored, the next call to \code{sessionSelectItem}
+//' returns the precomputed selection instead of waiting for it.  Storing an answer to a different item cancels the background selections without
+//' waiting for them.  This is not used with \code{"RANDOM"} selection.
+//' \item \code{cache}: If \code{TRUE}, the session shares a cache of item selections and estimates with every other session created with \code{cache = TRUE} and the same \code{cacheSize}
+//' from a \code{Cat} object with the same items, answers, and estimation and selection settings (default \code{FALSE}).  The cache is keyed by the answers stored
+//' in the session, in order, so the selections on the paths most respondents take through the first items are computed once rather than for every respondent.
+//' This is not used with \code{"RANDOM"} selection.
+//' \item \code{cacheSize}: The number of answer paths the cache keeps (default 10000).  When it is full, the least recently used paths are removed.
+//' A cache that is already in use by another session keeps the size it was created with.
+//' \item \code{infoTable}: If \code{TRUE} and \code{selection} is \code{"MFI"}, the information of every item is tabulated once on a grid of thetas from
+//' \code{lowerBound} to \code{upperBound} and shared by every session with the same items (default \code{FALSE}).  Each selection interpolates the table
+//' and computes the information exactly only for the items that interpolate highest, so selection from a large bank is much faster.  With a coarse grid the
+//' selected item can differ from the one \code{\link{selectItem}} returns, and the \code{estimates} of the items that are not computed exactly are interpolated.
+//' \item \code{infoTablePoints}: The number of grid points in the table, between 2 and 100000 (default 401).
+//' \item \code{infoTableRefine}: The number of items whose information is always computed exactly (default 5).  Items beyond these are computed while their
+//' interpolated information is at least the largest exact information found so far.
+//' \item \code{infoBound}: If \code{TRUE} and \code{selection} is \code{"MFI"}, an upper bound on the information of every item is computed once for each of a
+//' number of bins of thetas from \code{lowerBound} to \code{upperBound} and shared by every session with the same items (default \code{FALSE}).  Each selection
+//' computes the information of the items in decreasing order of their bounds and stops when no remaining item can have more information than the best one,
+//' so it selects the same item as \code{\link{selectItem}} while computing the information of only a fraction of a large bank.  The \code{estimates} of the
+//' items that are not computed are \code{NA}.  \code{infoBound} and \code{infoTable} cannot both be \code{TRUE}.
+//' \item \code{infoBoundBins}: The number of bins, between 1 and 10000 (default 50).  More bins give tighter bounds, and the bounds take
+//' \code{infoBoundBins} times 12 bytes for each item.
+//' \item \code{screen}: The number of candidate items for \code{"EPV"}, \code{"MEI"}, and \code{"KL"} selection (default 0, which computes the criterion
+//' for every unanswered item).  When it is positive, the unanswered items are ranked by their Fisher information at the current estimate of theta, and only the
+//' \code{screen} most informative ones get the criterion, so the selected item can differ from the one \code{\link{selectItem}} returns.  The \code{estimates}
+//' of the other items are \code{NA}.
+//' \item \code{screenAudit}: How often a screened selection also computes the criterion for every item to check whether it selects the same item: every
+//' \code{screenAudit}-th selection, starting with the first (default 0, never).  Audited selections return the full \code{estimates}.
+//' }
+//'
+//' \code{sessionSaveCache} writes the cache of a session to \code{file}, and \code{sessionLoadCache} adds the entries of such a file to the cache of a session,
+//' so that it can be reused by a later \R session.  A file can only be loaded into a session created from a \code{Cat} object with the same configuration;
+//' a truncated or corrupt file throws an error and leaves the cache unchanged.
+//'
+//' @examples
+//'## Loading ltm Cat object
+//'data(ltm_cat)
+//'
+//'## Create a session and administer items one at a time
+//'session <- catSession(ltm_cat)
+//'sessionStoreAnswer(session, item = 1, answer = 1)
+//'sessionStoreAnswer(session, item = 2, answer = 0)
+//'sessionEstimateTheta(session)
+//'sessionEstimateSE(session)
+//'sessionSelectItem(session)$next_item
+//'sessionCheckStopRules(session)
+//'
+//'## Keep the EAP posterior on a grid of Gauss-Hermite points
+//'session <- catSession(ltm_cat, control = list(quadrature = "hermite", quadraturePoints = 41))
+//'sessionStoreAnswer(session, item = 1, answer = 1)
+//'sessionEstimateTheta(session)
+//'
+//'## Share selections between the sessions of a survey, and keep them for later
+//'session <- catSession(ltm_cat, control = list(cache = TRUE))
+//'sessionSelectItem(session)$next_item
+//'file <- tempfile()
+//'sessionSaveCache(session, file)
+//'sessionLoadCache(catSession(ltm_cat, control = list(cache = TRUE)), file)
+//'
+//'## Screen EPV candidates by their information, checking every fifth selection
+//'session <- catSession(ltm_cat, control = list(screen = 5, screenAudit = 5))
+//'sessionSelectItem(session)$next_item
+//'sessionScreenDiagnostics(session)
+//'
+//' @author Haley Acevedo, Ryden Butler, Josh W. Cutler, Matt Malis, Jacob M. Montgomery,
+//'  Tom Wilkinson, Erin Rossiter, Min Hee Seo, Alex Weil 
+//'  
+//' @note During item selection, all calculations are done in compiled \code{C++} code.
+//' 
+//' @seealso \code{\link{Cat-class}}, \code{\link{storeAnswer}}, \code{\link{selectItem}}, \code{\link{checkStopRules}}
+//' @export
+// [[Rcpp::export]]
+SEXP catSession(S4 catObj, List control = List::create()) {
+  // Finalized on exit too, so a session's speculation thread is joined before R shuts down
+  XPtr<Cat, PreserveStorage, standard_delete_finalizer<Cat>, true> ptr(new Cat(catObj, CatControl(control)), true);
+  ptr.attr("class") = "catSession";
+  return ptr;
+}
+
+//' @rdname catSession
+//' @export
+// [[Rcpp::export]]
+void sessionStoreAnswer(SEXP session, int item, int answer) {
+  Cat& cat = sessionCat(session);
+  if (item == NA_INTEGER || item < 1 || size_t(item) > cat.numberOfItems()) {
+    stop("item must be between 1 and the number of items in the session.");
+  }
+  cat.storeAnswer(item - 1, answer);
+}
+
+//' @rdname catSession
+//' @export
+// [[Rcpp::export]]
+List sessionSelectItem(SEXP session) {
+  return sessionCat(session).selectItem();
+}
+
+//' @rdname catSession
+//' @export
+// [[Rcpp::export]]
+double sessionEstimateTheta(SEXP session) {
+  return sessionCat(session).estimateTheta();
+}
+
+//' @rdname catSession
+//' @export
+// [[Rcpp::export]]
+double sessionEstimateSE(SEXP session) {
+  return sessionCat(session).estimateSE();
+}
+
+//' @rdname catSession
+//' @export
+// [[Rcpp::export]]
+bool sessionCheckStopRules(SEXP session) {
+  return sessionCat(session).checkStopRules();
+}
+
+//' @rdname catSession
+//' @export
+// [[Rcpp::export]]
+void sessionSaveCache(SEXP session, std::string file) {
+  sessionCat(session).saveCache(file);
+}
+
+//' @rdname catSession
+//' @export
+// [[Rcpp::export]]
+void sessionLoadCache(SEXP session, std::string file) {
+  sessionCat(session).loadCache(file);
+}
+
+//' @rdname catSession
+//' @export
+// [[Rcpp::export]]
+List sessionScreenDiagnostics(SEXP session) {
+  return sessionCat(session).screenDiagnostics();
+}
+
+//' Allocation Counters
+//'
+//' Profiling aids for the compiled selection code.  The function \code{scratchAllocations} returns the number of times any thread's arena of
+//' scratch buffers, which the item probability and information kernels use for working space, has had to grow.  Once the threads running
+//' \code{\link{sessionSelectItem}} have evaluated the largest items they see, repeated selections leave the count unchanged: the integrands then run
+//' without touching the heap.
+//'
+//' @return The count, as a numeric value.
+//'
+//' @keywords internal
+// [[Rcpp::export]]
+double scratchAllocations() {
+  return double(ScratchBuffer::allocations());
+}
+
+//' @rdname scratchAllocations
+//'
+//' @details The function \code{integrationWorkspaces} returns the number of GSL integration workspaces any thread has allocated.  Each thread
+//' keeps the workspaces it has used, so once the threads running \code{\link{sessionSelectItem}} have done the integrals a selection needs,
+//' repeated selections allocate no more.
+// [[Rcpp::export]]
+double integrationWorkspaces() {
+  return double(Integrator::workspaceAllocations());
+}
+
+//' Vectorized Exponentials and Logarithms
+//'
+//' The exponentials and logarithms used by the batch probability, information, and likelihood kernels.  When the package is compiled with
+//' AVX2 or AVX-512 enabled, the functions \code{vectorExp} and \code{vectorLog} evaluate several values at a time with approximations accurate
+//' to a few units in the last place; otherwise they return the same values as \code{exp} and \code{log}.
+//'
+//' @param x A numeric vector
+//'
+//' @return The exponentials, or logarithms, of the elements of \code{x}.
+//'
+//' @keywords internal
+// [[Rcpp::export]]
+std::vector<double> vectorExp(std::vector<double> x) {
+  vexp(x.data(), x.data(), x.size());
+  return x;
+}
+
+//' @rdname vectorExp
+// [[Rcpp::export]]
+std::vector<double> vectorLog(std::vector<double> x) {
+  vlog(x.data(), x.data(), x.size());
+  return x;
+}
+
+//' Item Bank Sharing
+//'
+//' Converts two \code{Cat} objects, as \code{\link{catSession}} does, and reports whether they read their item parameters from the same
+//' compiled item bank.  Cats with identical items, model, bounds, and \code{z} share one read-only bank, whatever their answers and estimation
+//' and selection settings, so any number of live sessions over the same items hold a single copy of the parameters.
+//'
+//' @param first,second Objects of class \code{Cat}
+//'
+//' @return \code{TRUE} if the two share an item bank, and \code{FALSE} otherwise.
+//'
+//' @keywords internal
+// [[Rcpp::export]]
+bool sameItemBank(S4 first, S4 second) {
+  Cat firstCat(first);
+  Cat secondCat(second);
+  return firstCat.sharesItemBank(secondCat);
+}